@@ -0,0 +1,139 @@
+#include "adpcm.h"
+
+static const u16 step_table[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+	34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+	157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+	724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+	3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const s8 index_table[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+static u32 get32(const u8 *p) { return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+
+/*****************************************************************************
+ * One decoder step. The magnitude is reconstructed as (2n+1)*step/8, which  *
+ * is what the usual sum of shifted steps approximates, with one multiply    *
+ * instead of three branches. Encoder and decoder share it, so they never    *
+ * drift apart.                                                              *
+ *****************************************************************************/
+static inline int step(int code, int *pred, int *index)
+{
+	int s = step_table[*index];
+	int diff = ((2*(code & 7) + 1) * s) >> 3;
+	int p = (code & 8) ? *pred - diff : *pred + diff;
+	int i = *index + index_table[code & 7];
+
+	if(p > 32767) p = 32767;
+	else if(p < -32768) p = -32768;
+	*index = (i < 0) ? 0 : (i > 88) ? 88 : i;
+	*pred = p;
+	return p;
+}
+
+int adpcmSamples(const void *data, u32 size)
+{
+	const u8 *p = data;
+	u32 samples, blocks;
+
+	if(size < ADPCM_HEADER_BYTES || get32(p) != ADPCM_MAGIC ||
+	   ((p[12] << 8) | p[13]) != ADPCM_BLOCK_SAMPLES)
+		return -1;
+
+	// A cut short file, or a header claiming more than an int can count
+	samples = get32(p + 4);
+	blocks = samples / ADPCM_BLOCK_SAMPLES + (samples % ADPCM_BLOCK_SAMPLES != 0);
+	if(samples > 0x7fffffff || blocks > (size - ADPCM_HEADER_BYTES) / ADPCM_BLOCK_BYTES)
+		return -1;
+	return samples;
+}
+
+u32 adpcmRate(const void *data)
+{
+	return get32((const u8 *)data + 8);
+}
+
+void adpcmEncodeBlock(const s16 *pcm, AdpcmState *state, u8 *out)
+{
+	int i, code, best, err, best_err, pred, index, p, x;
+
+	out[0] = (u16)state->predictor >> 8;
+	out[1] = (u16)state->predictor;
+	out[2] = state->index;
+	out[3] = 0;
+	out += 4;
+
+	pred = state->predictor;
+	index = state->index;
+	for(i=0; i<ADPCM_BLOCK_SAMPLES; i++) {
+		// Try every code, the encoder runs on the host and can afford it
+		best = 0;
+		best_err = 0x7fffffff;
+		for(code=0; code<16; code++) {
+			p = pred;
+			x = index;
+			err = step(code, &p, &x) - pcm[i];
+			if(err < 0) err = -err;
+			if(err < best_err) {
+				best_err = err;
+				best = code;
+			}
+		}
+		step(best, &pred, &index);
+
+		if(i & 1) out[i>>1] |= best;
+		else out[i>>1] = best << 4;
+	}
+	state->predictor = pred;
+	state->index = index;
+}
+
+void adpcmDecodeBlock(const u8 *in, s16 *pcm)
+{
+	int i, b, pred, index;
+
+	pred = (s16)((in[0] << 8) | in[1]);
+	index = in[2];
+	if(index > 88)
+		index = 88;
+	in += 4;
+
+	// Two samples per byte, the loop keeps the state in registers
+	for(i=0; i<ADPCM_BLOCK_SAMPLES/2; i++) {
+		b = in[i];
+		pcm[0] = step(b >> 4, &pred, &index);
+		pcm[1] = step(b & 15, &pred, &index);
+		pcm += 2;
+	}
+}
+
+int adpcmDecode(const void *data, u32 size, int first, int count, s16 *pcm)
+{
+	const u8 *blocks = (const u8 *)data + ADPCM_HEADER_BYTES;
+	s16 tmp[ADPCM_BLOCK_SAMPLES];
+	int total, n, done = 0, i;
+
+	total = adpcmSamples(data, size);
+	if(total < 0 || first < 0 || first >= total || (first % ADPCM_BLOCK_SAMPLES))
+		return 0;
+	if(count > total - first)
+		count = total - first;
+
+	blocks += (first / ADPCM_BLOCK_SAMPLES) * ADPCM_BLOCK_BYTES;
+	while(done < count) {
+		n = count - done;
+		if(n >= ADPCM_BLOCK_SAMPLES)
+			adpcmDecodeBlock(blocks, pcm + done);
+		else {
+			// Last partial block goes through a bounce buffer
+			adpcmDecodeBlock(blocks, tmp);
+			for(i=0; i<n; i++)
+				pcm[done + i] = tmp[i];
+		}
+		blocks += ADPCM_BLOCK_BYTES;
+		done += (n < ADPCM_BLOCK_SAMPLES) ? n : ADPCM_BLOCK_SAMPLES;
+	}
+	return count;
+}
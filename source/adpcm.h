@@ -0,0 +1,82 @@
+#ifndef __ADPCM_H__
+#define __ADPCM_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * Layout of a sound compressed by tools/adpcmenc, 4 bit IMA ADPCM:          *
+ *                                                                           *
+ *		header         16 bytes                                              *
+ *		block[]        ADPCM_BLOCK_BYTES each                                *
+ *                                                                           *
+ * header: u32 magic, u32 samples, u32 rate, u16 block samples, u16 0        *
+ * block:  s16 predictor, u8 step index, u8 0, then two samples per byte,    *
+ *         high nibble first                                                 *
+ *                                                                           *
+ * All values are big endian. Every block starts from the decoder state      *
+ * stored in it, so blocks can be decoded independently of each other.       *
+ *****************************************************************************/
+
+#define ADPCM_MAGIC         0x41445043 // 'ADPC'
+#define ADPCM_HEADER_BYTES  16
+#define ADPCM_BLOCK_SAMPLES 64
+#define ADPCM_BLOCK_BYTES   (4 + ADPCM_BLOCK_SAMPLES/2)
+
+typedef struct {
+	s16 predictor;
+	u8 index;
+} AdpcmState;
+
+/****************************************************************************
+ * adpcmSamples
+ *
+ * Checks the size bytes at data, which may come from storage
+ * returns: number of samples in the sound, -1 if data is not ADPCM or
+ *          holds fewer blocks than its header claims
+ ***************************************************************************/
+int adpcmSamples(const void *data, u32 size);
+
+/****************************************************************************
+ * adpcmRate
+ *
+ * returns: sample rate the sound was recorded at, data has to have passed
+ *          adpcmSamples()
+ ***************************************************************************/
+u32 adpcmRate(const void *data);
+
+/****************************************************************************
+ * adpcmEncodeBlock
+ *
+ * Encodes ADPCM_BLOCK_SAMPLES samples from pcm into out, starting from and
+ * updating state. Used by the host encoder.
+ ***************************************************************************/
+void adpcmEncodeBlock(const s16 *pcm, AdpcmState *state, u8 *out);
+
+/****************************************************************************
+ * adpcmDecodeBlock
+ *
+ * Expands one block into ADPCM_BLOCK_SAMPLES native endian samples
+ ***************************************************************************/
+void adpcmDecodeBlock(const u8 *in, s16 *pcm);
+
+/****************************************************************************
+ * adpcmDecode
+ *
+ * Expands samples first to first+count-1 of the sound of size bytes into
+ * pcm, so sounds can also be streamed block by block. first must be a
+ * multiple of ADPCM_BLOCK_SAMPLES. count is clamped to the end of the
+ * sound.
+ * returns: number of samples written, 0 if adpcmSamples() rejects data
+ ***************************************************************************/
+int adpcmDecode(const void *data, u32 size, int first, int count, s16 *pcm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
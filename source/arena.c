@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+#include "arena.h"
+
+int arenaInit(FrameArena *a, size_t size)
+{
+	size = (size + 31) & ~31;
+	a->block = memalign(32, 2*size);
+	if(a->block == NULL)
+		return -1;
+
+	a->base[0] = a->block;
+	a->base[1] = a->base[0] + size;
+	a->size = size;
+	a->used = 0;
+	a->cur = 0;
+	a->peak = 0;
+	a->last = 0;
+	a->failures = 0;
+	return 0;
+}
+
+void arenaFree(FrameArena *a)
+{
+	free(a->block);
+	a->block = NULL;
+	a->base[0] = a->base[1] = NULL;
+	a->size = 0;
+	a->used = 0;
+}
+
+void arenaReset(FrameArena *a)
+{
+	a->last = a->used;
+	a->cur ^= 1;
+	a->used = 0;
+}
+
+void *arenaAlloc(FrameArena *a, size_t size, size_t align)
+{
+	size_t start = (a->used + align - 1) & ~(align - 1);
+
+	if(start + size > a->size || start + size < start) {
+		a->failures++;
+		return NULL;
+	}
+	a->used = start + size;
+	if(a->used > a->peak)
+		a->peak = a->used;
+	return a->base[a->cur] + start;
+}
+
+char *arenaPrintf(FrameArena *a, const char *fmt, ...)
+{
+	static char empty[1] = "";
+	va_list args;
+	char *s = (char *)a->base[a->cur] + a->used;
+	size_t room = a->size - a->used;
+	int n;
+
+	va_start(args, fmt);
+	n = vsnprintf(s, room, fmt, args);
+	va_end(args);
+
+	// Formatting went straight into the free space, claim what was used
+	if(n < 0 || (size_t)n >= room) {
+		a->failures++;
+		return empty;
+	}
+	return arenaAlloc(a, n + 1, 1);
+}
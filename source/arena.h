@@ -0,0 +1,76 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * Double buffered bump allocator for per frame scratch memory. Allocations  *
+ * are a pointer increment and are never freed individually; arenaReset()    *
+ * once per frame switches to the other half and starts over. Whatever was   *
+ * allocated during the previous frame stays valid for one more frame, so    *
+ * data can be handed from one frame to the next without copying.            *
+ *****************************************************************************/
+typedef struct {
+	u8 *base[2];		// both halves, 32 byte aligned
+	size_t size;		// size of each half
+	size_t used;		// bytes taken from the current half
+	int cur;			// current half
+	size_t peak;		// most bytes used within a single frame
+	size_t last;		// bytes used by the previous frame
+	u32 failures;		// allocations that did not fit
+	void *block;
+} FrameArena;
+
+// Typed helpers
+#define ARENA_NEW(a, T, n)     ((T *)arenaAlloc((a), sizeof(T)*(n), __alignof__(T)))
+#define ARENA_NEW_DMA(a, T, n) ((T *)arenaAlloc((a), sizeof(T)*(n), 32))
+
+/****************************************************************************
+ * arenaInit
+ *
+ * Allocates both halves of size bytes each in one 32 byte aligned block
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int arenaInit(FrameArena *a, size_t size);
+
+/****************************************************************************
+ * arenaFree
+ *
+ * Releases the memory of the arena
+ ***************************************************************************/
+void arenaFree(FrameArena *a);
+
+/****************************************************************************
+ * arenaReset
+ *
+ * Starts a new frame. Frees everything allocated two resets ago.
+ ***************************************************************************/
+void arenaReset(FrameArena *a);
+
+/****************************************************************************
+ * arenaAlloc
+ *
+ * Allocates size bytes aligned to align, which must be a power of two
+ * returns: NULL if the current half is exhausted
+ ***************************************************************************/
+void *arenaAlloc(FrameArena *a, size_t size, size_t align);
+
+/****************************************************************************
+ * arenaPrintf
+ *
+ * Formats a string into the arena
+ * returns: the string, or an empty string if it did not fit
+ ***************************************************************************/
+char *arenaPrintf(FrameArena *a, const char *fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
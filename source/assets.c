@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "assets.h"
+
+#define STACKSIZE 8192
+
+static const char *asset_dirs[] = { "sd:/", "usb:/" };
+
+static Asset *ld_assets = NULL;
+static int ld_count = 0;
+static u64 ld_start = 0;
+static volatile int ld_running = 0;
+
+static u8 loader_stack[STACKSIZE];
+static lwp_t h_loader = LWP_THREAD_NULL;
+
+static FILE * openAsset(const char *name)
+{
+	char path[256];
+	FILE *f;
+	int i;
+
+	for(i=0; i<(int)(sizeof(asset_dirs)/sizeof(asset_dirs[0])); i++) {
+		snprintf(path, sizeof(path), "%s%s", asset_dirs[i], name);
+		f = fopen(path, "rb");
+		if(f != NULL)
+			return f;
+	}
+	return NULL;
+}
+
+static void loadAsset(Asset *a)
+{
+	FILE *f;
+	s32 size, n, len;
+
+	f = openAsset(a->name);
+	if(f == NULL) {
+		a->state = ASSET_FAILED;
+		return;
+	}
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	a->data = (size > 0) ? memalign(32, (size + 31) & ~31) : NULL;
+	if(a->data == NULL) {
+		fclose(f);
+		a->state = ASSET_FAILED;
+		return;
+	}
+	a->size = size;
+	a->loaded = 0;
+	a->state = ASSET_LOADING;
+
+	for(len=0; len<size && ld_running; len+=n) {
+		n = size - len;
+		if(n > ASSET_CHUNK)
+			n = ASSET_CHUNK;
+		n = fread(a->data + len, 1, n, f);
+		if(n <= 0)
+			break;
+
+		// Make the bytes visible before announcing them
+		__sync_synchronize();
+		a->loaded = len + n;
+		if(len == 0)
+			a->first_us = diff_usec(ld_start, gettime());
+	}
+	fclose(f);
+
+	if(len < size) {
+		a->loaded = -1;
+		a->state = ASSET_FAILED;
+		return;
+	}
+
+	// Sound data is read by DMA
+	DCFlushRange(a->data, size);
+	a->load_us = diff_usec(ld_start, gettime());
+	a->state = ASSET_READY;
+}
+
+static void * loader_thread(void *arg)
+{
+	int i;
+
+	for(i=0; i<ld_count && ld_running; i++)
+		loadAsset(&ld_assets[i]);
+	return NULL;
+}
+
+int assetsStart(Asset *assets, int count)
+{
+	int i;
+
+	assetsFree();
+
+	for(i=0; i<count; i++) {
+		assets[i].data = NULL;
+		assets[i].size = 0;
+		assets[i].loaded = 0;
+		assets[i].state = ASSET_PENDING;
+		assets[i].first_us = 0;
+		assets[i].load_us = 0;
+	}
+	ld_assets = assets;
+	ld_count = count;
+	ld_start = gettime();
+	ld_running = 1;
+
+	// Below the game loop, the SD card is slow but never urgent
+	if(LWP_CreateThread(&h_loader, loader_thread, NULL,
+			loader_stack, STACKSIZE, 40) == -1)
+	{
+		h_loader = LWP_THREAD_NULL;
+		ld_running = 0;
+		for(i=0; i<count; i++)
+			assets[i].state = ASSET_FAILED;
+		return -1;
+	}
+	return 0;
+}
+
+void assetsFree()
+{
+	int i;
+
+	ld_running = 0;
+	if(h_loader != LWP_THREAD_NULL) {
+		LWP_JoinThread(h_loader, NULL);
+		h_loader = LWP_THREAD_NULL;
+	}
+	for(i=0; i<ld_count; i++) {
+		free(ld_assets[i].data);
+		ld_assets[i].data = NULL;
+	}
+	ld_assets = NULL;
+	ld_count = 0;
+}
@@ -0,0 +1,53 @@
+#ifndef __ASSETS_H__
+#define __ASSETS_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ASSET_CHUNK (32*1024)	// bytes read from storage at a time
+
+enum {
+	ASSET_PENDING = 0,	// not opened yet
+	ASSET_LOADING,		// size and data are valid, loaded is growing
+	ASSET_READY,		// completely loaded
+	ASSET_FAILED		// not found or read error, see loaded
+};
+
+typedef struct {
+	const char *name;		// file name, looked up in every storage device
+	u8 *data;				// 32 byte aligned, flushed once READY
+	s32 size;				// file size in bytes
+	volatile s32 loaded;	// bytes available in data, -1 after a read error
+	volatile int state;		// ASSET_*
+	u32 first_us;			// time from assetsStart() to the first chunk
+	u32 load_us;			// time from assetsStart() to READY
+} Asset;
+
+/****************************************************************************
+ * assetsStart
+ *
+ * Starts a thread that loads assets one after the other, trying "sd:/"
+ * first and "usb:/" second. Every chunk is published through loaded as
+ * soon as it has been read, so consumers can start early. The assets
+ * array must stay valid until assetsFree().
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int assetsStart(Asset *assets, int count);
+
+/****************************************************************************
+ * assetsFree
+ *
+ * Stops the loader and frees the data of all assets. Nothing may use the
+ * data anymore, e.g. music streaming from an asset must be stopped.
+ ***************************************************************************/
+void assetsFree();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
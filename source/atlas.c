@@ -0,0 +1,39 @@
+#include <string.h>
+#include "atlas.h"
+
+int atlasCount(const void *blob)
+{
+	const AtlasHeader *hdr = blob;
+
+	if(hdr == NULL || hdr->magic != ATLAS_MAGIC || hdr->version != ATLAS_VERSION)
+		return 0;
+	return hdr->count;
+}
+
+int atlasGet(const void *blob, int index, Sprite *spr)
+{
+	const AtlasEntry *e;
+
+	if(index < 0 || index >= atlasCount(blob))
+		return -1;
+
+	e = (const AtlasEntry *)((const AtlasHeader *)blob + 1) + index;
+	spr->width = e->width;
+	spr->height = e->height;
+	spr->pitch = e->pitch;
+	spr->flags = e->flags;
+	spr->key = e->key;
+	spr->data = (const u32 *)((const u8 *)blob + e->offset);
+	return 0;
+}
+
+int atlasFind(const void *blob, const char *name)
+{
+	int i, n = atlasCount(blob);
+	const AtlasEntry *e = (const AtlasEntry *)((const AtlasHeader *)blob + 1);
+
+	for(i=0; i<n; i++)
+		if(strncmp(e[i].name, name, ATLAS_NAME_LEN) == 0)
+			return i;
+	return -1;
+}
@@ -0,0 +1,76 @@
+#ifndef __ATLAS_H__
+#define __ATLAS_H__
+
+#include <stdint.h>
+#include "color.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * Layout of a sprite atlas blob as written by tools/atlaspack:              *
+ *                                                                           *
+ *		AtlasHeader                      32 bytes                            *
+ *		AtlasEntry[count]                32 bytes each                       *
+ *		pixel data                       YUY2 pairs, every image starting    *
+ *		                                 on a 32 byte boundary               *
+ *                                                                           *
+ * All values are big endian, i.e. native on the Wii, so the blob is used    *
+ * in place straight from the data segment without any fixups.               *
+ *****************************************************************************/
+
+#define ATLAS_MAGIC    0x41544c53 // 'ATLS'
+#define ATLAS_VERSION  1
+#define ATLAS_ALIGN    32
+#define ATLAS_NAME_LEN 16
+#define ATLAS_KEY      0x00000000 // Y=0 with zero chroma, no RGB colour maps here
+
+typedef struct {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count;        // number of entries
+	uint32_t size;         // total blob size in bytes
+	uint32_t reserved[5];
+} AtlasHeader;
+
+typedef struct {
+	uint16_t width;        // in pixels
+	uint16_t height;
+	uint16_t pitch;        // u32 words per row
+	uint16_t flags;        // SPRITE_* flags
+	uint32_t key;          // colour key for SPRITE_KEYED
+	uint32_t offset;       // of the first pixel pair, from the blob start
+	char name[ATLAS_NAME_LEN];
+} AtlasEntry;
+
+/****************************************************************************
+ * atlasCount
+ *
+ * returns: number of images in the atlas, 0 if blob is not a valid atlas
+ ***************************************************************************/
+int atlasCount(const void *blob);
+
+/****************************************************************************
+ * atlasGet
+ *
+ * Points spr at image index inside the blob. No pixel data is copied.
+ * returns: -1 if index is out of range, 0 on success
+ ***************************************************************************/
+int atlasGet(const void *blob, int index, Sprite *spr);
+
+/****************************************************************************
+ * atlasFind
+ *
+ * Looks an image up by the name it was packed with (file name without
+ * extension). Prefer the generated index constants in hot code.
+ * returns: index of the image, -1 if there is none with that name
+ ***************************************************************************/
+int atlasFind(const void *blob, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+#include "beam.h"
+
+void beamInit(BeamRace *br, BeamLineFn line, int height, int band_lines)
+{
+	br->line = line;
+	br->height = height;
+	br->band_lines = band_lines;
+	br->frames = 0;
+	br->bands = 0;
+	br->late = 0;
+	br->min_slack = height;
+}
+
+int beamRace(BeamRace *br, BeamDrawFn draw, void *arg)
+{
+	int y1, y2, slack, late = 0;
+
+	for(y1 = 0; y1 < br->height; y1 += br->band_lines) {
+		y2 = y1 + br->band_lines - 1;
+		if(y2 >= br->height)
+			y2 = br->height - 1;
+
+		draw(y1, y2, arg);
+
+		// The band is on screen this frame only if the beam has not got to
+		// its first line yet
+		slack = y1 - br->line();
+		if(slack < br->min_slack)
+			br->min_slack = slack;
+		if(slack <= 0)
+			late++;
+		br->bands++;
+	}
+	br->late += late;
+	br->frames++;
+	return late;
+}
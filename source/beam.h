@@ -0,0 +1,62 @@
+#ifndef __BEAM_H__
+#define __BEAM_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * Beam racing: the frame is drawn straight into the buffer that is being    *
+ * scanned out, band by band from the top, each band finished before the     *
+ * video beam gets to it. Compared to double buffering this saves the frame  *
+ * the picture otherwise waits in the back buffer.                           *
+ *****************************************************************************/
+
+// Returns the beam position in framebuffer lines, 0 being the first visible
+// line of the field the race started in. Negative during the vertical blank
+// before the picture, height or more after its last line. Has to keep
+// counting through the following fields: a line counter that starts over
+// with every field cannot tell a band that took a whole field from one
+// that took none.
+typedef int (*BeamLineFn)(void);
+
+// Draws the framebuffer lines y1..y2, inclusive
+typedef void (*BeamDrawFn)(int y1, int y2, void *arg);
+
+typedef struct {
+	BeamLineFn line;
+	int height;			// framebuffer lines
+	int band_lines;		// lines per band
+	u32 frames;			// frames raced so far
+	u32 bands;			// bands drawn so far
+	u32 late;			// bands that were done after the beam reached them
+	int min_slack;		// least lines the beam was away from a finished band
+} BeamRace;
+
+/****************************************************************************
+ * beamInit
+ *
+ * Sets up racing for a framebuffer of height lines, drawn in bands of
+ * band_lines lines, and resets the statistics
+ ***************************************************************************/
+void beamInit(BeamRace *br, BeamLineFn line, int height, int band_lines);
+
+/****************************************************************************
+ * beamRace
+ *
+ * Calls draw for every band from top to bottom and records how close the
+ * beam came to each of them. Must be called once the previous frame has
+ * been scanned out, i.e. right after VIDEO_WaitVSync(), and returns as
+ * soon as the last band is drawn.
+ * returns: number of bands of this frame that were late
+ ***************************************************************************/
+int beamRace(BeamRace *br, BeamDrawFn draw, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "boot.h"
+
+static u8 boot_stacks[BOOT_MAX_THREADS][BOOT_STACKSIZE];
+static int boot_threads = 0;		// stacks in use
+static u64 boot_start;
+
+static void runStep(BootStep *s)
+{
+	u64 t = gettime();
+
+	s->start_us = diff_usec(boot_start, t);
+	s->run();
+	s->us = diff_usec(t, gettime());
+	s->done = 1;
+}
+
+static void * stepThread(void *arg)
+{
+	runStep((BootStep *)arg);
+	return NULL;
+}
+
+static void startStep(BootStep *s)
+{
+	s->thread = LWP_THREAD_NULL;
+	if(s->prio && boot_threads < BOOT_MAX_THREADS) {
+		if(LWP_CreateThread(&s->thread, stepThread, s, boot_stacks[boot_threads],
+				BOOT_STACKSIZE, s->prio) != -1) {
+			boot_threads++;
+			return;
+		}
+		s->thread = LWP_THREAD_NULL;
+	}
+	runStep(s);
+}
+
+// Steps whose bit is set have finished
+static u32 doneSteps(const BootStep *steps, int count)
+{
+	u32 done = 0;
+	int i;
+
+	for(i=0; i<count; i++)
+		if(steps[i].done)
+			done |= BOOT_AFTER(i);
+	return done;
+}
+
+int bootRun(BootStep *steps, int count)
+{
+	u32 started = 0, all, done, waiting;
+	int i;
+
+	if(count < 0 || count > BOOT_MAX_STEPS)
+		return -1;
+	all = BOOT_AFTER(count) - 1;
+	for(i=0; i<count; i++) {
+		steps[i].done = 0;
+		steps[i].thread = LWP_THREAD_NULL;
+	}
+
+	boot_start = gettime();
+	while(started != all) {
+		// A thread that can start first, else the first step in the table
+		// that can run now
+		done = doneSteps(steps, count);
+		for(i=0; i<count; i++)
+			if(!(started & BOOT_AFTER(i)) && (steps[i].after & ~done) == 0 && steps[i].prio)
+				break;
+		if(i == count)
+			for(i=0; i<count; i++)
+				if(!(started & BOOT_AFTER(i)) && (steps[i].after & ~done) == 0)
+					break;
+		if(i < count) {
+			started |= BOOT_AFTER(i);
+			startStep(&steps[i]);
+			continue;
+		}
+
+		// Everything left waits for a thread, or for a step that never runs
+		waiting = 0;
+		for(i=0; i<count; i++)
+			if(!(started & BOOT_AFTER(i)))
+				waiting |= steps[i].after;
+		for(i=0; i<count; i++)
+			if((waiting & BOOT_AFTER(i)) && !steps[i].done && steps[i].thread != LWP_THREAD_NULL)
+				break;
+		if(i == count)
+			return -1;
+		LWP_JoinThread(steps[i].thread, NULL);
+		steps[i].thread = LWP_THREAD_NULL;
+	}
+	return 0;
+}
+
+void bootJoin(BootStep *steps, int count)
+{
+	int i;
+
+	for(i=0; i<count; i++) {
+		if(steps[i].thread != LWP_THREAD_NULL)
+			LWP_JoinThread(steps[i].thread, NULL);
+		steps[i].thread = LWP_THREAD_NULL;
+	}
+	boot_threads = 0;
+}
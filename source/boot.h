@@ -0,0 +1,52 @@
+#ifndef __BOOT_H__
+#define __BOOT_H__
+
+#include <gccore.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BOOT_MAX_STEPS   16
+#define BOOT_MAX_THREADS 2		// steps that can get a thread of their own
+#define BOOT_STACKSIZE   8192
+
+#define BOOT_AFTER(step) (1u << (step))
+
+typedef struct {
+	const char *name;
+	void (*run)(void);
+	u32 after;				// BOOT_AFTER() of every step to finish first
+	u8 prio;				// runs on a thread of this priority, 0 in line
+	u32 start_us;			// from bootRun() to the start of the step
+	u32 us;					// time the step took
+	volatile int done;
+	lwp_t thread;
+} BootStep;
+
+/****************************************************************************
+ * bootRun
+ *
+ * Runs the startup steps in the order their dependencies allow. Steps
+ * without a priority run in line, in table order as soon as everything
+ * they come after is done, so steps that mostly wait belong at the end.
+ * Steps with a priority start on their own thread as soon as they can and
+ * may still be running on return; a step waiting for one of them joins
+ * it. Without a free stack or thread a step runs in line instead.
+ * returns: -1 if the dependencies cannot be met, 0 on success
+ ***************************************************************************/
+int bootRun(BootStep *steps, int count);
+
+/****************************************************************************
+ * bootJoin
+ *
+ * Waits for the steps that bootRun() left running on their threads.
+ ***************************************************************************/
+void bootJoin(BootStep *steps, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "capture.h"
+#include "rle.h"
+
+#define CAPTURE_BUFFERS 2
+#define STACKSIZE       (32*1024)	// fwrite() through libfat needs a deep stack
+
+typedef struct {
+	CaptureFrame hdr;
+	u32 *data;
+	volatile int full;	// set by the game loop, cleared by the writer
+} CaptureBuffer;
+
+static FILE *cap_file = NULL;
+static u32 *cap_ref = NULL;			// last recorded frame
+static CaptureBuffer cap_buf[CAPTURE_BUFFERS];
+static int cap_words = 0;
+static int cap_next = 0;			// buffer the next frame is encoded into
+static u32 cap_frame = 0;
+static u32 cap_dropped = 0;
+static u32 cap_encode_us = 0;		// cost of the last captureFrame()
+static volatile int cap_running = 0;
+
+static u8 capture_stack[STACKSIZE];
+static lwp_t h_capture = LWP_THREAD_NULL;
+static mutex_t cap_mutex = LWP_MUTEX_NULL;
+static cond_t cap_cond = LWP_COND_NULL;
+
+static void freeBuffers()
+{
+	int i;
+	for(i=0; i<CAPTURE_BUFFERS; i++) {
+		free(cap_buf[i].data);
+		cap_buf[i].data = NULL;
+		cap_buf[i].full = 0;
+	}
+	free(cap_ref);
+	cap_ref = NULL;
+}
+
+/*****************************************************************************
+ * Writer thread: takes the buffers in the order they were filled, so the    *
+ * game loop never waits for the SD card.                                    *
+ *****************************************************************************/
+static void * capture_thread(void *arg)
+{
+	int w = 0;
+	CaptureBuffer *b;
+
+	for(;;) {
+		b = &cap_buf[w];
+
+		LWP_MutexLock(cap_mutex);
+		while(!b->full && cap_running)
+			LWP_CondWait(cap_cond, cap_mutex);
+		LWP_MutexUnlock(cap_mutex);
+
+		if(!b->full)
+			break; // stopped and drained
+
+		fwrite(&b->hdr, sizeof(CaptureFrame), 1, cap_file);
+		fwrite(b->data, sizeof(u32), b->hdr.words, cap_file);
+
+		LWP_MutexLock(cap_mutex);
+		b->full = 0;
+		LWP_MutexUnlock(cap_mutex);
+		w = (w + 1) % CAPTURE_BUFFERS;
+	}
+	return 0;
+}
+
+int captureStart(const char *path, int fb_width, int fb_height)
+{
+	CaptureHeader hdr;
+	int i;
+
+	captureStop();
+
+	cap_words = (fb_width >> 1) * fb_height;
+	cap_ref = memalign(32, cap_words * sizeof(u32));
+	for(i=0; i<CAPTURE_BUFFERS; i++)
+		cap_buf[i].data = memalign(32, RLE_MAX_WORDS(cap_words) * sizeof(u32));
+	for(i=0; i<CAPTURE_BUFFERS; i++)
+		if(cap_buf[i].data == NULL)
+			break;
+	if(cap_ref == NULL || i < CAPTURE_BUFFERS) {
+		freeBuffers();
+		return -1;
+	}
+
+	cap_file = fopen(path, "wb");
+	if(cap_file == NULL) {
+		freeBuffers();
+		return -1;
+	}
+	setvbuf(cap_file, NULL, _IOFBF, 64*1024);
+
+	hdr.magic = CAPTURE_MAGIC;
+	hdr.version = CAPTURE_VERSION;
+	hdr.reserved = 0;
+	hdr.width = fb_width;
+	hdr.height = fb_height;
+	hdr.words = cap_words;
+	fwrite(&hdr, sizeof(hdr), 1, cap_file);
+
+	// The delta chain starts from a black screen
+	for(i=0; i<cap_words; i++)
+		cap_ref[i] = CAPTURE_BLACK;
+
+	cap_next = 0;
+	cap_frame = 0;
+	cap_dropped = 0;
+	cap_encode_us = 0;
+	cap_running = 1;
+
+	LWP_MutexInit(&cap_mutex, false);
+	LWP_CondInit(&cap_cond);
+	if(LWP_CreateThread(&h_capture, capture_thread, NULL,
+			capture_stack, STACKSIZE, 40) == -1)
+	{
+		h_capture = LWP_THREAD_NULL;
+		captureStop();
+		return -1;
+	}
+	return 0;
+}
+
+void captureFrame(void *fb)
+{
+	CaptureBuffer *b;
+	u32 *src;
+	u64 start;
+
+	if(!cap_running)
+		return;
+
+	b = &cap_buf[cap_next];
+	if(b->full) {
+		// Writer is behind, skip this frame rather than stall the loop
+		cap_dropped++;
+		cap_frame++;
+		return;
+	}
+
+	// Read through the cached mapping, uncached reads would dominate the cost
+	start = gettime();
+	src = MEM_K1_TO_K0(fb);
+	DCInvalidateRange(src, cap_words * sizeof(u32));
+
+	b->hdr.frame = cap_frame++;
+	b->hdr.words = rleEncode(src, cap_ref, cap_words, b->data);
+	cap_encode_us = diff_usec(start, gettime());
+
+	LWP_MutexLock(cap_mutex);
+	b->full = 1;
+	LWP_CondSignal(cap_cond);
+	LWP_MutexUnlock(cap_mutex);
+
+	cap_next = (cap_next + 1) % CAPTURE_BUFFERS;
+}
+
+void captureStop()
+{
+	if(h_capture != LWP_THREAD_NULL)
+	{
+		LWP_MutexLock(cap_mutex);
+		cap_running = 0;
+		LWP_CondSignal(cap_cond);
+		LWP_MutexUnlock(cap_mutex);
+		LWP_JoinThread(h_capture, NULL);
+		h_capture = LWP_THREAD_NULL;
+	}
+	cap_running = 0;
+
+	if(cap_cond != LWP_COND_NULL)
+	{
+		LWP_CondDestroy(cap_cond);
+		cap_cond = LWP_COND_NULL;
+	}
+	if(cap_mutex != LWP_MUTEX_NULL)
+	{
+		LWP_MutexDestroy(cap_mutex);
+		cap_mutex = LWP_MUTEX_NULL;
+	}
+	if(cap_file != NULL)
+	{
+		fclose(cap_file);
+		cap_file = NULL;
+	}
+	freeBuffers();
+}
+
+int captureActive()
+{
+	return cap_running;
+}
+
+u32 captureDropped()
+{
+	return cap_dropped;
+}
+
+u32 captureEncodeUs()
+{
+	return cap_encode_us;
+}
@@ -0,0 +1,93 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * Capture stream layout, all values big endian:                             *
+ *                                                                           *
+ *		CaptureHeader                                                        *
+ *		{ CaptureFrame, rle tokens[CaptureFrame.words] } ...                 *
+ *                                                                           *
+ * Every frame is rle coded against the previously recorded one, starting    *
+ * from an all black framebuffer (CAPTURE_BLACK). Frames that could not be   *
+ * recorded in time leave a gap in the frame numbers but do not break the    *
+ * delta chain.                                                              *
+ *****************************************************************************/
+
+#define CAPTURE_MAGIC   0x46424353 // 'FBCS'
+#define CAPTURE_VERSION 2
+#define CAPTURE_BLACK   0x10801080 // CLEAR_BLACK, first reference frame
+
+typedef struct {
+	u32 magic;
+	u16 version;
+	u16 reserved;
+	u16 width;         // framebuffer width in pixels
+	u16 height;        // framebuffer height in lines
+	u32 words;         // u32 words per frame
+} CaptureHeader;
+
+typedef struct {
+	u32 frame;         // number of captureFrame() calls before this one
+	u32 words;         // rle payload size in u32 words
+} CaptureFrame;
+
+/****************************************************************************
+ * captureStart
+ *
+ * Opens path and starts recording. Encoding happens in captureFrame(),
+ * file output on a separate writer thread.
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int captureStart(const char *path, int fb_width, int fb_height);
+
+/****************************************************************************
+ * captureFrame
+ *
+ * Records the framebuffer fb. Meant to be called right after VIDEO_Flush().
+ * If the writer thread still holds both buffers the frame is dropped.
+ ***************************************************************************/
+void captureFrame(void *fb);
+
+/****************************************************************************
+ * captureStop
+ *
+ * Writes all pending frames, closes the file and stops the writer thread
+ ***************************************************************************/
+void captureStop();
+
+/****************************************************************************
+ * captureActive
+ *
+ * returns: 1 while a capture is running, 0 otherwise
+ ***************************************************************************/
+int captureActive();
+
+/****************************************************************************
+ * captureDropped
+ *
+ * returns: number of frames dropped during the current or last capture
+ ***************************************************************************/
+u32 captureDropped();
+
+/****************************************************************************
+ * captureEncodeUs
+ *
+ * The frame is encoded on the game loop so that it is read before the GPU
+ * clears it again; this is the time that took, in microseconds, for the
+ * last recorded frame. tools/capbench measures the same on the host.
+ * returns: microseconds spent in the last captureFrame() that recorded
+ ***************************************************************************/
+u32 captureEncodeUs();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
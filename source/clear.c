@@ -0,0 +1,119 @@
+#include <malloc.h>
+#include <string.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "clear.h"
+#include "color.h"
+
+/*****************************************************************************
+ * Nothing is ever rendered into the embedded framebuffer (EFB), so after    *
+ * the first copy it holds nothing but the copy clear color. Copying it to   *
+ * an external framebuffer therefore clears that buffer. The copy runs on    *
+ * the GPU, so the CPU can poll input and simulate in the meantime and only  *
+ * has to wait for the draw done token before it starts drawing.             *
+ *****************************************************************************/
+
+static void *gp_fifo = NULL;
+static int clear_pending = 0;
+static u32 clear_pitch = 0;		// bytes per framebuffer line
+static u32 clear_lines = 0;		// lines per framebuffer
+static u32 clear_wait_us = 0;	// last time clearWait() blocked
+static u32 clear_cpu_us = 0;	// one VIDEO_ClearFrameBuffer() at init
+static u32 clear_decay_us = 0;	// last clearDecay(), the first at init
+
+void clearInit(GXRModeObj *vmode, void *xfb[2], GXColor color)
+{
+	f32 yscale;
+	u32 xfb_height;
+	u64 start;
+
+	// For comparison, what clearing on the CPU costs
+	start = gettime();
+	VIDEO_ClearFrameBuffer(vmode, xfb[0], CLEAR_BLACK);
+	clear_cpu_us = diff_usec(start, gettime());
+
+	gp_fifo = memalign(32, DEFAULT_FIFO_SIZE);
+	memset(gp_fifo, 0, DEFAULT_FIFO_SIZE);
+	GX_Init(gp_fifo, DEFAULT_FIFO_SIZE);
+
+	// The EFB has fewer lines than some xfbHeights, scale the copy up
+	yscale = GX_GetYScaleFactor(vmode->efbHeight, vmode->xfbHeight);
+	xfb_height = GX_SetDispCopyYScale(yscale);
+	GX_SetDispCopySrc(0, 0, vmode->fbWidth, vmode->efbHeight);
+	GX_SetDispCopyDst(vmode->fbWidth, xfb_height);
+	GX_SetCopyFilter(vmode->aa, vmode->sample_pattern, GX_TRUE, vmode->vfilter);
+	GX_SetFieldMode(vmode->field_rendering,
+			((vmode->viHeight == 2*vmode->xfbHeight) ? GX_ENABLE : GX_DISABLE));
+	GX_SetCopyClear(color, 0x00ffffff);
+
+	// First copy only clears the EFB, the following ones clear the buffers
+	GX_CopyDisp(xfb[0], GX_TRUE);
+	GX_CopyDisp(xfb[0], GX_TRUE);
+	GX_CopyDisp(xfb[1], GX_TRUE);
+	GX_DrawDone();
+	clear_pending = 0;
+	clear_pitch = vmode->fbWidth * VI_DISPLAY_PIX_SZ;
+	clear_lines = vmode->xfbHeight;
+
+	// What a fade costs is known before the first one is asked for
+	clearDecay(xfb[1], xfb[0], 0);
+}
+
+void clearStart(void *xfb)
+{
+	GX_CopyDisp(xfb, GX_TRUE);
+	GX_SetDrawDone();
+	clear_pending = 1;
+}
+
+void clearWait()
+{
+	u64 start;
+
+	clear_wait_us = 0;
+	if(clear_pending) {
+		start = gettime();
+		GX_WaitDrawDone();
+		clear_wait_us = diff_usec(start, gettime());
+		clear_pending = 0;
+	}
+}
+
+void clearDecay(void *dst, const void *src, int k)
+{
+	u32 *d = MEM_K1_TO_K0(dst);
+	const u32 *s = MEM_K1_TO_K0(src);
+	u32 line;
+	int n = clear_pitch / 4;
+	u64 start = gettime();
+
+	// Both buffers are mapped uncached, which would make every access a
+	// bus transaction. Go through the cache a line at a time instead:
+	// invalidate the source before reading it, zero the destination so
+	// writing it does not fetch it from memory first, and flush it after.
+	for(line = 0; line < clear_lines; line++) {
+		DCInvalidateRange((void *)s, clear_pitch);
+		DCZeroRange(d, clear_pitch);
+		colorDecay(d, s, n, k, CLEAR_BLACK);
+		DCFlushRange(d, clear_pitch);
+		d += n;
+		s += n;
+	}
+	clear_decay_us = diff_usec(start, gettime());
+}
+
+u32 clearWaitUs()
+{
+	return clear_wait_us;
+}
+
+u32 clearCpuUs()
+{
+	return clear_cpu_us;
+}
+
+u32 clearDecayUs()
+{
+	return clear_decay_us;
+}
@@ -0,0 +1,77 @@
+#ifndef __CLEAR_H__
+#define __CLEAR_H__
+
+#include <gccore.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// What the copy writes for RGB black: the copy converts to video range
+// YUV, so luma never goes below 16. CPU paths that fill with black use
+// this rather than COLOR_BLACK (Y=0) so that both look the same.
+#define CLEAR_BLACK 0x10801080
+
+/****************************************************************************
+ * clearInit
+ *
+ * Sets up the GX embedded framebuffer copy that is used to clear external
+ * framebuffers to color, and clears both buffers in xfb right away. Before
+ * that it times one CPU clear of xfb[0], see clearCpuUs().
+ ***************************************************************************/
+void clearInit(GXRModeObj *vmode, void *xfb[2], GXColor color);
+
+/****************************************************************************
+ * clearStart
+ *
+ * Queues a clear of xfb on the GPU and returns immediately
+ ***************************************************************************/
+void clearStart(void *xfb);
+
+/****************************************************************************
+ * clearWait
+ *
+ * Blocks until the last clear has been written to memory. Must be called
+ * before the CPU draws into the framebuffer passed to clearStart().
+ ***************************************************************************/
+void clearWait();
+
+/****************************************************************************
+ * clearDecay
+ *
+ * Fills dst with src faded by k/256 toward CLEAR_BLACK, instead of clearing
+ * it. Runs on the CPU and returns when dst is in memory. k = 0 gives the
+ * same frame as a clear, k = 256 a plain copy.
+ ***************************************************************************/
+void clearDecay(void *dst, const void *src, int k);
+
+/****************************************************************************
+ * clearDecayUs
+ *
+ * returns: microseconds the last clearDecay() took, one is timed in
+ *          clearInit()
+ ***************************************************************************/
+u32 clearDecayUs();
+
+/****************************************************************************
+ * clearWaitUs
+ *
+ * returns: microseconds the last clearWait() blocked for the GPU, the part
+ *          of the clear that did not overlap with the simulation
+ ***************************************************************************/
+u32 clearWaitUs();
+
+/****************************************************************************
+ * clearCpuUs
+ *
+ * returns: microseconds VIDEO_ClearFrameBuffer() took for one buffer in
+ *          clearInit(), what every frame cost before the GPU clear
+ ***************************************************************************/
+u32 clearCpuUs();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
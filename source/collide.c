@@ -0,0 +1,174 @@
+#include "collide.h"
+
+#define T_NEG_INF (-0x7fffffff)
+#define T_POS_INF ( 0x7fffffff)
+
+#define COLLIDE_MAX_CONTACTS 8	// followed per ball and frame
+
+/*****************************************************************************
+ * Entry and exit time along one axis for a box [a, a+len) moving by d       *
+ * towards the box [b, b+blen). Returns 0 if they never overlap on it.       *
+ *****************************************************************************/
+static int axisTimes(int a, int len, int d, int b, int blen, int *entry, int *exit)
+{
+	if(d > 0) {
+		*entry = (b - (a + len)) * COLLIDE_ONE / d;
+		*exit = (b + blen - a) * COLLIDE_ONE / d;
+	}
+	else if(d < 0) {
+		*entry = (b + blen - a) * COLLIDE_ONE / d;
+		*exit = (b - (a + len)) * COLLIDE_ONE / d;
+	}
+	else {
+		if(a + len <= b || a >= b + blen)
+			return 0;
+		*entry = T_NEG_INF;
+		*exit = T_POS_INF;
+	}
+	return 1;
+}
+
+/*****************************************************************************
+ * Like sweepBox(), but only contacts at or after time from count            *
+ *****************************************************************************/
+static int sweepFrom(const Particle *p, const Particle *q, int from, int *axis)
+{
+	int ex, xx, ey, xy, entry, exit;
+
+	if(!axisTimes(p->pos_x, p->size_x, p->dx, q->pos_x, q->size_x, &ex, &xx) ||
+	   !axisTimes(p->pos_y, p->size_y, p->dy, q->pos_y, q->size_y, &ey, &xy))
+		return -1;
+
+	entry = (ex >= ey) ? ex : ey;
+	exit = (xx <= xy) ? xx : xy;
+	if(entry >= exit || entry < from || entry > COLLIDE_ONE)
+		return -1;
+
+	*axis = (ex >= ey) ? 0 : 1;
+	return entry;
+}
+
+int sweepBox(const Particle *p, const Particle *q, int *axis)
+{
+	return sweepFrom(p, q, 0, axis);
+}
+
+/*****************************************************************************
+ * Time at which a box [a, a+len) moving by d reaches the border lo or hi it *
+ * is heading for. plane receives the position of the box at that time.      *
+ *****************************************************************************/
+static int borderTime(int a, int len, int d, int lo, int hi, int *plane)
+{
+	if(d > 0) {
+		*plane = hi - len;
+		return (hi - len - a) * COLLIDE_ONE / d;
+	}
+	if(d < 0) {
+		*plane = lo;
+		return (lo - a) * COLLIDE_ONE / d;
+	}
+	return T_POS_INF;
+}
+
+/*****************************************************************************
+ * Reflects coordinate v into [lo, hi], flipping the velocity once per       *
+ * bounce. Several bounces are possible for very fast or very large balls.   *
+ *****************************************************************************/
+static int mirror(int *v, int *d, int lo, int hi)
+{
+	int bounced = 0;
+
+	if(hi < lo) {
+		*v = lo;
+		return 0;
+	}
+	while(*v < lo || *v > hi) {
+		*v = (*v < lo) ? 2*lo - *v : 2*hi - *v;
+		*d = -*d;
+		bounced = 1;
+	}
+	return bounced;
+}
+
+void collideStep(Particle *items, const u8 *types, int count, int max_balls,
+                 Particle *const *paddles, int num_paddles,
+                 const CollideBounds *bounds, u8 *hits)
+{
+	int i, j, k, n, t, axis, from, best, best_axis, best_plane, best_flag, plane;
+	Particle *p, *q, v;
+
+	if(num_paddles > COLLIDE_MAX_PADDLES)
+		num_paddles = COLLIDE_MAX_PADDLES;
+
+	for(i=0, n=0; i<count; i++) {
+		hits[i] = 0;
+		if(types[i] != ENTITY_BALL || n >= max_balls)
+			continue;
+		p = &items[i];
+		n++;
+
+		// Follow the path through the frame one contact at a time. v is
+		// where the ball would have started, had it always moved the way it
+		// does after the contacts so far, so every contact mirrors v about
+		// the contact plane and the ball ends the frame at v + (dx, dy).
+		v = *p;
+		for(j=0, from=0; j<COLLIDE_MAX_CONTACTS; j++) {
+			best = COLLIDE_ONE + 1;
+			best_axis = -1;
+			best_plane = best_flag = 0;
+
+			t = borderTime(v.pos_x, v.size_x, v.dx, bounds->l, bounds->r, &plane);
+			if(t >= from && t < best) {
+				best = t;
+				best_axis = 0;
+				best_plane = plane;
+				best_flag = COLLIDE_BORDER_X;
+			}
+			t = borderTime(v.pos_y, v.size_y, v.dy, bounds->t, bounds->b, &plane);
+			if(t >= from && t < best) {
+				best = t;
+				best_axis = 1;
+				best_plane = plane;
+				best_flag = COLLIDE_BORDER_Y;
+			}
+			for(k=0; k<num_paddles; k++) {
+				q = paddles[k];
+				t = sweepFrom(&v, q, from, &axis);
+				if(t < 0 || t >= best)
+					continue;
+				best = t;
+				best_axis = axis;
+				if(axis == 0)
+					best_plane = (v.dx > 0) ? q->pos_x - v.size_x : q->pos_x + q->size_x;
+				else
+					best_plane = (v.dy > 0) ? q->pos_y - v.size_y : q->pos_y + q->size_y;
+				best_flag = COLLIDE_PADDLE;
+			}
+			if(best_axis < 0)
+				break;
+
+			if(best_axis == 0) {
+				v.pos_x = 2*best_plane - v.pos_x;
+				v.dx = -v.dx;
+			}
+			else {
+				v.pos_y = 2*best_plane - v.pos_y;
+				v.dy = -v.dy;
+			}
+			hits[i] |= best_flag;
+			from = best;
+		}
+
+		p->pos_x = v.pos_x + v.dx;
+		p->pos_y = v.pos_y + v.dy;
+		p->dx = v.dx;
+		p->dy = v.dy;
+
+		// Balls outside the playfield to begin with, or with more contacts
+		// than followed, are mirrored back in directly
+		if(mirror(&p->pos_x, &p->dx, bounds->l, bounds->r - p->size_x))
+			hits[i] |= COLLIDE_BORDER_X;
+		if(mirror(&p->pos_y, &p->dy, bounds->t, bounds->b - p->size_y))
+			hits[i] |= COLLIDE_BORDER_Y;
+	}
+}
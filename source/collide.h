@@ -0,0 +1,57 @@
+#ifndef __COLLIDE_H__
+#define __COLLIDE_H__
+
+#include <gctypes.h>
+#include "entity.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define COLLIDE_MAX_PADDLES 8
+
+// Contact flags reported per particle
+#define COLLIDE_BORDER_X 1
+#define COLLIDE_BORDER_Y 2
+#define COLLIDE_PADDLE   4
+
+// Time of impact is 16.16 fixed point, COLLIDE_ONE is the end of the frame
+#define COLLIDE_ONE (1<<16)
+
+typedef struct {
+	int l, t, r, b;		// playfield borders
+} CollideBounds;
+
+/****************************************************************************
+ * sweepBox
+ *
+ * Swept AABB test of box p moving by (p->dx, p->dy) during one frame
+ * against the static box q.
+ * axis - set to 0 if the contact is on a vertical face of q, 1 otherwise
+ * returns: time of impact in [0, COLLIDE_ONE], -1 if there is no contact
+ *          within this frame or the boxes already overlap
+ ***************************************************************************/
+int sweepBox(const Particle *p, const Particle *q, int *axis);
+
+/****************************************************************************
+ * collideStep
+ *
+ * Moves the first max_balls entities of type ENTITY_BALL in items by one
+ * frame. Contacts with paddles are found by sweeping every ball against
+ * every paddle, so nothing tunnels through thin paddles at any speed.
+ * Contacts with borders and paddles are followed in the order they happen,
+ * so a ball coming back from a border is swept again. Reflections mirror
+ * the position about the contact plane, which is the exact result of
+ * bouncing at the time of impact.
+ * hits - receives the COLLIDE_* flags of every entity in items
+ ***************************************************************************/
+void collideStep(Particle *items, const u8 *types, int count, int max_balls,
+                 Particle *const *paddles, int num_paddles,
+                 const CollideBounds *bounds, u8 *hits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
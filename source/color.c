@@ -0,0 +1,212 @@
+#include "color.h"
+
+/*****************************************************************************
+ * Full range BT.601, the same matrix the libogc COLOR_* constants use:      *
+ *                                                                           *
+ *		Y  =  0.299 R + 0.587 G + 0.114 B                                    *
+ *		Cb = -0.169 R - 0.331 G + 0.500 B + 128                              *
+ *		Cr =  0.500 R - 0.419 G - 0.081 B + 128                              *
+ *                                                                           *
+ * with the coefficients scaled by 256. Chroma is computed once per pair     *
+ * from the sum of both pixels, which averages it without a second divide.   *
+ *****************************************************************************/
+
+#define CHROMA_MASK 0x00ff00ff
+
+static inline int clamp8(int v)
+{
+	return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+/*****************************************************************************
+ * Both pixels of a pair go through the matrix at once (SWAR): each channel  *
+ * holds pixel 0 in its upper and pixel 1 in its lower 16 bits, so one       *
+ * multiply-add chain yields both luma values. The weights add up to 256,    *
+ * so a lane never exceeds 255*256+128 and cannot carry into the other one.  *
+ * The chroma sums fall out of the same words by adding the two halves.      *
+ *****************************************************************************/
+static inline u32 pairFromLanes(u32 r, u32 g, u32 b)
+{
+	u32 y = ((77*r + 150*g + 29*b + 0x00800080) >> 8) & 0x00ff00ff;
+	int rs = (r >> 16) + (r & 0xffff);
+	int gs = (g >> 16) + (g & 0xffff);
+	int bs = (b >> 16) + (b & 0xffff);
+	int cb = ((-43*rs -  85*gs + 128*bs + 256) >> 9) + 128;
+	int cr = ((128*rs - 107*gs -  21*bs + 256) >> 9) + 128;
+
+	// y holds Y0 and Y1 in bytes 1 and 3, one shift moves them to 0 and 2
+	return (y << 8) | ((u32)clamp8(cb) << 16) | (u32)clamp8(cr);
+}
+
+static inline u32 pairFromPixels(const u8 *p, const u8 *q)
+{
+	return pairFromLanes((p[0] << 16) | q[0], (p[1] << 16) | q[1], (p[2] << 16) | q[2]);
+}
+
+u32 colorRGBToYUY2(u8 r0, u8 g0, u8 b0, u8 r1, u8 g1, u8 b1)
+{
+	return pairFromLanes((r0 << 16) | r1, (g0 << 16) | g1, (b0 << 16) | b1);
+}
+
+void colorConvertRGBA(const u8 *src, int width, int height, int src_pitch,
+                      u32 *dst, int dst_pitch, u32 key)
+{
+	int x, y;
+	int pairs = width >> 1;
+	const u8 *p, *q;
+	u32 *out;
+
+	for(y=0; y<height; y++) {
+		p = src + y*src_pitch;
+		out = dst + y*dst_pitch;
+
+		// Two pixels per iteration, no branches unless alpha is involved
+		for(x=0; x<pairs; x++, p+=8) {
+			if(p[3] < COLOR_ALPHA_CUTOFF || p[7] < COLOR_ALPHA_CUTOFF) {
+				if(p[3] < COLOR_ALPHA_CUTOFF && p[7] < COLOR_ALPHA_CUTOFF)
+					out[x] = key;
+				else {
+					q = (p[3] < COLOR_ALPHA_CUTOFF) ? p+4 : p;
+					out[x] = pairFromPixels(q, q);
+				}
+				continue;
+			}
+			out[x] = pairFromPixels(p, p+4);
+		}
+
+		// Odd width: the last pixel fills its whole pair
+		if(width & 1)
+			out[x] = (p[3] < COLOR_ALPHA_CUTOFF) ? key : pairFromPixels(p, p);
+	}
+}
+
+/*****************************************************************************
+ * Chroma average of two pairs, both lanes at once                           *
+ *****************************************************************************/
+static inline u32 chromaAvg(u32 a, u32 b)
+{
+	return (((a & CHROMA_MASK) + (b & CHROMA_MASK) + 0x00010001) >> 1) & CHROMA_MASK;
+}
+
+static void blitRowEven(u32 *dst, const u32 *src, int n, int keyed, u32 key)
+{
+	int i;
+	if(!keyed) {
+		for(i=0; i<n; i++)
+			dst[i] = src[i];
+		return;
+	}
+	for(i=0; i<n; i++)
+		if(src[i] != key)
+			dst[i] = src[i];
+}
+
+/*****************************************************************************
+ * With an odd x every framebuffer pair gets its left pixel from the right   *
+ * half of sprite pair s-1 and its right pixel from the left half of sprite  *
+ * pair s. A missing or keyed source leaves that half of the framebuffer     *
+ * pair untouched; chroma is the average of whatever ends up on both sides.  *
+ *****************************************************************************/
+static void blitRowOdd(u32 *dst, const u32 *src, int s1, int s2, int nw,
+                       int keyed, u32 key)
+{
+	int s;
+	u32 a, b, d, l, r;
+	int has_a, has_b;
+
+	for(s=s1; s<=s2; s++, dst++) {
+		has_a = (s-1 >= 0) && !(keyed && src[s-1] == key);
+		has_b = (s < nw) && !(keyed && src[s] == key);
+		if(!has_a && !has_b)
+			continue;
+
+		d = *dst;
+		a = has_a ? src[s-1] : 0;
+		b = has_b ? src[s] : 0;
+		l = has_a ? (a << 16) & 0xff000000 : d & 0xff000000;
+		r = has_b ? (b >> 16) & 0x0000ff00 : d & 0x0000ff00;
+		*dst = l | r | chromaAvg(has_a ? a : d, has_b ? b : d);
+	}
+}
+
+void blitSprite(u32 *fb, int fb_width, int fb_height,
+                const Sprite *spr, int x, int y)
+{
+	int row, y1, y2, s1, s2, q, nw;
+	int fb_words = fb_width >> 1;
+	int keyed = spr->flags & SPRITE_KEYED;
+	const u32 *src;
+	u32 *dst;
+
+	y1 = (y < 0) ? -y : 0;
+	y2 = (y + spr->height > fb_height) ? fb_height - y : spr->height;
+	if(y1 >= y2)
+		return;
+
+	nw = (spr->width + 1) >> 1;
+	q = x >> 1; // arithmetic shift, floor for negative x as well
+
+	if(!(x & 1)) {
+		// Sprite pairs line up with framebuffer pairs
+		s1 = (q < 0) ? -q : 0;
+		s2 = (q + nw > fb_words) ? fb_words - q : nw;
+		if(s1 >= s2)
+			return;
+		for(row=y1; row<y2; row++) {
+			src = spr->data + row*spr->pitch;
+			dst = fb + (y+row)*fb_words + q;
+			blitRowEven(dst + s1, src + s1, s2 - s1, keyed, spr->key);
+		}
+	}
+	else {
+		// Framebuffer pair q+s receives the halves of sprite pairs s-1, s
+		s1 = (q < 0) ? -q : 0;
+		s2 = (q + nw >= fb_words) ? fb_words - q - 1 : nw;
+		if(s1 > s2)
+			return;
+		for(row=y1; row<y2; row++) {
+			src = spr->data + row*spr->pitch;
+			dst = fb + (y+row)*fb_words + q + s1;
+			blitRowOdd(dst, src, s1, s2, nw, keyed, spr->key);
+		}
+	}
+}
+
+/*****************************************************************************
+ * The decay works on both pixels of a pair at once: the two luma and the    *
+ * two chroma bytes are spread to 16 bit lanes and scaled with a single      *
+ * multiply each. A lane gets k times its byte plus 256-k times the byte of  *
+ * black, at most 255*256, so no lane spills into the next one.              *
+ *****************************************************************************/
+static inline u32 decayPair(u32 w, u32 k, u32 ybias, u32 cbias)
+{
+	u32 y = ((w >> 8) & CHROMA_MASK) * k + ybias;
+	u32 c = (w & CHROMA_MASK) * k + cbias;
+
+	return (y & 0xff00ff00) | ((c >> 8) & CHROMA_MASK);
+}
+
+void colorDecay(u32 *dst, const u32 *src, int n, int k, u32 black)
+{
+	u32 ybias = ((black >> 8) & CHROMA_MASK) * (256 - k);
+	u32 cbias = (black & CHROMA_MASK) * (256 - k);
+	u32 diff;
+	int i, j;
+
+	// Black stays black, which is most of a frame. Checking a cache line
+	// (8 pairs) at a time keeps both loops free of branches.
+	for(i = 0; i + 8 <= n; i += 8) {
+		for(j = 0, diff = 0; j < 8; j++)
+			diff |= src[i+j] ^ black;
+		if(diff == 0) {
+			for(j = 0; j < 8; j++)
+				dst[i+j] = black;
+		}
+		else {
+			for(j = 0; j < 8; j++)
+				dst[i+j] = decayPair(src[i+j], k, ybias, cbias);
+		}
+	}
+	for(; i < n; i++)
+		dst[i] = decayPair(src[i], k, ybias, cbias);
+}
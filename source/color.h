@@ -0,0 +1,81 @@
+#ifndef __COLOR_H__
+#define __COLOR_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * Pixel pairs in the external framebuffer are stored as one u32 each,       *
+ * laid out as Y0 Cb Y1 Cr from the most to the least significant byte.      *
+ *****************************************************************************/
+#define YUY2_Y0(c)   (((c) >> 24) & 0xff)
+#define YUY2_CB(c)   (((c) >> 16) & 0xff)
+#define YUY2_Y1(c)   (((c) >>  8) & 0xff)
+#define YUY2_CR(c)   ( (c)        & 0xff)
+#define YUY2_PACK(y0, cb, y1, cr) \
+	(((u32)(y0) << 24) | ((u32)(cb) << 16) | ((u32)(y1) << 8) | (u32)(cr))
+
+// Alpha below this threshold marks a pixel as transparent
+#define COLOR_ALPHA_CUTOFF 128
+
+typedef struct {
+	u16 width;         // in pixels
+	u16 height;
+	u16 pitch;         // u32 words per row, at least (width+1)/2
+	u16 flags;         // SPRITE_* flags
+	u32 key;           // colour key, used when SPRITE_KEYED is set
+	const u32 *data;   // YUY2 pixel pairs
+} Sprite;
+
+#define SPRITE_KEYED 1
+
+/****************************************************************************
+ * colorRGBToYUY2
+ *
+ * Converts two RGB pixels into one YUY2 pair. Chroma is taken from the
+ * average of both pixels.
+ ***************************************************************************/
+u32 colorRGBToYUY2(u8 r0, u8 g0, u8 b0, u8 r1, u8 g1, u8 b1);
+
+/****************************************************************************
+ * colorConvertRGBA
+ *
+ * Converts a width x height RGBA8 image into YUY2 pixel pairs.
+ * src_pitch - bytes per source row
+ * dst_pitch - u32 words per destination row, at least (width+1)/2
+ * key - pairs whose two pixels are both transparent are written as key.
+ *       If only one pixel of a pair is transparent, the opaque one is used
+ *       for both.
+ ***************************************************************************/
+void colorConvertRGBA(const u8 *src, int width, int height, int src_pitch,
+                      u32 *dst, int dst_pitch, u32 key);
+
+/****************************************************************************
+ * blitSprite
+ *
+ * Draws a sprite with its upper left corner at pixel (x,y), clipped to
+ * the framebuffer. Odd x positions are handled by recombining neighbouring
+ * pairs, so the sprite does not snap to even columns. Sprites with an odd
+ * width are drawn with their padding pixel.
+ ***************************************************************************/
+void blitSprite(u32 *fb, int fb_width, int fb_height,
+                const Sprite *spr, int x, int y);
+
+/****************************************************************************
+ * colorDecay
+ *
+ * Writes n pairs of src to dst, faded by k/256 toward black: k = 0 gives
+ * black, k = 256 a plain copy. Pairs that already are black are written
+ * without any math, so mostly dark frames fade faster than bright ones.
+ ***************************************************************************/
+void colorDecay(u32 *dst, const u32 *src, int n, int k, u32 black);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "entity.h"
+
+#define SLOT(h) ((h) & 0xffff)
+#define GEN(h)  ((h) >> 16)
+
+int entityPoolInit(EntityPool *pool, int capacity)
+{
+	u8 *p;
+	size_t items, types, slots;
+
+	memset(pool, 0, sizeof(*pool));
+	if(capacity <= 0 || capacity > ENTITY_MAX)
+		return -1;
+
+	// One block: items first for alignment, then the index arrays
+	items = capacity * sizeof(Particle);
+	types = (capacity + 3) & ~3;
+	slots = capacity * sizeof(u16);
+	p = malloc(items + types + 4*slots);
+	if(p == NULL)
+		return -1;
+
+	pool->arena = p;
+	pool->arena_size = items + types + 4*slots;
+	pool->items = (Particle *)p;       p += items;
+	pool->types = p;                   p += types;
+	pool->owner = (u16 *)p;            p += slots;
+	pool->dense = (u16 *)p;            p += slots;
+	pool->generation = (u16 *)p;       p += slots;
+	pool->next_free = (u16 *)p;
+	pool->capacity = capacity;
+
+	memset(pool->generation, 0, slots);
+	entityPoolClear(pool);
+	return 0;
+}
+
+void entityPoolFree(EntityPool *pool)
+{
+	free(pool->arena);
+	memset(pool, 0, sizeof(*pool));
+}
+
+void entityPoolClear(EntityPool *pool)
+{
+	int i;
+
+	// Bump every generation that is in use so old handles go stale
+	for(i=0; i<pool->count; i++)
+		if(++pool->generation[pool->owner[i]] == 0)
+			pool->generation[pool->owner[i]] = 1;
+
+	for(i=0; i<pool->capacity-1; i++)
+		pool->next_free[i] = i+1;
+	if(pool->capacity > 0)
+		pool->next_free[pool->capacity-1] = 0xffff;
+	pool->free_head = (pool->capacity > 0) ? 0 : -1;
+	pool->count = 0;
+}
+
+EntityHandle entitySpawn(EntityPool *pool, int type)
+{
+	int slot, i;
+
+	if(pool->free_head < 0)
+		return ENTITY_NONE;
+
+	slot = pool->free_head;
+	pool->free_head = (pool->next_free[slot] == 0xffff) ? -1 : pool->next_free[slot];
+	if(pool->generation[slot] == 0)
+		pool->generation[slot] = 1;
+
+	i = pool->count++;
+	memset(&pool->items[i], 0, sizeof(Particle));
+	pool->types[i] = type;
+	pool->owner[i] = slot;
+	pool->dense[slot] = i;
+
+	return ((EntityHandle)pool->generation[slot] << 16) | slot;
+}
+
+int entityDespawn(EntityPool *pool, EntityHandle h)
+{
+	int slot = SLOT(h), i, last;
+
+	if(entityGet(pool, h) == NULL)
+		return -1;
+
+	// Move the last live entity into the gap
+	i = pool->dense[slot];
+	last = --pool->count;
+	if(i != last) {
+		pool->items[i] = pool->items[last];
+		pool->types[i] = pool->types[last];
+		pool->owner[i] = pool->owner[last];
+		pool->dense[pool->owner[i]] = i;
+	}
+
+	if(++pool->generation[slot] == 0)
+		pool->generation[slot] = 1;
+	pool->next_free[slot] = (pool->free_head < 0) ? 0xffff : pool->free_head;
+	pool->free_head = slot;
+	return 0;
+}
+
+Particle *entityGet(EntityPool *pool, EntityHandle h)
+{
+	int slot = SLOT(h);
+
+	if(h == ENTITY_NONE || slot >= pool->capacity || pool->generation[slot] != GEN(h))
+		return NULL;
+	if(pool->dense[slot] >= pool->count || pool->owner[pool->dense[slot]] != slot)
+		return NULL; // slot is free
+	return &pool->items[pool->dense[slot]];
+}
+
+EntityHandle entityHandle(EntityPool *pool, int i)
+{
+	int slot = pool->owner[i];
+	return ((EntityHandle)pool->generation[slot] << 16) | slot;
+}
@@ -0,0 +1,105 @@
+#ifndef __ENTITY_H__
+#define __ENTITY_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ENTITY_MAX 65535	// slot indices have to fit into 16 bits
+
+// Type tags
+#define ENTITY_BALL   1
+#define ENTITY_PADDLE 2
+
+/*****************************************************************************
+ * A handle is the slot index in the lower and the slot's generation in the  *
+ * upper 16 bits. Generations start at 1, so 0 is never a valid handle and   *
+ * handles of despawned entities stop resolving once the slot is reused.     *
+ *****************************************************************************/
+typedef u32 EntityHandle;
+#define ENTITY_NONE 0
+
+typedef struct {
+	int pos_x, pos_y;   // screen coordinates
+	int size_x, size_y; // dimensions
+	int dx, dy;         // speed values
+	int freq;		    // frequency of collision sound
+}Particle;
+
+typedef struct {
+	Particle *items;	// live entities, densely packed
+	u8 *types;			// type tag of every live entity
+	u16 *owner;			// slot of every live entity
+	u16 *dense;			// position in items of every slot
+	u16 *generation;	// current generation of every slot
+	u16 *next_free;		// free list links
+	int capacity;
+	int count;			// number of live entities
+	int free_head;		// first free slot, -1 if full
+	void *arena;		// single allocation backing all of the above
+	u32 arena_size;		// in bytes, a multiple of 4
+} EntityPool;
+
+/****************************************************************************
+ * entityPoolInit
+ *
+ * Allocates a pool for up to capacity entities in one block. This is the
+ * only allocation the pool ever does.
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int entityPoolInit(EntityPool *pool, int capacity);
+
+/****************************************************************************
+ * entityPoolFree
+ *
+ * Releases the memory of the pool. All handles become invalid.
+ ***************************************************************************/
+void entityPoolFree(EntityPool *pool);
+
+/****************************************************************************
+ * entityPoolClear
+ *
+ * Despawns all entities at once
+ ***************************************************************************/
+void entityPoolClear(EntityPool *pool);
+
+/****************************************************************************
+ * entitySpawn
+ *
+ * Creates a zeroed entity with the given type tag in O(1)
+ * returns: handle of the entity, ENTITY_NONE if the pool is full
+ ***************************************************************************/
+EntityHandle entitySpawn(EntityPool *pool, int type);
+
+/****************************************************************************
+ * entityDespawn
+ *
+ * Removes an entity in O(1). The last live entity is moved into the gap,
+ * so this changes the order of pool->items.
+ * returns: -1 if the handle is stale, 0 on success
+ ***************************************************************************/
+int entityDespawn(EntityPool *pool, EntityHandle h);
+
+/****************************************************************************
+ * entityGet
+ *
+ * returns: the entity h refers to, NULL if the handle is stale. The pointer
+ * is only valid until the next despawn.
+ ***************************************************************************/
+Particle *entityGet(EntityPool *pool, EntityHandle h);
+
+/****************************************************************************
+ * entityHandle
+ *
+ * returns: the handle of the live entity at position i of pool->items
+ ***************************************************************************/
+EntityHandle entityHandle(EntityPool *pool, int i);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "governor.h"
+
+/*****************************************************************************
+ * The governor keeps a moving average of the work done per frame. It steps  *
+ * quality down once the average stays above GOV_HIGH_PCT of the budget for  *
+ * GOV_DOWN_FRAMES frames and steps it up again only after the average has   *
+ * stayed below GOV_LOW_PCT for GOV_UP_FRAMES frames. The gap between both   *
+ * thresholds and the hold time after every change keep it from bouncing     *
+ * between two levels.                                                       *
+ *****************************************************************************/
+
+#define GOV_HIGH_PCT    85
+#define GOV_LOW_PCT     50
+#define GOV_DOWN_FRAMES 4
+#define GOV_UP_FRAMES   120
+#define GOV_HOLD_FRAMES 30
+#define GOV_AVG_SHIFT   3	// moving average weight 1/8
+
+static const QualitySettings gov_table[GOV_LEVELS] = {
+	{ 100, 2, 8,  1 },
+	{  75, 1, 4,  4 },
+	{  50, 0, 2, 15 },
+	{  25, 0, 1, 30 }
+};
+
+static u32 gov_budget = 16667;
+static u32 gov_avg = 0;		// in microseconds << GOV_AVG_SHIFT
+static u64 gov_start = 0;
+static int gov_level = 0;
+static int gov_over = 0;	// consecutive frames above the high mark
+static int gov_under = 0;	// consecutive frames below the low mark
+static int gov_hold = 0;	// frames left before the next change
+static int gov_opt_on = 0;	// the optional effect runs
+static u32 gov_opt_cost = 0;	// charged to the average when it started
+static int gov_opt_wait = 0;	// frames before it may start again
+
+void governorInit(u32 budget_us)
+{
+	gov_budget = budget_us;
+	gov_avg = 0;
+	gov_level = 0;
+	gov_over = 0;
+	gov_under = 0;
+	gov_hold = 0;
+	gov_opt_on = 0;
+	gov_opt_cost = 0;
+	gov_opt_wait = 0;
+}
+
+void governorBeginFrame()
+{
+	gov_start = gettime();
+}
+
+void governorEndFrame()
+{
+	u32 cost = diff_usec(gov_start, gettime());
+	u32 avg;
+
+	gov_avg += cost - (gov_avg >> GOV_AVG_SHIFT);
+	avg = gov_avg >> GOV_AVG_SHIFT;
+
+	// A single frame over budget already means a missed VSync
+	if(avg*100 > gov_budget*GOV_HIGH_PCT || cost > gov_budget)
+		gov_over++;
+	else
+		gov_over = 0;
+
+	if(avg*100 < gov_budget*GOV_LOW_PCT)
+		gov_under++;
+	else
+		gov_under = 0;
+
+	if(gov_opt_wait > 0)
+		gov_opt_wait--;
+
+	if(gov_hold > 0) {
+		gov_hold--;
+		return;
+	}
+
+	if(gov_over >= GOV_DOWN_FRAMES && gov_level < GOV_LEVELS-1) {
+		gov_level++;
+		gov_over = 0;
+		gov_under = 0;
+		gov_hold = GOV_HOLD_FRAMES;
+	}
+	else if(gov_under >= GOV_UP_FRAMES && gov_level > 0) {
+		gov_level--;
+		gov_over = 0;
+		gov_under = 0;
+		gov_hold = GOV_HOLD_FRAMES;
+	}
+}
+
+int governorOptional(int want, u32 cost_us)
+{
+	u32 avg = gov_avg >> GOV_AVG_SHIFT;
+
+	if(gov_opt_on && (!want || avg*100 > gov_budget*GOV_HIGH_PCT)) {
+		// Without the effect the streak above the high mark is over
+		if(want) {
+			gov_over = 0;
+			gov_opt_wait = GOV_UP_FRAMES;
+		}
+		gov_avg -= (gov_opt_cost < avg ? gov_opt_cost : avg) << GOV_AVG_SHIFT;
+		gov_opt_on = 0;
+	}
+	else if(!gov_opt_on && want && gov_opt_wait == 0 &&
+			(avg + cost_us)*100 < gov_budget*GOV_HIGH_PCT) {
+		gov_avg += cost_us << GOV_AVG_SHIFT;
+		gov_opt_cost = cost_us;
+		gov_opt_on = 1;
+	}
+	return gov_opt_on;
+}
+
+int governorLevel()
+{
+	return gov_level;
+}
+
+const QualitySettings *governorSettings()
+{
+	return &gov_table[gov_level];
+}
+
+u32 governorBudget()
+{
+	return gov_budget;
+}
+
+u32 governorCost()
+{
+	return gov_avg >> GOV_AVG_SHIFT;
+}
@@ -0,0 +1,89 @@
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define GOV_LEVELS 4	// quality levels, 0 is full quality
+
+typedef struct {
+	int particles_pct;	// share of the particles that are simulated, percent
+	int effect_detail;	// 0 = no optional overlays, 2 = everything
+	int sfx_per_frame;	// sound effects that may be started per frame
+	int hud_interval;	// frames between HUD text updates
+} QualitySettings;
+
+/****************************************************************************
+ * governorInit
+ *
+ * Resets the governor to full quality. budget_us is the time available
+ * for one frame, i.e. one VSync period.
+ ***************************************************************************/
+void governorInit(u32 budget_us);
+
+/****************************************************************************
+ * governorBeginFrame
+ *
+ * Marks the start of the frame's work, right after VSync
+ ***************************************************************************/
+void governorBeginFrame();
+
+/****************************************************************************
+ * governorEndFrame
+ *
+ * Marks the end of the frame's work, right before waiting for VSync, and
+ * adjusts the quality level for the following frames
+ ***************************************************************************/
+void governorEndFrame();
+
+/****************************************************************************
+ * governorOptional
+ *
+ * Decides whether an optional effect that costs cost_us per frame runs in
+ * the next frame. Call once per frame after governorEndFrame(). The effect
+ * starts only if the average stays below the high mark with its cost, which
+ * is then charged to the average right away. It stops as soon as want is 0
+ * or the average goes over the high mark, before the level has to drop for
+ * it, and its charge is taken off again. After going over it waits as long
+ * as a step up before it starts again. Tracks a single effect.
+ * returns: 1 if the effect runs
+ ***************************************************************************/
+int governorOptional(int want, u32 cost_us);
+
+/****************************************************************************
+ * governorLevel
+ *
+ * returns: current quality level, 0 (best) to GOV_LEVELS-1
+ ***************************************************************************/
+int governorLevel();
+
+/****************************************************************************
+ * governorSettings
+ *
+ * returns: the settings of the current quality level
+ ***************************************************************************/
+const QualitySettings *governorSettings();
+
+/****************************************************************************
+ * governorBudget
+ *
+ * returns: frame budget in microseconds
+ ***************************************************************************/
+u32 governorBudget();
+
+/****************************************************************************
+ * governorCost
+ *
+ * returns: smoothed cost of recent frames in microseconds
+ ***************************************************************************/
+u32 governorCost();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
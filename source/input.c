@@ -0,0 +1,177 @@
+#include <unistd.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "input.h"
+
+#define STACKSIZE  8192
+#define QUEUE_MASK (INPUT_QUEUE-1)
+
+typedef struct {
+	u64 time;			// gettime() at arrival
+	WPADData data;
+} InputSample;
+
+/*****************************************************************************
+ * Single producer, single consumer: the input thread only writes head, the  *
+ * game loop only writes tail. The producer never waits; if the game loop    *
+ * falls behind the oldest reports are overwritten.                          *
+ *****************************************************************************/
+typedef struct {
+	InputSample items[INPUT_QUEUE];
+	volatile u32 head;
+	u32 tail;
+} InputQueue;
+
+static InputQueue in_queue[INPUT_CHANNELS];
+static volatile s32 in_status[INPUT_CHANNELS];
+static volatile u32 in_status_seq = 0;	// bumped by the thread on changes
+static u32 in_status_seen = 0;
+static u32 in_age = 0;
+static volatile int in_running = 0;
+
+static u8 input_stack[STACKSIZE];
+static lwp_t h_input = LWP_THREAD_NULL;
+
+static void pushSample(s32 chan, const WPADData *data)
+{
+	InputQueue *q;
+	InputSample *s;
+
+	if(chan < 0 || chan >= INPUT_CHANNELS)
+		return;
+
+	q = &in_queue[chan];
+	s = &q->items[q->head & QUEUE_MASK];
+	s->time = gettime();
+	s->data = *data;
+
+	// Publish the sample only after it is complete
+	__sync_synchronize();
+	q->head++;
+}
+
+static void * input_thread(void *arg)
+{
+	int i;
+	u32 type;
+	s32 ret;
+
+	while(in_running) {
+		WPAD_ReadPending(WPAD_CHAN_ALL, pushSample);
+
+		for(i=0; i<INPUT_CHANNELS; i++) {
+			ret = WPAD_Probe(i, &type);
+			if(ret != in_status[i]) {
+				in_status[i] = ret;
+				in_status_seq++;
+			}
+		}
+		usleep(INPUT_POLL_US);
+	}
+	return NULL;
+}
+
+int inputStart()
+{
+	int i;
+
+	if(in_running)
+		return 0;
+
+	for(i=0; i<INPUT_CHANNELS; i++) {
+		in_queue[i].head = 0;
+		in_queue[i].tail = 0;
+		in_status[i] = WPAD_ERR_NOT_READY;
+	}
+	in_status_seq = 1;
+	in_status_seen = 0;
+	in_age = 0;
+	in_running = 1;
+
+	// Above the game loop, so reports are picked up while it is busy
+	if(LWP_CreateThread(&h_input, input_thread, NULL,
+			input_stack, STACKSIZE, 70) == -1)
+	{
+		h_input = LWP_THREAD_NULL;
+		in_running = 0;
+		return -1;
+	}
+	return 0;
+}
+
+void inputStop()
+{
+	if(h_input == LWP_THREAD_NULL)
+		return;
+	in_running = 0;
+	LWP_JoinThread(h_input, NULL);
+	h_input = LWP_THREAD_NULL;
+}
+
+int inputTake(int chan, WPADData *data)
+{
+	InputQueue *q;
+	InputSample *s;
+	u32 head, first, i, btns_d, btns_u;
+	u64 time;
+
+	if(chan < 0 || chan >= INPUT_CHANNELS)
+		return 0;
+	q = &in_queue[chan];
+
+	for(;;) {
+		head = q->head;
+		if(head == q->tail)
+			return 0;
+		__sync_synchronize();
+
+		// Slots older than this may be rewritten while we read them
+		first = q->tail;
+		if(head - first > INPUT_QUEUE - 1)
+			first = head - (INPUT_QUEUE - 1);
+
+		btns_d = btns_u = 0;
+		for(i=first; i!=head; i++) {
+			btns_d |= q->items[i & QUEUE_MASK].data.btns_d;
+			btns_u |= q->items[i & QUEUE_MASK].data.btns_u;
+		}
+		s = &q->items[(head-1) & QUEUE_MASK];
+		*data = s->data;
+		time = s->time;
+
+		// Retry if the producer lapped us during the copy
+		__sync_synchronize();
+		if(q->head - first <= INPUT_QUEUE - 1)
+			break;
+	}
+
+	data->btns_d = btns_d;
+	data->btns_u = btns_u;
+	q->tail = head;
+
+	in_age = in_age - (in_age >> 3) + (diff_usec(time, gettime()) >> 3);
+	return head - first;
+}
+
+s32 inputStatus(int chan)
+{
+	if(chan < 0 || chan >= INPUT_CHANNELS)
+		return WPAD_ERR_NO_CONTROLLER;
+	return in_status[chan];
+}
+
+int inputStatusChanged()
+{
+	u32 seq = in_status_seq;
+
+	if(seq == in_status_seen)
+		return 0;
+	in_status_seen = seq;
+	return 1;
+}
+
+u32 inputAge()
+{
+	return in_age;
+}
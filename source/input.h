@@ -0,0 +1,69 @@
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include <gctypes.h>
+#include <wiiuse/wpad.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define INPUT_CHANNELS WPAD_MAX_WIIMOTES
+#define INPUT_QUEUE    16		// reports kept per channel, power of two
+#define INPUT_POLL_US  1000		// delay between two polls of the Wiimotes
+
+/****************************************************************************
+ * inputStart
+ *
+ * Starts the input thread. From then on it is the only caller of
+ * WPAD_ReadPending() and WPAD_Probe(); every report is timestamped and
+ * queued per channel. WPAD_Init() must have been called before.
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int inputStart();
+
+/****************************************************************************
+ * inputStop
+ *
+ * Stops the input thread
+ ***************************************************************************/
+void inputStop();
+
+/****************************************************************************
+ * inputTake
+ *
+ * Copies the newest report of chan to data and empties the queue. btns_d
+ * and btns_u are merged over all reports since the last call, so no
+ * button press is lost between two frames.
+ * returns: number of reports merged, 0 if there was no new report
+ ***************************************************************************/
+int inputTake(int chan, WPADData *data);
+
+/****************************************************************************
+ * inputStatus
+ *
+ * returns: the last WPAD_Probe() result of chan, WPAD_ERR_* codes
+ ***************************************************************************/
+s32 inputStatus(int chan);
+
+/****************************************************************************
+ * inputStatusChanged
+ *
+ * returns: 1 if the status of any channel changed since the last call
+ ***************************************************************************/
+int inputStatusChanged();
+
+/****************************************************************************
+ * inputAge
+ *
+ * returns: moving average of the age of taken reports in microseconds,
+ *          i.e. the delay between report arrival and simulation
+ ***************************************************************************/
+u32 inputAge();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -32,10 +32,12 @@
 #include <tremor/ivorbiscodec.h>
 #include <tremor/ivorbisfile.h>
 #include <gccore.h>
+#include <ogc/lwp_watchdog.h>
 #include <unistd.h>
 #include <string.h>
 
 #include "oggplayer.h"
+#include "resampler.h"
 
 /* functions to read the Ogg file from memory */
 
@@ -44,8 +46,25 @@ static struct
 	char *mem;
 	int size;
 	int pos;
+	const volatile s32 *avail; // bytes loaded so far, NULL if all of them
 } file[4];
 
+/* blocks until the bytes to read have been loaded, returns how many of them can be read */
+static int mem_wait(int d, int b)
+{
+	s32 avail;
+
+	while ((avail = *file[d].avail) >= 0 && avail < file[d].size
+			&& file[d].pos + b > avail)
+		usleep(1000);
+
+	if (avail < 0)
+		return 0; // loading failed, end of stream
+	if (file[d].pos + b > avail)
+		b = avail - file[d].pos;
+	return b;
+}
+
 static int f_read(void * punt, int bytes, int blocks, int *f)
 {
 	int b;
@@ -70,6 +89,8 @@ static int f_read(void * punt, int bytes, int blocks, int *f)
 				return -1;
 			if ((file[d].pos + b) > file[d].size)
 				b = file[d].size - file[d].pos;
+			if (file[d].avail)
+				b = mem_wait(d, b);
 			if (b > 0)
 			{
 				memcpy(punt, file[d].mem + file[d].pos, b);
@@ -210,6 +231,7 @@ static int mem_open(char * ogg, int size)
 		file[0].mem = ogg;
 		file[0].size = size;
 		file[0].pos = 0;
+		file[0].avail = NULL;
 		return (0x666);
 	}
 
@@ -220,6 +242,7 @@ static int mem_open(char * ogg, int size)
 			file[n].mem = ogg;
 			file[n].size = size;
 			file[n].pos = 0;
+			file[n].avail = NULL;
 			return (0x666 + n);
 		}
 	}
@@ -245,9 +268,17 @@ static ov_callbacks callbacks = {
 	(long (*)(void *))                            f_tell
 };
 
+/* for files that are still being loaded, vorbisfile must not seek to the end */
+static ov_callbacks stream_callbacks = {
+	(size_t (*)(void *, size_t, size_t, void *))  f_read,
+	NULL,
+	(int (*)(void *))                             f_close,
+	(long (*)(void *))                            f_tell
+};
+
 /* OGG control */
 
-#define READ_SAMPLES 4096 // samples that it must read before to send
+#define READ_SAMPLES OGG_BUFFER_SAMPLES // samples that it must read before to send
 #define MAX_PCMOUT 4096 // minimum size to read ogg samples
 typedef struct
 {
@@ -257,6 +288,9 @@ typedef struct
 
 	// OGG file operation
 	int fd;
+	char *mem;
+	s32 len;
+	const volatile s32 *avail;
 	int mode;
 	int eof;
 	int flag;
@@ -268,9 +302,20 @@ typedef struct
 	int pcmout_pos;
 	int pcm_indx;
 
+	/* everything is converted to 48 kHz stereo before it reaches ASND */
+	short decoded[MAX_PCMOUT / 2];
+	Resampler resampler;
+	int quality;
+
 } private_data_ogg;
 
-static private_data_ogg private_ogg;
+static private_data_ogg private_ogg = { .quality = OGG_QUALITY_GOOD };
+
+/* statistics, every field has a single writer: the player thread or the voice callback */
+static volatile OggStats ogg_stats;
+static OggStats ogg_stats_last; // as seen by the previous GetStatsOgg()
+
+static OggTap ogg_tap = NULL;
 
 // OGG thread control
 
@@ -292,6 +337,9 @@ static void ogg_add_callback(int voice)
 	if (private_ogg.flag & 128)
 		return; // Ogg is paused
 
+	ogg_stats.callbacks++;
+	ogg_stats.fill += private_ogg.pcm_indx;
+
 	if (private_ogg.pcm_indx >= READ_SAMPLES)
 	{
 		if (ASND_AddVoice(0,
@@ -301,11 +349,14 @@ static void ogg_add_callback(int voice)
 			private_ogg.pcmout_pos ^= 1;
 			private_ogg.pcm_indx = 0;
 			private_ogg.flag = 0;
+			ogg_stats.buffers++;
 			LWP_ThreadSignal(oggplayer_queue);
 		}
 	}
 	else
 	{
+		ogg_stats.underruns++; // the decoder has not caught up
+
 		if (private_ogg.flag & 64)
 		{
 			private_ogg.flag &= ~64;
@@ -314,10 +365,55 @@ static void ogg_add_callback(int voice)
 	}
 }
 
+static int ogg_open(private_data_ogg * priv)
+{
+	int loading;
+
+	priv->fd = mem_open(priv->mem, priv->len);
+	if (priv->fd < 0)
+	{
+		priv->fd = -1;
+		return -1;
+	}
+
+	loading = (priv->avail && *priv->avail < priv->len);
+	if (loading)
+		file[priv->fd - 0x666].avail = priv->avail;
+
+	if (ov_open_callbacks((void *) &priv->fd, &priv->vf, NULL, 0,
+			loading ? stream_callbacks : callbacks) < 0)
+	{
+		mem_close(priv->fd); // mem_close() can too close files from devices
+		priv->fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+static void ogg_restart(private_data_ogg * priv)
+{
+	if (ov_seekable(&priv->vf))
+		ov_time_seek(&priv->vf, 0);
+	else
+	{
+		// opened while loading, so it cannot seek: open it again from the start
+		ov_clear(&priv->vf);
+		if (ogg_open(priv) < 0)
+		{
+			priv->eof = 1;
+			return;
+		}
+		priv->vi = ov_info(&priv->vf, -1);
+	}
+	ogg_stats.restarts++;
+}
+
 static void * ogg_player_thread(private_data_ogg * priv)
 {
 	int first_time = 1;
 	long ret;
+	int len, frames, room;
+	u64 start;
 
 	//init
 	LWP_InitQueue(&oggplayer_queue);
@@ -332,12 +428,17 @@ static void * ogg_player_thread(private_data_ogg * priv)
 	priv[0].flag = 0;
 	priv[0].current_section = 0;
 
+	resamplerInit(&priv[0].resampler, priv[0].quality, priv[0].vi->rate);
+
 	ogg_thread_running = 1;
 
 	while (!priv[0].eof && ogg_thread_running)
 	{
 		if (priv[0].flag)
+		{
 			LWP_ThreadSleep(oggplayer_queue); // wait only when i have samples to send
+			ogg_stats.wakeups++;
+		}
 
 		if (priv[0].flag == 0) // wait to all samples are sent
 		{
@@ -357,16 +458,28 @@ static void * ogg_player_thread(private_data_ogg * priv)
 					priv[0].seek_time = -1;
 				}
 
+				// read no more than what fits into pcmout after resampling, as
+				// long as the next section keeps the format
+				len = resamplerMaxIn(&priv[0].resampler,
+						(READ_SAMPLES + MAX_PCMOUT * 2 - priv[0].pcm_indx) >> 1)
+						* priv[0].vi->channels * 2;
+				if (len > MAX_PCMOUT)
+					len = MAX_PCMOUT;
+				len -= len % (priv[0].vi->channels * 2);
+
+				start = gettime();
 				ret	= ov_read(
 								&priv[0].vf,
-								(void *) &priv[0].pcmout[priv[0].pcmout_pos][priv[0].pcm_indx],
-								MAX_PCMOUT,/*0,2,1,*/&priv[0].current_section);
+								(void *) priv[0].decoded,
+								len,/*0,2,1,*/&priv[0].current_section);
+				ogg_stats.decode_us += diff_usec(start, gettime());
+				ogg_stats.reads++;
 				priv[0].flag &= 192;
 				if (ret == 0)
 				{
 					/* EOF */
 					if (priv[0].mode & 1)
-						ov_time_seek(&priv[0].vf, 0); // repeat
+						ogg_restart(&priv[0]); // repeat
 					else
 						priv[0].eof = 1; // stops
 				}
@@ -374,23 +487,51 @@ static void * ogg_player_thread(private_data_ogg * priv)
 				{
 					/* error in the stream.  Not a problem, just reporting it in
 					 case we (the app) cares.  In this case, we don't. */
-					if (ret != OV_HOLE)
+					if (ret == OV_HOLE)
+						ogg_stats.holes++;
+					else
 					{
 						if (priv[0].mode & 1)
-							ov_time_seek(&priv[0].vf, 0); // repeat
+							ogg_restart(&priv[0]); // repeat
 						else
 							priv[0].eof = 1; // stops
 					}
 				}
 				else
 				{
-					/* we don't bother dealing with sample rate changes, etc, but
-					 you'll have to*/
-					priv[0].pcm_indx += ret >> 1; //get 16 bits samples
+					/* chained streams may change rate and channels with every section,
+					   ov_read may already have returned samples of the next one */
+					priv[0].vi = ov_info(&priv[0].vf, -1);
+					if (priv[0].vi->rate != priv[0].resampler.in_rate
+							|| priv[0].quality != priv[0].resampler.quality)
+						resamplerInit(&priv[0].resampler, priv[0].quality, priv[0].vi->rate);
+
+					// len was sized for the previous format, what was decoded in
+					// the new one is cut to what fits into pcmout
+					frames = ret / (priv[0].vi->channels * 2);
+					room = resamplerMaxIn(&priv[0].resampler,
+							(READ_SAMPLES + MAX_PCMOUT * 2 - priv[0].pcm_indx) >> 1);
+					if (frames > room)
+						frames = room;
+
+					priv[0].pcm_indx += resamplerRun(&priv[0].resampler, priv[0].decoded,
+							frames, priv[0].vi->channels,
+							&priv[0].pcmout[priv[0].pcmout_pos][priv[0].pcm_indx]) << 1;
+					ogg_stats.bytes += ret;
 				}
 			}
 			else
+			{
 				priv[0].flag = 1;
+
+				// the buffer is complete, let the tap see it before it is queued
+				if (ogg_tap)
+				{
+					start = gettime();
+					ogg_tap(priv[0].pcmout[priv[0].pcmout_pos], priv[0].pcm_indx, 2);
+					ogg_stats.tap_us += diff_usec(start, gettime());
+				}
+			}
 		}
 
 		if (priv[0].flag == 1)
@@ -398,31 +539,19 @@ static void * ogg_player_thread(private_data_ogg * priv)
 			if (ASND_StatusVoice(0) == SND_UNUSED || first_time)
 			{
 				first_time = 0;
-				if (priv[0].vi->channels == 2)
-				{
-					ASND_SetVoice(0, VOICE_STEREO_16BIT, priv[0].vi->rate, 0,
-							(void *) priv[0].pcmout[priv[0].pcmout_pos],
-							priv[0].pcm_indx << 1, priv[0].volume,
-							priv[0].volume, ogg_add_callback);
-					priv[0].pcmout_pos ^= 1;
-					priv[0].pcm_indx = 0;
-					priv[0].flag = 0;
-				}
-				else
-				{
-					ASND_SetVoice(0, VOICE_MONO_16BIT, priv[0].vi->rate, 0,
-							(void *) priv[0].pcmout[priv[0].pcmout_pos],
-							priv[0].pcm_indx << 1, priv[0].volume,
-							priv[0].volume, ogg_add_callback);
-					priv[0].pcmout_pos ^= 1;
-					priv[0].pcm_indx = 0;
-					priv[0].flag = 0;
-				}
+				ASND_SetVoice(0, VOICE_STEREO_16BIT, RESAMPLE_OUT_RATE, 0,
+						(void *) priv[0].pcmout[priv[0].pcmout_pos],
+						priv[0].pcm_indx << 1, priv[0].volume,
+						priv[0].volume, ogg_add_callback);
+				priv[0].pcmout_pos ^= 1;
+				priv[0].pcm_indx = 0;
+				priv[0].flag = 0;
 			}
 		}
 		usleep(100);
 	}
-	ov_clear(&priv[0].vf);
+	if (priv[0].fd >= 0)
+		ov_clear(&priv[0].vf);
 	priv[0].fd = -1;
 	priv[0].pcm_indx = 0;
 
@@ -448,18 +577,14 @@ void StopOgg()
 	}
 }
 
-int PlayOgg(const void *buffer, s32 len, int time_pos, int mode)
+int PlayOggStream(const void *buffer, s32 len, const volatile s32 *avail,
+		int time_pos, int mode)
 {
 	StopOgg();
 
-	private_ogg.fd = mem_open((char *)buffer, len);
-	
-	if (private_ogg.fd < 0)
-	{
-		private_ogg.fd = -1;
-		return -1;
-	}
-	
+	private_ogg.mem = (char *)buffer;
+	private_ogg.len = len;
+	private_ogg.avail = avail;
 	private_ogg.mode = mode;
 	private_ogg.eof = 0;
 	private_ogg.volume = 127;
@@ -469,10 +594,8 @@ int PlayOgg(const void *buffer, s32 len, int time_pos, int mode)
 	if (time_pos > 0)
 		private_ogg.seek_time = time_pos;
 
-	if (ov_open_callbacks((void *) &private_ogg.fd, &private_ogg.vf, NULL, 0, callbacks) < 0)
+	if (ogg_open(&private_ogg) < 0)
 	{
-		mem_close(private_ogg.fd); // mem_close() can too close files from devices
-		private_ogg.fd = -1;
 		ogg_thread_running = 0;
 		return -1;
 	}
@@ -488,6 +611,11 @@ int PlayOgg(const void *buffer, s32 len, int time_pos, int mode)
 	return 0;
 }
 
+int PlayOgg(const void *buffer, s32 len, int time_pos, int mode)
+{
+	return PlayOggStream(buffer, len, NULL, time_pos, mode);
+}
+
 void PauseOgg(int pause)
 {
 	if (pause)
@@ -540,3 +668,50 @@ void SetTimeOgg(s32 time_pos)
 	if (time_pos >= 0)
 		private_ogg.seek_time = time_pos;
 }
+
+void GetStatsOgg(OggStats *total, OggStats *recent)
+{
+	OggStats now;
+
+	now.buffers = ogg_stats.buffers;
+	now.bytes = ogg_stats.bytes;
+	now.decode_us = ogg_stats.decode_us;
+	now.reads = ogg_stats.reads;
+	now.callbacks = ogg_stats.callbacks;
+	now.fill = ogg_stats.fill;
+	now.underruns = ogg_stats.underruns;
+	now.holes = ogg_stats.holes;
+	now.wakeups = ogg_stats.wakeups;
+	now.restarts = ogg_stats.restarts;
+	now.tap_us = ogg_stats.tap_us;
+
+	if (total)
+		*total = now;
+
+	if (recent)
+	{
+		recent->buffers = now.buffers - ogg_stats_last.buffers;
+		recent->bytes = now.bytes - ogg_stats_last.bytes;
+		recent->decode_us = now.decode_us - ogg_stats_last.decode_us;
+		recent->reads = now.reads - ogg_stats_last.reads;
+		recent->callbacks = now.callbacks - ogg_stats_last.callbacks;
+		recent->fill = now.fill - ogg_stats_last.fill;
+		recent->underruns = now.underruns - ogg_stats_last.underruns;
+		recent->holes = now.holes - ogg_stats_last.holes;
+		recent->wakeups = now.wakeups - ogg_stats_last.wakeups;
+		recent->restarts = now.restarts - ogg_stats_last.restarts;
+		recent->tap_us = now.tap_us - ogg_stats_last.tap_us;
+	}
+	ogg_stats_last = now;
+}
+
+void SetTapOgg(OggTap tap)
+{
+	ogg_tap = tap;
+}
+
+void SetQualityOgg(int quality)
+{
+	if (quality >= OGG_QUALITY_FAST && quality <= OGG_QUALITY_BEST)
+		private_ogg.quality = quality;
+}
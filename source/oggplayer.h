@@ -44,6 +44,30 @@ extern "C"
 #define OGG_STATUS_PAUSED    2
 #define OGG_STATUS_EOF     255
 
+#define OGG_BUFFER_SAMPLES 4096 // samples per buffer handed to ASND
+
+#define OGG_QUALITY_FAST     0 // resampling quality, see SetQualityOgg()
+#define OGG_QUALITY_GOOD     1
+#define OGG_QUALITY_BEST     2
+
+typedef struct
+{
+	u32 buffers;       // PCM buffers handed to ASND
+	u32 bytes;         // PCM bytes decoded
+	u32 decode_us;     // time spent in ov_read
+	u32 reads;         // ov_read calls
+	u32 callbacks;     // ASND voice callbacks
+	u32 fill;          // sum of the samples ready at each callback, out of
+	                   // OGG_BUFFER_SAMPLES
+	u32 underruns;     // callbacks that found no full buffer to queue
+	u32 holes;         // OV_HOLE returned by ov_read
+	u32 wakeups;       // times the player thread was woken up
+	u32 restarts;      // loop restarts
+	u32 tap_us;        // time spent in the tap, see SetTapOgg()
+} OggStats;
+
+typedef void (*OggTap)(const short *pcm, int samples, int channels);
+
 /****************************************************************************
  * PlayOgg
  *
@@ -56,6 +80,18 @@ extern "C"
  ***************************************************************************/
 int PlayOgg(const void *buffer, s32 len, int time_pos, int mode);
 
+/****************************************************************************
+ * PlayOggStream
+ *
+ * Like PlayOgg, but for a buffer that is still being filled, e.g. by a
+ * loader thread. Playback starts with what is there and waits for more.
+ * avail - bytes of buffer that are valid so far, len once complete,
+ *         -1 if loading failed (playback then ends as if at EOF)
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int PlayOggStream(const void *buffer, s32 len, const volatile s32 *avail,
+		int time_pos, int mode);
+
 /****************************************************************************
  * StopOgg
  *
@@ -105,6 +141,37 @@ s32 GetTimeOgg();
  ***************************************************************************/
 void SetTimeOgg(s32 time_pos);
 
+/****************************************************************************
+ * GetStatsOgg
+ *
+ * Gets the player's counters, all of them cumulative since startup
+ * total - receives the counters, may be NULL
+ * recent - receives the change since the previous call, may be NULL
+ * The counters are written without locks by the player thread and the
+ * voice callback, so fields may be one event apart from each other.
+ ***************************************************************************/
+void GetStatsOgg(OggStats *total, OggStats *recent);
+
+/****************************************************************************
+ * SetQualityOgg
+ *
+ * Sets how Ogg streams are resampled to 48 kHz, trading quality for CPU
+ * time. OGG_QUALITY_FAST uses 8 filter taps, GOOD 16 (default) and BEST 32.
+ * Takes effect with the next decoded block.
+ ***************************************************************************/
+void SetQualityOgg(int quality);
+
+/****************************************************************************
+ * SetTapOgg
+ *
+ * Installs a function that sees every decoded buffer before it is queued,
+ * e.g. for analyzing the music without decoding it twice. It runs on the
+ * player thread and delays playback, so it must be quick. NULL removes it.
+ * pcm - interleaved 16 bit samples, always 48 kHz stereo
+ * samples - number of samples in pcm, both channels together
+ ***************************************************************************/
+void SetTapOgg(OggTap tap);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,163 @@
+#include <stdlib.h>
+
+#include "raster.h"
+
+RasterKernels g_raster;
+
+static int r_width = 0;		// current framebuffer width in pixels
+static int r_height = 0;	// current framebuffer height in lines
+
+/*****************************************************************************
+ * RASTER_KERNELS(NAME, WIDTH) defines one kernel set whose row stride is    *
+ * the expression WIDTH/2. For a constant WIDTH the compiler folds every     *
+ * y*stride into shifts and adds and hoists the row pointer increments.      *
+ *****************************************************************************/
+#define RASTER_KERNELS(NAME, WIDTH)                                            \
+static void pixel_##NAME(u32 *fb, int x, int y, u32 color)                     \
+{                                                                              \
+	if(x < 0 || x >= (WIDTH) || y < 0 || y >= r_height)                        \
+		return;                                                                \
+	fb[y*((WIDTH)>>1) + (x>>1)] = color;                                       \
+}                                                                              \
+                                                                               \
+static void hline_##NAME(u32 *fb, int x1, int x2, int y, u32 color)            \
+{                                                                              \
+	int i;                                                                     \
+	if(y < 0 || y >= r_height) return;                                         \
+	if(x1 < 0) x1 = 0;                                                         \
+	if(x2 >= (WIDTH)) x2 = (WIDTH) - 1;                                        \
+	if(x1 > x2) return;                                                        \
+	fb += y*((WIDTH)>>1);                                                      \
+	for(i = x1>>1; i <= (x2>>1); i++)                                          \
+		fb[i] = color;                                                         \
+}                                                                              \
+                                                                               \
+static void vline_##NAME(u32 *fb, int x, int y1, int y2, u32 color)            \
+{                                                                              \
+	int i;                                                                     \
+	if(x < 0 || x >= (WIDTH)) return;                                          \
+	if(y1 < 0) y1 = 0;                                                         \
+	if(y2 >= r_height) y2 = r_height - 1;                                      \
+	fb += y1*((WIDTH)>>1) + (x>>1);                                            \
+	for(i = y1; i <= y2; i++, fb += (WIDTH)>>1)                                \
+		*fb = color;                                                           \
+}                                                                              \
+                                                                               \
+static void fill_##NAME(u32 *fb, int x1, int y1, int x2, int y2, u32 color)    \
+{                                                                              \
+	int i, j;                                                                  \
+	if(x1 < 0) x1 = 0;                                                         \
+	if(y1 < 0) y1 = 0;                                                         \
+	if(x2 >= (WIDTH)) x2 = (WIDTH) - 1;                                        \
+	if(y2 >= r_height) y2 = r_height - 1;                                      \
+	if(x1 > x2) return;                                                        \
+	x1 >>= 1;                                                                  \
+	x2 >>= 1;                                                                  \
+	fb += y1*((WIDTH)>>1);                                                     \
+	for(j = y1; j <= y2; j++, fb += (WIDTH)>>1)                                \
+		for(i = x1; i <= x2; i++)                                              \
+			fb[i] = color;                                                     \
+}                                                                              \
+                                                                               \
+static const RasterKernels kernels_##NAME = {                                  \
+	0, pixel_##NAME, hline_##NAME, vline_##NAME, fill_##NAME                   \
+};
+
+// fbWidth values found in the libogc GXRModeObj tables, plus a fallback
+RASTER_KERNELS(640, 640)
+RASTER_KERNELS(704, 704)
+RASTER_KERNELS(720, 720)
+RASTER_KERNELS(generic, r_width)
+
+void rasterInit(int fb_width, int fb_height)
+{
+	r_width = fb_width;
+	r_height = fb_height;
+
+	switch(fb_width) {
+		case 640: g_raster = kernels_640; break;
+		case 704: g_raster = kernels_704; break;
+		case 720: g_raster = kernels_720; break;
+		default:  g_raster = kernels_generic; fb_width = 0; break;
+	}
+	g_raster.width = fb_width;
+}
+
+/*****************************************************************************
+ * The composite primitives go through g_raster one pixel or line at a time  *
+ * and leave the clipping of every pixel to the kernels. They only skip      *
+ * shapes that lie wholly beyond one edge, which the walks below would       *
+ * otherwise step through pixel by pixel.                                    *
+ *****************************************************************************/
+
+void rasterLine(u32 *fb, int x0, int y0, int x1, int y1, u32 color)
+{
+	int dx =  abs(x1-x0), sx = x0<x1 ? 1 : -1;
+	int dy = -abs(y1-y0), sy = y0<y1 ? 1 : -1;
+	int err = dx+dy, e2;	// error value e_xy
+
+	if((x0 < 0 && x1 < 0) || (x0 >= r_width && x1 >= r_width) ||
+	   (y0 < 0 && y1 < 0) || (y0 >= r_height && y1 >= r_height))
+		return;
+
+	for(;;) {
+		g_raster.pixel(fb, x0, y0, color);
+		if(x0 == x1 && y0 == y1)
+			break;
+		e2 = 2*err;
+		if(e2 > dy) { err += dy; x0 += sx; }	// e_xy+e_x > 0
+		if(e2 < dx) { err += dx; y0 += sy; }	// e_xy+e_y < 0
+	}
+}
+
+void rasterBox(u32 *fb, int x1, int y1, int x2, int y2, u32 color)
+{
+	g_raster.hline(fb, x1, x2, y1, color);
+	g_raster.hline(fb, x1, x2, y2, color);
+	g_raster.vline(fb, x1, y1, y2, color);
+	g_raster.vline(fb, x2, y1, y2, color);
+}
+
+void rasterEllipse(u32 *fb, int xm, int ym, int a, int b, u32 color)
+{
+	int dx = 0, dy = b;
+	s64 a2 = (s64)a*a, b2 = (s64)b*b;		// 32 bits overflow from a radius of 1000
+	s64 err = b2-(2*(s64)b-1)*a2, e2;
+
+	if(a < 0 || b < 0 || xm + a < 0 || xm - a >= r_width || ym + b < 0 || ym - b >= r_height)
+		return;
+	// The error terms stay 0 and the walk below would never end
+	if(a == 0 && b == 0) {
+		g_raster.pixel(fb, xm, ym, color);
+		return;
+	}
+
+	do {
+		g_raster.pixel(fb, xm+dx, ym+dy, color);
+		g_raster.pixel(fb, xm-dx, ym+dy, color);
+		g_raster.pixel(fb, xm-dx, ym-dy, color);
+		g_raster.pixel(fb, xm+dx, ym-dy, color);
+
+		e2 = 2*err;
+		if(e2 <  (2*dx+1)*b2) { dx++; err += (2*dx+1)*b2; }
+		if(e2 > -(2*dy-1)*a2) { dy--; err -= (2*dy-1)*a2; }
+	} while(dy >= 0);
+
+	while(dx++ < a) {
+		g_raster.pixel(fb, xm+dx, ym, color);
+		g_raster.pixel(fb, xm-dx, ym, color);
+	}
+}
+
+void rasterDot(u32 *fb, float w, float h, float fx, float fy, u32 color)
+{
+	int x, y;
+
+	// Off screen, and keeps the conversions below in range; also catches NaN
+	if(!(fx > -w && fx < 2*w && fy > -h && fy < 2*h))
+		return;
+
+	y = fy * r_height / h;
+	x = fx * r_width / w / 2;
+	g_raster.fill(fb, 2*x - 4, y - 4, 2*x + 5, y + 4, color);
+}
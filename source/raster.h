@@ -0,0 +1,60 @@
+#ifndef __RASTER_H__
+#define __RASTER_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * Raster kernels for the external framebuffer. Coordinates are in pixels    *
+ * and get clipped; x is halved internally like everywhere else, so every    *
+ * write covers a whole pixel pair.                                          *
+ *****************************************************************************/
+typedef struct {
+	int width;	// fbWidth the kernels are specialized for, 0 if generic
+	void (*pixel)(u32 *fb, int x, int y, u32 color);
+	void (*hline)(u32 *fb, int x1, int x2, int y, u32 color);
+	void (*vline)(u32 *fb, int x, int y1, int y2, u32 color);
+	void (*fill)(u32 *fb, int x1, int y1, int x2, int y2, u32 color);
+} RasterKernels;
+
+// Kernels for the current video mode, valid after rasterInit()
+extern RasterKernels g_raster;
+
+/****************************************************************************
+ * rasterInit
+ *
+ * Selects the kernel set for a framebuffer of the given dimensions. Widths
+ * libogc video modes use get kernels with a compile time stride, anything
+ * else falls back to the generic set.
+ ***************************************************************************/
+void rasterInit(int fb_width, int fb_height);
+
+/****************************************************************************
+ * rasterLine, rasterBox, rasterEllipse
+ *
+ * Outlines drawn with the current kernels: a Bresenham line from (x0,y0)
+ * to (x1,y1) including both ends, the four sides of a rectangle and an
+ * ellipse around (xm,ym) with the radii a and b. Negative radii draw
+ * nothing, two radii of 0 the center pixel.
+ ***************************************************************************/
+void rasterLine(u32 *fb, int x0, int y0, int x1, int y1, u32 color);
+void rasterBox(u32 *fb, int x1, int y1, int x2, int y2, u32 color);
+void rasterEllipse(u32 *fb, int xm, int ym, int a, int b, u32 color);
+
+/****************************************************************************
+ * rasterDot
+ *
+ * Draws a 10x9 pixel dot at (fx,fy) of a w by h coordinate system that is
+ * stretched over the framebuffer, e.g. the IR camera's 1024x768
+ ***************************************************************************/
+void rasterDot(u32 *fb, float w, float h, float fx, float fy, u32 color);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,143 @@
+#include <math.h>
+#include <string.h>
+
+#include "resampler.h"
+
+static const int quality_taps[] = { 8, 16, 32 };
+
+/*****************************************************************************
+ * Zeroth order modified Bessel function, for the Kaiser window              *
+ *****************************************************************************/
+static double bessel0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	int k;
+
+	for(k=1; k<32; k++) {
+		term *= (x / (2*k)) * (x / (2*k));
+		sum += term;
+	}
+	return sum;
+}
+
+void resamplerInit(Resampler *r, int quality, int in_rate)
+{
+	double fc, beta, t, x, w, h[RESAMPLE_MAX_TAPS], sum;
+	int p, k, taps, acc;
+	u64 step;
+
+	if(quality < RESAMPLE_FAST) quality = RESAMPLE_FAST;
+	if(quality > RESAMPLE_BEST) quality = RESAMPLE_BEST;
+	taps = quality_taps[quality];
+
+	r->quality = quality;
+	r->taps = taps;
+	r->in_rate = in_rate;
+	step = ((u64)in_rate << 32) / RESAMPLE_OUT_RATE;
+	r->step_int = step >> 32;
+	r->step_frac = (u32)step;
+	r->pos_frac = 0;
+	r->pos = 0;
+
+	// Start on silence, the filter's latency is taps/2 input frames
+	r->frames = taps - 1;
+	memset(r->fifo, 0, sizeof(r->fifo));
+
+	// Cutoff relative to the input rate, a bit below the lower Nyquist
+	// frequency so the transition band ends before it
+	fc = 0.5 * (in_rate < RESAMPLE_OUT_RATE ? 1.0 : (double)RESAMPLE_OUT_RATE / in_rate);
+	fc *= (taps >= 16) ? 0.90 : 0.80;
+	beta = (taps >= 32) ? 9.0 : (taps >= 16) ? 7.0 : 5.0;
+
+	for(p=0; p<RESAMPLE_PHASES; p++) {
+		sum = 0;
+		for(k=0; k<taps; k++) {
+			// Distance of tap k from the interpolated point
+			t = k - (taps/2 - 1) - (double)p / RESAMPLE_PHASES;
+			x = 2 * fc * t;
+			h[k] = (x == 0) ? 2 * fc : sin(M_PI * x) / (M_PI * t);
+			w = t / (taps / 2.0);
+			w = (w*w < 1.0) ? bessel0(beta * sqrt(1.0 - w*w)) / bessel0(beta) : 0.0;
+			h[k] *= w;
+			sum += h[k];
+		}
+
+		// Unity gain for every phase, rounding error goes to the center tap
+		for(k=0, acc=0; k<taps; k++) {
+			r->coef[p][k] = (s16)floor(h[k] / sum * 32768.0 + 0.5);
+			acc += r->coef[p][k];
+		}
+		r->coef[p][taps/2 - 1] += 32768 - acc;
+	}
+}
+
+int resamplerMaxOut(const Resampler *r, int in_frames)
+{
+	u64 step = ((u64)r->step_int << 32) | r->step_frac;
+
+	return (((u64)(in_frames + r->frames) << 32) / step) + 1;
+}
+
+int resamplerMaxIn(const Resampler *r, int out_frames)
+{
+	u64 step = ((u64)r->step_int << 32) | r->step_frac;
+	int n = (((u64)(out_frames - 1) * step) >> 32) - r->frames;
+
+	return (n < 0) ? 0 : n;
+}
+
+static inline s16 clamp16(s32 v)
+{
+	return (v > 32767) ? 32767 : (v < -32768) ? -32768 : v;
+}
+
+int resamplerRun(Resampler *r, const s16 *in, int in_frames, int channels, s16 *out)
+{
+	int i, k, n, taps = r->taps, written = 0;
+	const s16 *c, *x;
+	s32 left, right;
+	u32 frac;
+
+	while(in_frames > 0) {
+		// Append what fits into the fifo, always as stereo
+		n = RESAMPLE_FIFO - r->frames;
+		if(n > in_frames)
+			n = in_frames;
+		if(channels == 2)
+			memcpy(&r->fifo[r->frames * 2], in, n * 2 * sizeof(s16));
+		else {
+			for(i=0; i<n; i++)
+				r->fifo[(r->frames + i) * 2] = r->fifo[(r->frames + i) * 2 + 1] = in[i];
+		}
+		r->frames += n;
+		in += n * channels;
+		in_frames -= n;
+
+		// Both channels share every coefficient load
+		while(r->pos + taps <= r->frames) {
+			c = r->coef[r->pos_frac >> (32 - RESAMPLE_PHASE_BITS)];
+			x = &r->fifo[r->pos * 2];
+			left = right = 1 << 14;
+			for(k=0; k<taps; k++) {
+				left += x[2*k] * c[k];
+				right += x[2*k + 1] * c[k];
+			}
+			out[0] = clamp16(left >> 15);
+			out[1] = clamp16(right >> 15);
+			out += 2;
+			written++;
+
+			frac = r->pos_frac + r->step_frac;
+			r->pos += r->step_int + (frac < r->pos_frac);
+			r->pos_frac = frac;
+		}
+
+		// Keep the frames the filter still needs. When downsampling the
+		// read position may already be past the end of the fifo.
+		n = (r->pos < r->frames) ? r->pos : r->frames;
+		memmove(r->fifo, &r->fifo[n * 2], (r->frames - n) * 2 * sizeof(s16));
+		r->frames -= n;
+		r->pos -= n;
+	}
+	return written;
+}
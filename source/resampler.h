@@ -0,0 +1,74 @@
+#ifndef __RESAMPLER_H__
+#define __RESAMPLER_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define RESAMPLE_OUT_RATE 48000	// the rate ASND mixes at
+#define RESAMPLE_PHASE_BITS 9
+#define RESAMPLE_PHASES   (1 << RESAMPLE_PHASE_BITS)	// filter phases per input sample
+#define RESAMPLE_MAX_TAPS 32
+#define RESAMPLE_FIFO     1024	// input frames buffered
+
+enum {
+	RESAMPLE_FAST = 0,	// 8 taps
+	RESAMPLE_GOOD,		// 16 taps
+	RESAMPLE_BEST		// 32 taps
+};
+
+typedef struct {
+	int quality;
+	int taps;
+	int in_rate;
+	u32 step_int;			// input frames per output frame, integer part
+	u32 step_frac;			// and fraction, 0.32 fixed point
+	u32 pos_frac;			// fraction of the read position
+	int pos;				// first fifo frame under the filter
+	int frames;				// frames in the fifo
+	s16 fifo[RESAMPLE_FIFO * 2];
+	s16 coef[RESAMPLE_PHASES][RESAMPLE_MAX_TAPS];	// Q15
+} Resampler;
+
+/****************************************************************************
+ * resamplerInit
+ *
+ * Prepares r to convert from in_rate to RESAMPLE_OUT_RATE. The filter is a
+ * Kaiser windowed sinc whose cutoff follows the lower of both rates, so
+ * nothing above the output Nyquist frequency can alias. Designing it takes
+ * floating point math, call this only when the rate or quality changes.
+ ***************************************************************************/
+void resamplerInit(Resampler *r, int quality, int in_rate);
+
+/****************************************************************************
+ * resamplerMaxOut
+ *
+ * returns: the most frames resamplerRun() can produce from in_frames
+ ***************************************************************************/
+int resamplerMaxOut(const Resampler *r, int in_frames);
+
+/****************************************************************************
+ * resamplerMaxIn
+ *
+ * returns: the most input frames whose output fits into out_frames
+ ***************************************************************************/
+int resamplerMaxIn(const Resampler *r, int out_frames);
+
+/****************************************************************************
+ * resamplerRun
+ *
+ * Consumes all in_frames of in and writes stereo frames to out. Mono input
+ * is duplicated to both channels. out must have room for
+ * resamplerMaxOut(r, in_frames) frames.
+ * returns: number of frames written to out
+ ***************************************************************************/
+int resamplerRun(Resampler *r, const s16 *in, int in_frames, int channels, s16 *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
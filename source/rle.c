@@ -0,0 +1,154 @@
+#include "rle.h"
+
+int rleEncode(const u32 *cur, u32 *ref, int n, u32 *out)
+{
+	int i = 0, j, k, lit = -1;
+	u32 *o = out;
+	u32 v;
+
+	while(i < n) {
+		// Unchanged run
+		for(j=i; j<n && cur[j]==ref[j]; j++);
+		if(j-i >= 2 || (j == n && j > i)) {
+			*o++ = RLE_SKIP | (j-i);
+			lit = -1;
+			i = j;
+			continue;
+		}
+
+		// Run of one new value
+		v = cur[i];
+		for(j=i+1; j<n && cur[j]==v; j++);
+		if(j-i >= 3) {
+			*o++ = RLE_FILL | (j-i);
+			*o++ = v;
+			for(k=i; k<j; k++)
+				ref[k] = v;
+			lit = -1;
+			i = j;
+			continue;
+		}
+
+		// Anything else extends the open literal or starts a new one
+		if(lit < 0) {
+			lit = o - out;
+			*o++ = RLE_LITERAL;
+		}
+		out[lit]++;
+		*o++ = ref[i] = cur[i];
+		i++;
+	}
+	return o - out;
+}
+
+int rleDecode(const u32 *in, int in_words, u32 *frame, int n)
+{
+	const u32 *end = in + in_words;
+	int pos = 0, len, k;
+	u32 tok, v;
+
+	while(in < end) {
+		tok = *in++;
+		len = tok & RLE_LEN_MASK;
+		if(pos + len > n)
+			return -1;
+
+		switch(tok & RLE_KIND_MASK) {
+			case RLE_SKIP:
+				break;
+			case RLE_FILL:
+				if(in >= end)
+					return -1;
+				v = *in++;
+				for(k=0; k<len; k++)
+					frame[pos+k] = v;
+				break;
+			case RLE_LITERAL:
+				if(in + len > end)
+					return -1;
+				for(k=0; k<len; k++)
+					frame[pos+k] = *in++;
+				break;
+			default:
+				return -1;
+		}
+		pos += len;
+	}
+	return 0;
+}
+
+int rleEncodeXor(const u32 *cur, u32 *ref, int n, u32 *out)
+{
+	int i = 0, j, lit = -1;
+	u32 *o = out;
+	u32 v;
+
+	while(i < n) {
+		// Unchanged run
+		for(j=i; j<n && cur[j]==ref[j]; j++);
+		if(j-i >= 2 || (j == n && j > i)) {
+			*o++ = RLE_SKIP | (j-i);
+			lit = -1;
+			i = j;
+			continue;
+		}
+
+		// Run of one XOR mask, e.g. the same field changing in every record
+		v = cur[i] ^ ref[i];
+		for(j=i+1; j<n && (cur[j]^ref[j])==v; j++);
+		if(j-i >= 3) {
+			*o++ = RLE_FILL | (j-i);
+			*o++ = v;
+			for(; i<j; i++)
+				ref[i] = cur[i];
+			lit = -1;
+			continue;
+		}
+
+		if(lit < 0) {
+			lit = o - out;
+			*o++ = RLE_LITERAL;
+		}
+		out[lit]++;
+		*o++ = cur[i] ^ ref[i];
+		ref[i] = cur[i];
+		i++;
+	}
+	return o - out;
+}
+
+int rleApplyXor(const u32 *in, int in_words, u32 *frame, int n)
+{
+	const u32 *end = in + in_words;
+	int pos = 0, len, k;
+	u32 tok, v;
+
+	while(in < end) {
+		tok = *in++;
+		len = tok & RLE_LEN_MASK;
+		if(pos + len > n)
+			return -1;
+
+		switch(tok & RLE_KIND_MASK) {
+			case RLE_SKIP:
+				break;
+			case RLE_FILL:
+				if(in >= end)
+					return -1;
+				v = *in++;
+				for(k=0; k<len; k++)
+					frame[pos+k] ^= v;
+				break;
+			case RLE_LITERAL:
+				if(in + len > end)
+					return -1;
+				for(k=0; k<len; k++)
+					frame[pos+k] ^= *in++;
+				break;
+			default:
+				return -1;
+		}
+		pos += len;
+	}
+	return 0;
+}
@@ -0,0 +1,72 @@
+#ifndef __RLE_H__
+#define __RLE_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * Delta + run length coding of u32 arrays against a reference copy.         *
+ *                                                                           *
+ * The output is a sequence of tokens, each a u32 with the kind in the top   *
+ * two bits and a word count in the lower 30 bits:                           *
+ *                                                                           *
+ *		RLE_SKIP     count words are unchanged                               *
+ *		RLE_FILL     count words are set to the single value that follows    *
+ *		RLE_LITERAL  count words follow verbatim                             *
+ *                                                                           *
+ * Skips cover at least two words and fills at least three, so the output    *
+ * never exceeds RLE_MAX_WORDS(n).                                           *
+ *****************************************************************************/
+#define RLE_SKIP      0x00000000
+#define RLE_FILL      0x40000000
+#define RLE_LITERAL   0x80000000
+#define RLE_KIND_MASK 0xc0000000
+#define RLE_LEN_MASK  0x3fffffff
+
+#define RLE_MAX_WORDS(n) ((n) + 1)
+
+/****************************************************************************
+ * rleEncode
+ *
+ * Encodes n words of cur against ref into out and copies cur to ref in the
+ * same pass, so ref is ready for the next call.
+ * returns: number of words written to out
+ ***************************************************************************/
+int rleEncode(const u32 *cur, u32 *ref, int n, u32 *out);
+
+/****************************************************************************
+ * rleDecode
+ *
+ * Applies an encoded delta of in_words words to the n words in frame.
+ * returns: -1 if the data is corrupt or overruns frame, 0 on success
+ ***************************************************************************/
+int rleDecode(const u32 *in, int in_words, u32 *frame, int n);
+
+/****************************************************************************
+ * rleEncodeXor
+ *
+ * Like rleEncode(), but fill and literal values are the XOR of cur and ref.
+ * Such a delta can be applied in both directions, which allows walking a
+ * chain of deltas backwards as well as forwards.
+ * returns: number of words written to out
+ ***************************************************************************/
+int rleEncodeXor(const u32 *cur, u32 *ref, int n, u32 *out);
+
+/****************************************************************************
+ * rleApplyXor
+ *
+ * XORs a delta from rleEncodeXor() into the n words in frame. Applying the
+ * same delta twice restores the original data.
+ * returns: -1 if the data is corrupt or overruns frame, 0 on success
+ ***************************************************************************/
+int rleApplyXor(const u32 *in, int in_words, u32 *frame, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <malloc.h>
+#include <gccore.h>
+
+#include "sfx.h"
+#include "adpcm.h"
+
+void sfxCacheInit(SfxCache *cache, u32 budget)
+{
+	cache->count = 0;
+	cache->used = 0;
+	cache->budget = budget;
+}
+
+void sfxCacheFree(SfxCache *cache)
+{
+	int i;
+
+	for(i=0; i<cache->count; i++)
+		free(cache->pcm[i]);
+	cache->count = 0;
+	cache->used = 0;
+}
+
+const s16 * sfxCacheGet(SfxCache *cache, const void *data, u32 size, u32 *bytes)
+{
+	int i, samples;
+	u32 aligned;
+	s16 *pcm;
+
+	for(i=0; i<cache->count; i++) {
+		if(cache->src[i] == data) {
+			*bytes = cache->bytes[i];
+			return cache->pcm[i];
+		}
+	}
+
+	samples = adpcmSamples(data, size);
+	if(samples <= 0 || cache->count >= SFX_CACHE_SLOTS)
+		return NULL;
+
+	aligned = (samples * sizeof(s16) + 31) & ~31;
+	if(cache->used + aligned > cache->budget)
+		return NULL;
+
+	pcm = memalign(32, aligned);
+	if(pcm == NULL)
+		return NULL;
+	adpcmDecode(data, size, 0, samples, pcm);
+
+	// ASND reads the samples by DMA
+	DCFlushRange(pcm, aligned);
+
+	cache->src[cache->count] = data;
+	cache->pcm[cache->count] = pcm;
+	cache->bytes[cache->count] = samples * sizeof(s16);
+	cache->count++;
+	cache->used += aligned;
+
+	*bytes = samples * sizeof(s16);
+	return pcm;
+}
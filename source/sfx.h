@@ -0,0 +1,51 @@
+#ifndef __SFX_H__
+#define __SFX_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SFX_CACHE_SLOTS 32
+
+typedef struct {
+	const void *src[SFX_CACHE_SLOTS];	// ADPCM compressed sounds
+	s16 *pcm[SFX_CACHE_SLOTS];			// their decoded samples
+	u32 bytes[SFX_CACHE_SLOTS];
+	int count;
+	u32 used;							// bytes of decoded samples
+	u32 budget;
+} SfxCache;
+
+/****************************************************************************
+ * sfxCacheInit
+ *
+ * Sets up a cache that may hold budget bytes of decoded samples
+ ***************************************************************************/
+void sfxCacheInit(SfxCache *cache, u32 budget);
+
+/****************************************************************************
+ * sfxCacheFree
+ *
+ * Frees all decoded samples. None of them may still be playing.
+ ***************************************************************************/
+void sfxCacheFree(SfxCache *cache);
+
+/****************************************************************************
+ * sfxCacheGet
+ *
+ * Returns the samples of an ADPCM sound (see adpcm.h) of size bytes,
+ * decoding it on first use into a 32 byte aligned, flushed buffer that can
+ * be handed to ASND. Decoded sounds stay in the cache until sfxCacheFree().
+ * bytes - receives the size of the decoded samples
+ * returns: NULL if data is not ADPCM or the budget is used up
+ ***************************************************************************/
+const s16 * sfxCacheGet(SfxCache *cache, const void *data, u32 size, u32 *bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,322 @@
+#include <stddef.h>
+
+#include "sim.h"
+
+void simDefaults(SimParams *params)
+{
+	params->ball_min_width = PARTICLE_MIN_WIDTH;
+	params->ball_max_width = PARTICLE_MAX_WIDTH;
+	params->ball_min_height = PARTICLE_MIN_HEIGHT;
+	params->ball_max_height = PARTICLE_MAX_HEIGHT;
+	params->ball_min_speed = PARTICLE_MIN_SPEED;
+	params->ball_max_speed = PARTICLE_MAX_SPEED;
+	params->token_width = TOKEN_SIZE_X;
+	params->token_length = TOKEN_SIZE_Y;
+	params->margin_top = MARGIN_TOP_PERCENT;
+	params->margin_bottom = MARGIN_BOTTOM_PERCENT;
+	params->margin_left = MARGIN_LEFT_PERCENT;
+	params->margin_right = MARGIN_RIGHT_PERCENT;
+}
+
+/*****************************************************************************
+ * Players 0 and 1 guard the left and right border, players 2 and 3 the top  *
+ * and bottom one. Horizontal tokens are scaled to the wider border.         *
+ *****************************************************************************/
+static void placeTokens(Sim *sim)
+{
+	const SimParams *sp = &sim->params;
+	const CollideBounds *b = &sim->bounds;
+	int i, w = b->r - b->l, h = b->b - b->t;
+	Particle *t;
+
+	for(i=0; i<sim->num_players; i++)
+	{
+		if(entityGet(&sim->entities, sim->token[i]) == NULL)
+			sim->token[i] = entitySpawn(&sim->entities, ENTITY_PADDLE);
+		t = entityGet(&sim->entities, sim->token[i]);
+		if(t == NULL)
+			break;
+
+		t->dx = 0;
+		t->dy = 0;
+		if(i < 2) {
+			t->size_x = sp->token_width;
+			t->size_y = sp->token_length;
+			t->pos_x = (i%2==0)?(b->l+2):(b->r-t->size_x);
+			t->pos_y = b->t+((h-t->size_y)>>1);
+		}
+		else {
+			t->size_x = sp->token_length * w / h;
+			t->size_y = sp->token_width;
+			t->pos_x = b->l+((w-t->size_x)>>1);
+			t->pos_y = (i%2==0)?(b->t+2):(b->b-t->size_y);
+		}
+	}
+}
+
+int simInit(Sim *sim, const SimParams *params, int fb_width, int fb_height,
+            int capacity, int num_players, u32 seed)
+{
+	int i;
+
+	if(entityPoolInit(&sim->entities, capacity) < 0)
+		return -1;
+
+	sim->params = *params;
+	sim->rng = seed ? seed : 1;
+	sim->bounds.t = fb_height * params->margin_top / 100;
+	sim->bounds.b = fb_height * (100 - params->margin_bottom) / 100;
+	sim->bounds.l = fb_width * params->margin_left / 100;
+	sim->bounds.r = fb_width * (100 - params->margin_right) / 100;
+
+	for(i=0; i<SIM_MAX_PLAYERS; i++)
+		sim->token[i] = ENTITY_NONE;
+	if(num_players < 1) num_players = 1;
+	if(num_players > SIM_MAX_PLAYERS) num_players = SIM_MAX_PLAYERS;
+	sim->num_players = num_players;
+	placeTokens(sim);
+	return 0;
+}
+
+void simFree(Sim *sim)
+{
+	entityPoolFree(&sim->entities);
+}
+
+/*****************************************************************************
+ * xorshift32, kept in the Sim so that snapshots can restore it              *
+ *****************************************************************************/
+int simRnd(Sim *sim, int a, int b)
+{
+	sim->rng ^= sim->rng << 13;
+	sim->rng ^= sim->rng >> 17;
+	sim->rng ^= sim->rng << 5;
+	return sim->rng % (b-a+1) + a;
+}
+
+int simSpawnBalls(Sim *sim, int count)
+{
+	const SimParams *sp = &sim->params;
+	const CollideBounds *b = &sim->bounds;
+	int i, size, min_size, max_size;
+	Particle *p;
+
+	min_size = sp->ball_min_width * sp->ball_min_height;
+	max_size = sp->ball_max_width * sp->ball_max_height;
+
+	for(i=0; i<count; i++) {
+		p = entityGet(&sim->entities, entitySpawn(&sim->entities, ENTITY_BALL));
+		if(p == NULL)
+			break;
+
+		// Create particle with random size, position and speed
+		p->size_x = simRnd(sim, sp->ball_min_width, sp->ball_max_width);
+		p->size_y = simRnd(sim, sp->ball_min_height, sp->ball_max_height);
+		p->pos_x = simRnd(sim, b->l, b->r-p->size_x-1);
+		p->pos_y = simRnd(sim, b->t, b->b-p->size_y-1);
+		p->dx = simRnd(sim, sp->ball_min_speed, sp->ball_max_speed);
+		p->dy = simRnd(sim, sp->ball_min_speed, sp->ball_max_speed);
+
+		// Determine frequency of collision sound depending on particle size
+		// (linear interpolation)
+		size = p->size_x*p->size_y;
+		p->freq = PARTICLE_MIN_FREQ;
+		if(max_size > min_size)
+			p->freq += (PARTICLE_MAX_FREQ - PARTICLE_MIN_FREQ) /
+					   (max_size - min_size) * (max_size - size);
+	}
+	return i;
+}
+
+int simFitBalls(Sim *sim, int count)
+{
+	EntityPool *pool = &sim->entities;
+	int i, n = 0;
+
+	for(i=0; i<pool->count; i++)
+		if(pool->types[i] == ENTITY_BALL)
+			n++;
+
+	// From the back, despawning moves the last entity, which was seen already
+	for(i=pool->count-1; i>=0 && n>count; i--) {
+		if(pool->types[i] != ENTITY_BALL)
+			continue;
+		entityDespawn(pool, entityHandle(pool, i));
+		n--;
+	}
+	if(n < count)
+		n += simSpawnBalls(sim, count - n);
+	return n;
+}
+
+void simSetPlayers(Sim *sim, int num)
+{
+	int i;
+
+	if(num < 1 || num > SIM_MAX_PLAYERS)
+		return;
+
+	for(i=num; i<SIM_MAX_PLAYERS; i++) {
+		entityDespawn(&sim->entities, sim->token[i]);
+		sim->token[i] = ENTITY_NONE;
+	}
+	sim->num_players = num;
+	placeTokens(sim);
+}
+
+Particle *simToken(Sim *sim, int player)
+{
+	if(player < 0 || player >= sim->num_players)
+		return NULL;
+	return entityGet(&sim->entities, sim->token[player]);
+}
+
+void simSteer(Sim *sim, int player, int aim)
+{
+	Particle *t = simToken(sim, player);
+	int lo, hi, *pos;
+
+	if(t == NULL)
+		return;
+
+	// Tokens only ever move along their border
+	if(player < 2) {
+		pos = &t->pos_y;
+		lo = sim->bounds.t;
+		hi = sim->bounds.b - t->size_y;
+	}
+	else {
+		pos = &t->pos_x;
+		lo = sim->bounds.l;
+		hi = sim->bounds.r - t->size_x;
+	}
+	*pos = (aim<lo)?lo:(aim>hi)?hi:aim;
+}
+
+/*****************************************************************************
+ * Bouncing between lo and hi is a triangle wave with period 2*(hi-lo), so   *
+ * the unbounced coordinate u folds back into the range with one modulo. For *
+ * integer steps this is exactly what collideStep() yields, at any speed: a  *
+ * step longer than the range bounces several times, and mirror() keeps      *
+ * reflecting once the contacts run out. Only holds while nothing else is in *
+ * the way; tools/intercepttest checks it against stepping.                  *
+ *****************************************************************************/
+static int fold(int u, int lo, int hi)
+{
+	int range = hi - lo, m;
+
+	if(range <= 0)
+		return lo;
+	m = (u - lo) % (2*range);
+	if(m < 0)
+		m += 2*range;
+	return lo + (m <= range ? m : 2*range - m);
+}
+
+/*****************************************************************************
+ * Distance of p to the face of token t that player guards, along the axis   *
+ * it moves toward the token, and its speed on that axis. Negative if p is   *
+ * not heading for the face or is past it already.                           *
+ *****************************************************************************/
+static int approach(int player, const Particle *t, const Particle *p, int *speed)
+{
+	switch(player) {
+		case 0:  *speed = -p->dx; return p->pos_x - (t->pos_x + t->size_x);
+		case 1:  *speed = p->dx;  return t->pos_x - (p->pos_x + p->size_x);
+		case 2:  *speed = -p->dy; return p->pos_y - (t->pos_y + t->size_y);
+		default: *speed = p->dy;  return t->pos_y - (p->pos_y + p->size_y);
+	}
+}
+
+static int intercept(const Sim *sim, int player, const Particle *t,
+                     const Particle *p, int *frames)
+{
+	int dist, speed, n;
+
+	dist = approach(player, t, p, &speed);
+	if(speed <= 0 || dist < 0)
+		return -1;
+
+	// Contact happens during the first frame that ends at or past the face
+	n = (dist + speed - 1) / speed;
+	if(n < 1)
+		n = 1;
+	*frames = n;
+
+	// Where the ball starts that frame, across the token's path
+	if(player < 2)
+		return fold(p->pos_y + (n-1)*p->dy, sim->bounds.t, sim->bounds.b - p->size_y);
+	return fold(p->pos_x + (n-1)*p->dx, sim->bounds.l, sim->bounds.r - p->size_x);
+}
+
+int simIntercept(Sim *sim, int player, const Particle *p, int *frames)
+{
+	Particle *t = simToken(sim, player);
+
+	if(t == NULL)
+		return -1;
+	return intercept(sim, player, t, p, frames);
+}
+
+void simAutoSteer(Sim *sim, int player, int max_balls, int speed)
+{
+	const Particle *items = sim->entities.items;
+	const u8 *types = sim->entities.types;
+	Particle *t = simToken(sim, player);
+	int i, n, dist, v, best = -1, best_dist = 0, best_v = 1;
+	int aim, pos, frames, step;
+
+	if(t == NULL)
+		return;
+
+	// Urgency is dist/v, the time until contact. Comparing the fractions by
+	// cross multiplying keeps the divides and the fold out of the loop that
+	// runs over all balls; they are only done for the winner.
+	for(i=0, n=0; i<sim->entities.count && n<max_balls; i++) {
+		if(types[i] != ENTITY_BALL)
+			continue;
+		n++;
+		dist = approach(player, t, &items[i], &v);
+		if(v <= 0 || dist < 0)
+			continue;
+		if(best < 0 || dist * best_v < best_dist * v) {
+			best = i;
+			best_dist = dist;
+			best_v = v;
+		}
+	}
+	if(best < 0)
+		return;
+
+	aim = intercept(sim, player, t, &items[best], &frames);
+	if(player < 2) {
+		aim += (items[best].size_y - t->size_y) >> 1;
+		pos = t->pos_y;
+	}
+	else {
+		aim += (items[best].size_x - t->size_x) >> 1;
+		pos = t->pos_x;
+	}
+
+	step = aim - pos;
+	if(step > speed) step = speed;
+	if(step < -speed) step = -speed;
+	simSteer(sim, player, pos + step);
+}
+
+void simStep(Sim *sim, int max_balls, u8 *hits)
+{
+	Particle *paddles[SIM_MAX_PLAYERS];
+	int i, num_paddles;
+
+	for(i=0, num_paddles=0; i<sim->num_players; i++) {
+		paddles[num_paddles] = entityGet(&sim->entities, sim->token[i]);
+		if(paddles[num_paddles] != NULL)
+			num_paddles++;
+	}
+
+	// Move all balls at once, sweeping them against all paddles so fast
+	// ones cannot skip over the thin tokens between two frames
+	collideStep(sim->entities.items, sim->entities.types, sim->entities.count,
+				max_balls, paddles, num_paddles, &sim->bounds, hits);
+}
@@ -0,0 +1,168 @@
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <gctypes.h>
+#include "entity.h"
+#include "collide.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SIM_MAX_PLAYERS 4
+
+// Default gameplay constants, see simDefaults()
+#define PARTICLE_MAX_WIDTH 20
+#define PARTICLE_MAX_HEIGHT 20
+#define PARTICLE_MIN_WIDTH 2
+#define PARTICLE_MIN_HEIGHT 2
+#define PARTICLE_MAX_SPEED 10
+#define PARTICLE_MIN_SPEED 1
+#define PARTICLE_MAX_FREQ 48000		// VOICE_FREQ48KHZ
+#define PARTICLE_MIN_FREQ 24000
+#define MARGIN_TOP_PERCENT 5
+#define MARGIN_BOTTOM_PERCENT 10
+#define MARGIN_LEFT_PERCENT 5
+#define MARGIN_RIGHT_PERCENT 5
+#define TOKEN_SIZE_X 5
+#define TOKEN_SIZE_Y 50
+
+typedef struct {
+	int ball_min_width, ball_max_width;		// pixels
+	int ball_min_height, ball_max_height;
+	int ball_min_speed, ball_max_speed;		// pixels per frame on each axis
+	int token_width, token_length;			// of the vertical tokens
+	int margin_top, margin_bottom;			// percent of the framebuffer
+	int margin_left, margin_right;
+} SimParams;
+
+/*****************************************************************************
+ * Everything a match consists of. The functions below only touch the Sim    *
+ * they are given, so any number of instances can run side by side, e.g. on  *
+ * different threads of the batchsim host tool.                              *
+ *****************************************************************************/
+typedef struct {
+	SimParams params;
+	EntityPool entities;				// balls and tokens, told apart by type
+	EntityHandle token[SIM_MAX_PLAYERS];
+	int num_players;
+	CollideBounds bounds;				// playfield
+	u32 rng;							// xorshift32 state, never 0
+} Sim;
+
+/****************************************************************************
+ * simDefaults
+ *
+ * Fills params with the constants the game ships with
+ ***************************************************************************/
+void simDefaults(SimParams *params);
+
+/****************************************************************************
+ * simInit
+ *
+ * Allocates an entity pool for up to capacity entities, lays out the
+ * playfield inside a framebuffer of the given size and places the tokens
+ * of num_players players. No balls are spawned yet.
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int simInit(Sim *sim, const SimParams *params, int fb_width, int fb_height,
+            int capacity, int num_players, u32 seed);
+
+/****************************************************************************
+ * simFree
+ *
+ * Releases the entity pool of sim
+ ***************************************************************************/
+void simFree(Sim *sim);
+
+/****************************************************************************
+ * simRnd
+ *
+ * returns: a pseudo random number in [a, b] from the state of sim
+ ***************************************************************************/
+int simRnd(Sim *sim, int a, int b);
+
+/****************************************************************************
+ * simSpawnBalls
+ *
+ * Adds count balls of random size, position and speed
+ * returns: number of balls actually spawned
+ ***************************************************************************/
+int simSpawnBalls(Sim *sim, int count);
+
+/****************************************************************************
+ * simFitBalls
+ *
+ * Despawns the balls beyond the first count or spawns new ones until there
+ * are count, so that simStep() and drawing see the same balls when the
+ * number the game can afford changes
+ * returns: number of balls afterwards
+ ***************************************************************************/
+int simFitBalls(Sim *sim, int count);
+
+/****************************************************************************
+ * simSetPlayers
+ *
+ * Changes the number of players. Tokens of players that left are removed
+ * and the remaining ones are placed on their borders again.
+ ***************************************************************************/
+void simSetPlayers(Sim *sim, int num);
+
+/****************************************************************************
+ * simToken
+ *
+ * returns: the token of player, NULL if there is none
+ ***************************************************************************/
+Particle *simToken(Sim *sim, int player);
+
+/****************************************************************************
+ * simSteer
+ *
+ * Moves the token of player along its border to aim, which is its new top
+ * (players 0 and 1) or left (players 2 and 3) coordinate, clamped to the
+ * playfield
+ ***************************************************************************/
+void simSteer(Sim *sim, int player, int aim);
+
+/****************************************************************************
+ * simIntercept
+ *
+ * Predicts where ball p reaches the face of player's token, assuming it
+ * only bounces off the two borders parallel to its path. The bounces are
+ * folded in closed form, giving the same position collideStep() arrives
+ * at frame by frame, also when the ball is faster than the gap between
+ * those borders and bounces several times a frame. Paddles and other
+ * balls on the way are not accounted for.
+ * frames - receives the frame during which the ball reaches the face,
+ *          1 being the next one
+ * returns: top (players 0 and 1) or left (players 2 and 3) coordinate of
+ *          the ball at the start of that frame, -1 if it is not heading
+ *          for the token
+ ***************************************************************************/
+int simIntercept(Sim *sim, int player, const Particle *p, int *frames);
+
+/****************************************************************************
+ * simAutoSteer
+ *
+ * Moves the token of player by at most speed pixels toward the intercept
+ * of the most urgent of the first max_balls balls, i.e. the one reaching
+ * its face first. Lets the CPU play for players without a controller.
+ ***************************************************************************/
+void simAutoSteer(Sim *sim, int player, int max_balls, int speed);
+
+/****************************************************************************
+ * simStep
+ *
+ * Advances the first max_balls balls by one frame, bouncing them off the
+ * borders and the tokens
+ * hits - receives the COLLIDE_* flags of every entity, entities.count
+ *        bytes
+ ***************************************************************************/
+void simStep(Sim *sim, int max_balls, u8 *hits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
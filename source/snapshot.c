@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "snapshot.h"
+#include "rle.h"
+
+#define SNAPSHOT_MAX_REGIONS 16
+
+/*****************************************************************************
+ * Ring entries are laid out as [len] [len delta words] [len], so they can   *
+ * be dropped from the tail and popped from the head. Entries may wrap       *
+ * around the end of the ring.                                               *
+ *****************************************************************************/
+
+static SnapshotRegion snap_regions[SNAPSHOT_MAX_REGIONS];
+static int snap_count = 0;
+static int snap_words = 0;		// words per snapshot
+static u32 *snap_image = NULL;	// newest recorded state
+static u32 *snap_cur = NULL;	// gather buffer
+static u32 *snap_delta = NULL;	// encode/decode scratch
+
+static u32 *ring = NULL;
+static u32 ring_size = 0;		// in words
+static u32 ring_head = 0;		// next word to write
+static u32 ring_tail = 0;		// first word of the oldest entry
+static u32 ring_used = 0;
+static int ring_frames = 0;
+static int ring_max_frames = 0;
+
+// Words of region r in use right now
+static u32 liveWords(const SnapshotRegion *r)
+{
+	u32 bytes;
+
+	if(r->count == NULL)
+		return r->size >> 2;
+	bytes = (*r->count > 0) ? (u32)*r->count * r->unit : 0;
+	if(bytes > r->size)
+		bytes = r->size;
+	return (bytes + 3) >> 2;
+}
+
+static void gather(u32 *dst)
+{
+	int i;
+	for(i=0; i<snap_count; i++) {
+		memcpy(dst, snap_regions[i].ptr, liveWords(&snap_regions[i]) * sizeof(u32));
+		dst += snap_regions[i].size >> 2;
+	}
+}
+
+/*****************************************************************************
+ * Writes the image back in two passes: the fully used regions first, which  *
+ * include the counters, then the live part of the counted ones.             *
+ *****************************************************************************/
+static void scatter(const u32 *src)
+{
+	const u32 *p;
+	int pass, i;
+
+	for(pass=0; pass<2; pass++) {
+		for(i=0, p=src; i<snap_count; i++) {
+			if((snap_regions[i].count != NULL) == pass)
+				memcpy(snap_regions[i].ptr, p, liveWords(&snap_regions[i]) * sizeof(u32));
+			p += snap_regions[i].size >> 2;
+		}
+	}
+}
+
+/*****************************************************************************
+ * Codes the live words of all regions against the image. Neighbouring fully *
+ * used regions are coded as one run, the unused tail of a counted region as *
+ * one skip.                                                                 *
+ *****************************************************************************/
+static u32 encode(u32 *out)
+{
+	u32 len = 0, pos = 0, run = 0, words, live;
+	int i;
+
+	for(i=0; i<snap_count; i++) {
+		words = snap_regions[i].size >> 2;
+		live = liveWords(&snap_regions[i]);
+		pos += words;
+		if(live == words)
+			continue;
+		len += rleEncodeXor(snap_cur + run, snap_image + run, pos - words + live - run, out + len);
+		out[len++] = RLE_SKIP | (words - live);
+		run = pos;
+	}
+	return len + rleEncodeXor(snap_cur + run, snap_image + run, pos - run, out + len);
+}
+
+static void ringWrite(const u32 *src, u32 n)
+{
+	u32 first = ring_size - ring_head;
+	if(first > n) first = n;
+	memcpy(ring + ring_head, src, first*sizeof(u32));
+	memcpy(ring, src + first, (n - first)*sizeof(u32));
+	ring_head = (ring_head + n) % ring_size;
+	ring_used += n;
+}
+
+static void ringRead(u32 *dst, u32 pos, u32 n)
+{
+	u32 first = ring_size - pos;
+	if(first > n) first = n;
+	memcpy(dst, ring + pos, first*sizeof(u32));
+	memcpy(dst + first, ring, (n - first)*sizeof(u32));
+}
+
+static void dropOldest()
+{
+	u32 len = ring[ring_tail];
+	ring_tail = (ring_tail + len + 2) % ring_size;
+	ring_used -= len + 2;
+	ring_frames--;
+}
+
+int snapshotInit(const SnapshotRegion *regions, int count, int max_frames,
+                 u32 ring_words)
+{
+	int i;
+
+	snapshotFree();
+	if(count > SNAPSHOT_MAX_REGIONS || ring_words < 3)
+		return -1;
+
+	snap_words = 0;
+	for(i=0; i<count; i++) {
+		if(regions[i].size & 3)
+			return -1;
+		snap_regions[i] = regions[i];
+		snap_words += regions[i].size >> 2;
+	}
+	snap_count = count;
+
+	snap_image = memalign(32, snap_words*sizeof(u32));
+	snap_cur = memalign(32, snap_words*sizeof(u32));
+	snap_delta = memalign(32, (RLE_MAX_WORDS(snap_words) + 2*count)*sizeof(u32));
+	ring = memalign(32, ring_words*sizeof(u32));
+	if(!snap_image || !snap_cur || !snap_delta || !ring) {
+		snapshotFree();
+		return -1;
+	}
+
+	ring_size = ring_words;
+	ring_head = ring_tail = ring_used = 0;
+	ring_frames = 0;
+	ring_max_frames = max_frames;
+	gather(snap_image);
+	return 0;
+}
+
+void snapshotFree()
+{
+	free(snap_image);
+	free(snap_cur);
+	free(snap_delta);
+	free(ring);
+	snap_image = snap_cur = snap_delta = ring = NULL;
+	snap_count = 0;
+	snap_words = 0;
+	ring_size = ring_used = 0;
+	ring_frames = 0;
+}
+
+int snapshotCapture()
+{
+	u32 len;
+
+	if(ring == NULL)
+		return -1;
+
+	gather(snap_cur);
+	len = encode(snap_delta);
+
+	if(len + 2 > ring_size) {
+		// Cannot chain past this delta, older history is useless now
+		ring_head = ring_tail = ring_used = 0;
+		ring_frames = 0;
+		return -1;
+	}
+	while(ring_frames > 0 &&
+		  (ring_used + len + 2 > ring_size || ring_frames >= ring_max_frames))
+		dropOldest();
+
+	ringWrite(&len, 1);
+	ringWrite(snap_delta, len);
+	ringWrite(&len, 1);
+	ring_frames++;
+	return 0;
+}
+
+int snapshotRewind(int frames)
+{
+	int done;
+	u32 len, end;
+
+	for(done=0; done<frames && ring_frames>0; done++) {
+		// Pop the newest entry and undo it on the image
+		end = (ring_head + ring_size - 1) % ring_size;
+		len = ring[end];
+		ring_head = (end + ring_size - len - 1) % ring_size;
+		ringRead(snap_delta, (ring_head + 1) % ring_size, len);
+		rleApplyXor(snap_delta, len, snap_image, snap_words);
+		ring_used -= len + 2;
+		ring_frames--;
+	}
+	if(done > 0)
+		scatter(snap_image);
+	return done;
+}
+
+int snapshotFrames()
+{
+	return ring_frames;
+}
+
+u32 snapshotRingUsage()
+{
+	return ring_used;
+}
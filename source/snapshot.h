@@ -0,0 +1,87 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*****************************************************************************
+ * A snapshot is the concatenation of all registered memory regions. Every   *
+ * capture stores only the XOR delta to the previous snapshot, run length    *
+ * coded (see rleEncodeXor()), in a ring buffer. Because XOR deltas work in  *
+ * both directions, rewinding walks the ring backwards from the newest       *
+ * state and the oldest entries can be dropped at any time, no keyframes     *
+ * are needed.                                                               *
+ *                                                                           *
+ * A region that is only partly in use, like the arrays of an entity pool,   *
+ * can point at the variable counting its live units. Only those are copied  *
+ * and compared; the rest is coded as unchanged.                             *
+ *****************************************************************************/
+
+typedef struct {
+	void *ptr;
+	u32 size;			// in bytes, must be a multiple of 4
+	const int *count;	// live units at the start of the region, NULL if all
+	u32 unit;			// bytes per unit counted by count
+} SnapshotRegion;
+
+/****************************************************************************
+ * snapshotInit
+ *
+ * Registers the memory regions making up the game state and takes their
+ * current contents as the first snapshot.
+ * max_frames - number of frames that can be rewound at most
+ * ring_words - size of the delta ring buffer in u32 words
+ * returns: -1 on error, 0 on success
+ ***************************************************************************/
+int snapshotInit(const SnapshotRegion *regions, int count, int max_frames,
+                 u32 ring_words);
+
+/****************************************************************************
+ * snapshotFree
+ *
+ * Releases all buffers and forgets the registered regions
+ ***************************************************************************/
+void snapshotFree();
+
+/****************************************************************************
+ * snapshotCapture
+ *
+ * Records the current state of all regions. If the ring is full, the
+ * oldest snapshots are dropped.
+ * returns: -1 if the delta did not fit at all and history was lost,
+ *          0 on success
+ ***************************************************************************/
+int snapshotCapture();
+
+/****************************************************************************
+ * snapshotRewind
+ *
+ * Steps back up to frames snapshots and writes the resulting state into
+ * the registered regions
+ * returns: number of snapshots actually stepped back
+ ***************************************************************************/
+int snapshotRewind(int frames);
+
+/****************************************************************************
+ * snapshotFrames
+ *
+ * returns: number of snapshots available for rewinding
+ ***************************************************************************/
+int snapshotFrames();
+
+/****************************************************************************
+ * snapshotRingUsage
+ *
+ * returns: u32 words of the ring buffer currently in use
+ ***************************************************************************/
+u32 snapshotRingUsage();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
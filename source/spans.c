@@ -0,0 +1,46 @@
+#include <stddef.h>
+
+#include "spans.h"
+
+/*****************************************************************************
+ * Every (a,b) pair up to SPAN_MAX_RADIUS has a fixed place in one static    *
+ * pool, b+1 bytes per table. Tables for all pairs take about 18K, so none   *
+ * ever has to be evicted and the rasterizer may keep pointers to them.      *
+ *****************************************************************************/
+
+#define SPAN_SIDE (SPAN_MAX_RADIUS+1)
+#define SPAN_ROWS (SPAN_SIDE*(SPAN_SIDE+1)/2)	// all tables of one a
+
+static u8 span_pool[SPAN_SIDE*SPAN_ROWS];
+static u8 span_built[SPAN_SIDE][SPAN_SIDE];
+
+static void buildSpans(u8 *spans, int a, int b)
+{
+	// Pixel (dx,dy) is inside if it lies within the ellipse with the radii
+	// a+1/2 and b+1/2, which keeps small circles round. Doubled to stay in
+	// integers: 4*dx^2*B^2 + 4*dy^2*A^2 <= A^2*B^2 with A = 2a+1, B = 2b+1.
+	s32 A2 = (2*a+1)*(2*a+1), B2 = (2*b+1)*(2*b+1);
+	int dx = a, dy;
+
+	// The half width only shrinks going outward
+	for(dy = 0; dy <= b; dy++) {
+		while(dx > 0 && 4*(dx*dx*B2 + dy*dy*A2) > A2*B2)
+			dx--;
+		spans[dy] = dx;
+	}
+}
+
+const u8 *spansGet(int a, int b)
+{
+	u8 *spans;
+
+	if(a < 0 || b < 0 || a > SPAN_MAX_RADIUS || b > SPAN_MAX_RADIUS)
+		return NULL;
+
+	spans = span_pool + a*SPAN_ROWS + b*(b+1)/2;
+	if(!span_built[a][b]) {
+		buildSpans(spans, a, b);
+		span_built[a][b] = 1;
+	}
+	return spans;
+}
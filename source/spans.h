@@ -0,0 +1,28 @@
+#ifndef __SPANS_H__
+#define __SPANS_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SPAN_MAX_RADIUS 32	// largest radius that has a span table
+
+/****************************************************************************
+ * spansGet
+ *
+ * Returns the span table of a filled ellipse with the radii a and b, i.e.
+ * the half width of rows 0..b away from the center. Row dy covers the
+ * pixels xm-spans[dy] .. xm+spans[dy]. Tables are built on first use and
+ * stay cached, so this must not be called from more than one thread.
+ * returns: NULL if a or b is negative or above SPAN_MAX_RADIUS
+ ***************************************************************************/
+const u8 *spansGet(int a, int b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,208 @@
+#include <math.h>
+
+#include "spectrum.h"
+
+#define N       SPECTRUM_SIZE
+#define D       4			// decimation of each of the two stages
+#define HIGH    (N*D + 3)	// first stage samples the second one reads
+#define SPAN    (HIGH*D + 3)	// frames the first stage reads
+#define LOW_BANDS 6		// bands taken from the second stage
+#define FRESH   4		// set in sp_shared while the frame in it is unread
+
+static s16 sp_window[N];		// Hann, Q15
+static s16 sp_cos[N];			// twiddles, Q15
+static s16 sp_sin[N];
+static u8 sp_reverse[N];		// base 4 digit reversal
+
+// Band b covers bins sp_band[b][0] to sp_band[b][1]-1, octaves above the
+// DC bin. The lower bands are bins of the second stage, 47 Hz apart at
+// 48 kHz, the upper ones of the first stage, 188 Hz apart.
+static const u8 sp_band[SPECTRUM_BANDS][2] = {
+	{ 1, 2 }, { 2, 3 }, { 3, 5 }, { 5, 9 }, { 9, 17 }, { 17, 32 },	// to 1.5 kHz
+	{ 8, 17 }, { 17, 32 }											// to 6 kHz
+};
+
+/*****************************************************************************
+ * Triple buffer: the feeding thread owns sp_back, the reader owns sp_front  *
+ * and sp_shared holds the third frame. Both sides swap their frame with the *
+ * shared one atomically, so neither ever waits for the other.               *
+ *****************************************************************************/
+static SpectrumFrame sp_frames[3];
+static int sp_back = 0;
+static int sp_front = 1;
+static int sp_shared = 2;
+static u32 sp_seq = 0;
+
+void spectrumInit()
+{
+	int i, j, r, k;
+
+	for(i=0; i<N; i++) {
+		sp_window[i] = (s16)(16383.5f * (1.f - cosf(2.f * M_PI * i / N)));
+		sp_cos[i] = (s16)(32767.f * cosf(2.f * M_PI * i / N));
+		sp_sin[i] = (s16)(-32767.f * sinf(2.f * M_PI * i / N));
+
+		for(j=i, r=0, k=1; k<N; k<<=2, j>>=2)
+			r = (r << 2) | (j & 3);
+		sp_reverse[i] = r;
+	}
+}
+
+#define MULQ15(a, b) (((s32)(a) * (b)) >> 15)
+
+/*****************************************************************************
+ * Radix-4 butterfly on a and the three points a quarter apart each, the     *
+ * last three already twiddled. Scales by 1/4, multiplying by -j swaps the   *
+ * parts.                                                                    *
+ *****************************************************************************/
+static inline void butterfly(s16 *re, s16 *im, int a, int quarter,
+							 int br, int bi, int cr, int ci, int dr, int di)
+{
+	int b = a + quarter, c = b + quarter, d = c + quarter;
+	int t0r = re[a] + cr, t0i = im[a] + ci;
+	int t1r = re[a] - cr, t1i = im[a] - ci;
+	int t2r = br + dr, t2i = bi + di;
+	int t3r = br - dr, t3i = bi - di;
+
+	re[a] = (t0r + t2r) >> 2; im[a] = (t0i + t2i) >> 2;
+	re[b] = (t1r + t3i) >> 2; im[b] = (t1i - t3r) >> 2;
+	re[c] = (t0r - t2r) >> 2; im[c] = (t0i - t2i) >> 2;
+	re[d] = (t1r - t3i) >> 2; im[d] = (t1i + t3r) >> 2;
+}
+
+void spectrumFFT(s16 *re, s16 *im)
+{
+	int i, j, k, len, quarter, step;
+	int br, bi, cr, ci, dr, di;
+	s16 tr, ti;
+
+	for(i=0; i<N; i++) {
+		j = sp_reverse[i];
+		if(j > i) {
+			tr = re[i]; re[i] = re[j]; re[j] = tr;
+			ti = im[i]; im[i] = im[j]; im[j] = ti;
+		}
+	}
+
+	for(len=4; len<=N; len<<=2) {
+		quarter = len >> 2;
+		step = N / len;
+		for(k=0; k<N; k+=len) {
+			// W^0 needs no multiplies, that is every butterfly of the first
+			// stage and a third of them overall
+			butterfly(re, im, k, quarter, re[k+quarter], im[k+quarter],
+					  re[k+2*quarter], im[k+2*quarter], re[k+3*quarter], im[k+3*quarter]);
+
+			for(j=1; j<quarter; j++) {
+				int b = k + j + quarter, c = b + quarter, d = c + quarter;
+				int w1 = j * step, w2 = 2 * w1, w3 = 3 * w1;
+
+				br = MULQ15(re[b], sp_cos[w1]) - MULQ15(im[b], sp_sin[w1]);
+				bi = MULQ15(re[b], sp_sin[w1]) + MULQ15(im[b], sp_cos[w1]);
+				cr = MULQ15(re[c], sp_cos[w2]) - MULQ15(im[c], sp_sin[w2]);
+				ci = MULQ15(re[c], sp_sin[w2]) + MULQ15(im[c], sp_cos[w2]);
+				dr = MULQ15(re[d], sp_cos[w3]) - MULQ15(im[d], sp_sin[w3]);
+				di = MULQ15(re[d], sp_sin[w3]) + MULQ15(im[d], sp_cos[w3]);
+				butterfly(re, im, k + j, quarter, br, bi, cr, ci, dr, di);
+			}
+		}
+	}
+}
+
+/*****************************************************************************
+ * 8 steps per octave of energy, 2^32 maps to 255                            *
+ *****************************************************************************/
+static u8 level(u32 e)
+{
+	int lg;
+
+	if(e == 0)
+		return 0;
+	lg = 31 - __builtin_clz(e);
+	return (lg << 3) | ((lg >= 3 ? e >> (lg - 3) : e << (3 - lg)) & 7);
+}
+
+/*****************************************************************************
+ * Frame i of the block mixed down to mono at twice the scale, 0 outside     *
+ *****************************************************************************/
+static int mono(const short *pcm, int frames, int channels, int i)
+{
+	if(i < 0 || i >= frames)
+		return 0;
+	return (channels == 2) ? pcm[2*i] + pcm[2*i+1] : 2 * pcm[i];
+}
+
+// Power of the bin (x + jy) / 2, which is how both spectra come out of one FFT
+static u32 power(int x, int y)
+{
+	x >>= 1;
+	y >>= 1;
+	return ((s32)x * x + (s32)y * y) >> 4;
+}
+
+void spectrumFeed(const short *pcm, int samples, int channels)
+{
+	s16 high[HIGH], low[N], re[N], im[N];
+	int i, n, b, frames, first;
+	SpectrumFrame *f;
+	u32 e;
+
+	frames = samples / channels;
+	first = frames - SPAN;
+
+	// Both stages decimate by D through the triangle 1 2 3 4 3 2 1, which
+	// keeps what folds back into their range 9 to over 20 dB down. Its
+	// gain of 16 and the mixdown's 2 leave 5 bits to shift out of the first
+	// stage, 4 of the second. The unrolled stereo taps are the ones for D = 4.
+	if(channels == 2 && first >= 0) {
+		const short *x = pcm + 2*first;
+		for(n=0; n<HIGH; n++, x+=2*D)
+			high[n] = ((x[0] + x[1] + x[12] + x[13]) +
+					   2 * (x[2] + x[3] + x[10] + x[11]) +
+					   3 * (x[4] + x[5] + x[8] + x[9]) + 4 * (x[6] + x[7])) >> 5;
+	} else {
+		for(n=0; n<HIGH; n++) {
+			int s = 0;
+			for(i=0; i<7; i++)
+				s += (i < 4 ? i + 1 : 7 - i) * mono(pcm, frames, channels, first + n*D + i);
+			high[n] = s >> 5;
+		}
+	}
+	for(n=0; n<N; n++) {
+		const s16 *x = high + n*D;
+		low[n] = ((x[0] + x[6]) + 2 * (x[1] + x[5]) + 3 * (x[2] + x[4]) + 4 * x[3]) >> 4;
+	}
+
+	// Both are real, so one FFT does: the second stage, the bass from the
+	// longer window, goes in as the real part and the end of the first
+	// stage as the imaginary one. Bin i and the mirrored bin N-i tell them
+	// apart again.
+	for(n=0; n<N; n++) {
+		re[n] = MULQ15(low[n], sp_window[n]);
+		im[n] = MULQ15(high[HIGH-N+n], sp_window[n]);
+	}
+
+	spectrumFFT(re, im);
+
+	f = &sp_frames[sp_back];
+	for(b=0; b<SPECTRUM_BANDS; b++) {
+		for(i=sp_band[b][0], e=0; i<sp_band[b][1]; i++) {
+			if(b < LOW_BANDS)
+				e += power(re[i] + re[N-i], im[i] - im[N-i]);
+			else
+				e += power(im[i] + im[N-i], re[N-i] - re[i]);
+		}
+		f->energy[b] = e;
+		f->level[b] = level(e);
+	}
+	f->seq = ++sp_seq;
+
+	sp_back = __atomic_exchange_n(&sp_shared, sp_back | FRESH, __ATOMIC_ACQ_REL) & 3;
+}
+
+const SpectrumFrame * spectrumRead()
+{
+	if(__atomic_load_n(&sp_shared, __ATOMIC_ACQUIRE) & FRESH)
+		sp_front = __atomic_exchange_n(&sp_shared, sp_front, __ATOMIC_ACQ_REL) & 3;
+	return &sp_frames[sp_front];
+}
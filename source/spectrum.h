@@ -0,0 +1,66 @@
+#ifndef __SPECTRUM_H__
+#define __SPECTRUM_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SPECTRUM_SIZE  64	// FFT length, a power of four
+#define SPECTRUM_BANDS 8	// octave bands from 47 Hz to 6 kHz, band 0 is the bass
+
+typedef struct {
+	u32 energy[SPECTRUM_BANDS];	// summed power of the bins in every band
+	u8 level[SPECTRUM_BANDS];	// energy on a log scale, 0 to 255
+	u32 seq;					// number of blocks analyzed so far
+} SpectrumFrame;
+
+/****************************************************************************
+ * spectrumInit
+ *
+ * Builds the window and twiddle tables, call before the first
+ * spectrumFeed()
+ ***************************************************************************/
+void spectrumInit();
+
+/****************************************************************************
+ * spectrumFeed
+ *
+ * Analyzes the end of a block of 16 bit samples at 48 kHz and publishes
+ * the band energies. Meant to be installed as the tap of the Ogg player,
+ * see SetTapOgg(); only one thread may feed. The block is decimated by 4
+ * twice: the six lower bands come from the last 1039 frames at 3 kHz, in
+ * bins of 47 Hz, the two upper ones from the last 259 frames at 12 kHz.
+ * What lies above either range folds back, 9 dB down just above it and
+ * 20 dB down from half again its top on. The rest of the block is
+ * skipped: of the player's 4096 sample buffers (2048 stereo frames) 22 of
+ * every 43 ms are analyzed.
+ * pcm - interleaved samples
+ * samples - number of samples in pcm, all channels together
+ * channels - 1 or 2, stereo is mixed down
+ ***************************************************************************/
+void spectrumFeed(const short *pcm, int samples, int channels);
+
+/****************************************************************************
+ * spectrumRead
+ *
+ * Never waits. Any thread but the feeding one may read.
+ * returns: the most recently published frame, valid until the next call
+ ***************************************************************************/
+const SpectrumFrame * spectrumRead();
+
+/****************************************************************************
+ * spectrumFFT
+ *
+ * In place radix-4 FFT of SPECTRUM_SIZE complex Q15 values, scaled by
+ * 1/SPECTRUM_SIZE so it cannot overflow. Exposed for testing.
+ ***************************************************************************/
+void spectrumFFT(s16 *re, s16 *im);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,35 +1,58 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <gccore.h>
 #include <ogcsys.h>
 #include <wiiuse/wpad.h>
 #include <math.h>
 #include <asndlib.h>
 #include <aesndlib.h>
+#include <fat.h>
+#include <ogc/lwp_watchdog.h>
 #include "oggplayer.h"
-
-#include "sound_pcm.h"
+#include "tiles.h"
+#include "raster.h"
+#include "capture.h"
+#include "clear.h"
+#include "beam.h"
+#include "governor.h"
+#include "entity.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "collide.h"
+#include "sim.h"
+#include "input.h"
+#include "assets.h"
+#include "sfx.h"
+#include "adpcm.h"
+#include "spectrum.h"
+#include "atlas.h"
+#include "boot.h"
+
+#ifndef NO_EMBEDDED_ASSETS
+#include "sound_adpcm.h"
 #include "bg_music_ogg.h"
+#endif
+#include "gfx_atlas.h"
+#include "gfx_atlas_ids.h"
 
-#define NUM_PLAYERS 2
+#define MAX_PLAYERS SIM_MAX_PLAYERS
+#define DEFAULT_PLAYERS 2
 #define NUM_PARTICLES 1
-#define PARTICLE_MAX_WIDTH 20
-#define PARTICLE_MAX_HEIGHT 20
-#define PARTICLE_MIN_WIDTH 2
-#define PARTICLE_MIN_HEIGHT 2
-#define PARTICLE_MAX_SPEED 10
-#define PARTICLE_MIN_SPEED 1
-#define MARGIN_TOP_PERCENT 5
-#define MARGIN_BOTTOM_PERCENT 10
-#define MARGIN_LEFT_PERCENT 5
-#define MARGIN_RIGHT_PERCENT 5
-#define TOKEN_SIZE_X 5
-#define TOKEN_SIZE_Y 50
-
-const int PARTICLE_MAX_FREQ  = VOICE_FREQ48KHZ;
-const int PARTICLE_MIN_FREQ = VOICE_FREQ48KHZ>>1;
-const int PARTICLE_MAX_SIZE = PARTICLE_MAX_WIDTH*PARTICLE_MAX_HEIGHT;
-const int PARTICLE_MIN_SIZE = PARTICLE_MIN_WIDTH*PARTICLE_MIN_HEIGHT;
+#define MAX_ENTITIES 4096
+#define FRAME_ARENA_SIZE (256*1024)
+#define REWIND_SECONDS 10
+#define REWIND_SPEED 2				// snapshots stepped back per frame
+#define REWIND_RING_WORDS (1024*1024)
+#define TOKEN_TILT_DIVISOR 4			// degrees of tilt per pixel of motion
+#define CPU_TOKEN_SPEED 6			// pixels per frame a CPU player moves at most
+#define CAPTURE_PATH "sd:/capture.fbc"
+#define MUSIC_START_BYTES (64*1024)	// streamed music starts with this much
+#define SFX_CACHE_BUDGET (256*1024)	// decoded sound effects
+#define TRAIL_DECAY 192				// brightness kept per frame in trail mode, /256
+#define BEAM_LEAD_LINES 16			// margin for the estimated beam position
+#define HUD_SIZE 512				// bytes of status text
 
 // Global definitions
 static void *g_xfb[2]; 				// external framebuffers, double buffering
@@ -37,31 +60,50 @@ int g_fbi=0;						// index of current framebuffer
 static GXRModeObj *g_vmode = NULL;	// ref. to render mode object
 int g_fb_height, g_fb_width;		// dimensions of external fb
 s32 g_voice;						// voice handle
-WPADData *g_wpd[NUM_PLAYERS];		// for handling controller input
+WPADData g_pad[WPAD_MAX_WIIMOTES];	// newest report of every Wiimote
+WPADData *g_wpd[WPAD_MAX_WIIMOTES];	// for handling controller input
 s32 g_shutDownType = -1;			// flag for callback functions
 int evctr = 0;						// event counter
 int g_simulate = 1;					// should the particle simulation run?
-
-int g_border_t;						// upper display boundary
-int g_border_b;						// lower display boundary
-int g_border_l;						// left display boundary
-int g_border_r;						// right display boundary
-int g_vi_width;						// dimension of the display in x-dir
-int g_vi_height;					// dimension of the display in y-dir
-
-typedef struct {
-	int pos_x, pos_y;   // screen coordinates
-	int size_x, size_y; // dimensions
-	int dx, dy;         // speed values
-	int freq;		    // frequency of collision sound
-}Particle;
-
-// Particles moving around
-Particle g_particles[NUM_PARTICLES];
-
-// Player's token for blocking particles
-Particle g_player_token[NUM_PLAYERS];
+int g_trail = 0;					// fade the last frame instead of clearing
+int g_beam = 0;						// race the beam in a single buffer
+BeamRace g_beam_race;				// band timing of the beam racing mode
+static int g_beam_top, g_beam_lines;	// visible part of a field in VI lines
+static int g_beam_field;				// VI lines per field
+static u32 g_beam_retrace;				// retrace count of the field raced for
+int g_storage = 0;					// is the SD card available?
+u32 g_frame = 0;					// frame counter
+int g_sfx_left = 0;					// sound effects left for this frame
+static char g_hud_none[1];			// shown if the arena is exhausted
+char *g_hud = g_hud_none;			// status text in the frame arena, see updateHud()
+int g_hud_stale = 1;				// rebuild the status text next frame
+FrameArena g_frame_arena;			// per-frame scratch memory
+u64 g_boot;							// gettime() when main() was entered
+u32 g_first_frame_us = 0;			// time from g_boot to the first VSync
+
+// Startup steps and what each of them needs first, see init()
+enum { BOOT_STORAGE, BOOT_VIDEO, BOOT_AUDIO, BOOT_CONTROLS, BOOT_GAME,
+	   BOOT_SYNC, NUM_BOOT_STEPS };
+extern BootStep g_boot_steps[NUM_BOOT_STEPS];
+
+// Music and sound are loaded from storage, the copies linked into the DOL
+// are used until then or if that fails
+enum { ASSET_MUSIC, ASSET_SOUND, NUM_ASSETS };
+Asset g_assets[NUM_ASSETS] = { { "bg_music.ogg" }, { "sound.adpcm" } };
+int g_music = 0;					// 0 = silent, 1 = embedded, 2 = streamed
+int g_music_broken = 0;				// streaming the loaded file failed
+const void *g_sound = NULL;			// ADPCM collision sound, see initAudio()
+u32 g_sound_size = 0;
+SfxCache g_sfx;						// decoded sound effects
+
+// Particles moving around, the players' tokens for blocking them and the
+// playfield, see sim.h
+Sim g_sim;
 int g_token_colors[4] = {COLOR_RED, COLOR_GREEN, COLOR_WHITE, COLOR_BLUE};
+Sprite g_remote_icon;				// shown for every connected Wiimote
+
+void setPlayers(int num);
+int activeParticles();
 
 // Callback functions
 
@@ -89,12 +131,26 @@ void cb_WiimotePowerButtonPressed(s32 chan) {
 }
 
 /*****************************************************************************
- * General callback triggered by arbitrary Wiimote events                    *
+ * Called from the game loop for every channel with new Wiimote reports,     *
+ * button presses are merged over all reports since the last frame           *
  *****************************************************************************/
 void cb_WiimoteEventFired(int chan, const WPADData *data) {
 	evctr++;
 	if(data->btns_d & WPAD_BUTTON_A) g_simulate^=1;
-	else if(data->btns_d & WPAD_BUTTON_HOME) exit(0); // Return to loader
+	else if(data->btns_d & WPAD_BUTTON_PLUS) setPlayers(g_sim.num_players+1);
+	else if(data->btns_d & WPAD_BUTTON_MINUS) setPlayers(g_sim.num_players-1);
+	else if(data->btns_d & WPAD_BUTTON_2) g_trail^=1;
+	else if(data->btns_d & WPAD_BUTTON_UP) g_beam^=1;
+	else if(data->btns_d & WPAD_BUTTON_1) {
+		// Toggle framebuffer capture to the SD card
+		if(captureActive()) captureStop();
+		else if(g_storage) captureStart(CAPTURE_PATH, g_fb_width, g_fb_height);
+	}
+	else if(data->btns_d & WPAD_BUTTON_HOME) {
+		inputStop();
+		captureStop();
+		exit(0); // Return to loader
+	}
 
 }
 
@@ -133,125 +189,43 @@ void cb_WiimoteEventFired(int chan, const WPADData *data) {
  * 		=> L(639,479) = 320 * 479 + (639>>1) = 153599.                       *
  *****************************************************************************/
 
-void drawPixel(int x, int y, int color) {
-	u32 *tmpfb = g_xfb[g_fbi];
-	x>>=1;
-	y *= g_fb_width>>1;
-	tmpfb[y+x] = color;
-}
+/*****************************************************************************
+ * All primitives clip against the framebuffer, so callers may pass any      *
+ * coordinates. The basic ones go through the kernel set that initVideo()    *
+ * picked for the current fbWidth, which has the row stride as a constant;   *
+ * raster.c builds the others from them, where tools/rasterbench tests them. *
+ *****************************************************************************/
 
-void drawHLine0 (int x1, int x2, int y, int color) {
-    int i;
-    y = 320 * y;
-    x1 >>= 1;
-    x2 >>= 1;
-    for (i = x1; i <= x2; i++) {
-        u32 *tmpfb = g_xfb[g_fbi];
-        tmpfb[y+i] = color;
-    }
+void drawPixel(int x, int y, int color) {
+	g_raster.pixel(g_xfb[g_fbi], x, y, color);
 }
 
 void drawHLine (int x1, int x2, int y, int color) {
-    int i;
-    x1 >>= 1;
-    x2 >>= 1;
-    y *= g_fb_width>>1;
-    u32 *tmpfb = g_xfb[g_fbi];
-    tmpfb += y;
-    for (i = x1; i <= x2; i++) {
-        tmpfb[i] = color;
-    }
-}
-
-void drawVLine0 (int x, int y1, int y2, int color) {
-    int i;
-    x >>= 1;
-    for (i = y1; i <= y2; i++) {
-        u32 *tmpfb = g_xfb[g_fbi];
-        tmpfb[x + ((640 * i) >> 1)] = color;
-    }
+	g_raster.hline(g_xfb[g_fbi], x1, x2, y, color);
 }
 
 void drawVLine (int x, int y1, int y2, int color) {
-    int i;
-    x >>= 1;
-    u32 *tmpfb = g_xfb[g_fbi];
-    tmpfb += x;
-    for (i = y1; i <= y2; i++) {
-        tmpfb[(g_fb_width>>1)*i] = color;
-    }
-}
-
-void drawLine(int x0, int y0, int x1, int y1, int color)
-{
-  int dx =  abs(x1-x0), sx = x0<x1 ? 1 : -1;
-  int dy = -abs(y1-y0), sy = y0<y1 ? 1 : -1;
-  int err = dx+dy, e2; /* error value e_xy */
-
-  for(;;) {
-	  drawPixel(x0,y0, color);
-	  if (x0==x1 && y0==y1) break;
-	  e2 = 2*err;
-	  if (e2 > dy) { err += dy; x0 += sx; } /* e_xy+e_x > 0 */
-	  if (e2 < dx) { err += dx; y0 += sy; } /* e_xy+e_y < 0 */
-  }
+	g_raster.vline(g_xfb[g_fbi], x, y1, y2, color);
+}
+
+void drawLine(int x0, int y0, int x1, int y1, int color) {
+	rasterLine(g_xfb[g_fbi], x0, y0, x1, y1, color);
 }
 
 void drawBox (int x1, int y1, int x2, int y2, int color) {
-    drawHLine (x1, x2, y1, color);
-    drawHLine (x1, x2, y2, color);
-    drawVLine (x1, y1, y2, color);
-    drawVLine (x2, y1, y2, color);
+	rasterBox(g_xfb[g_fbi], x1, y1, x2, y2, color);
 }
 
 void drawParticle(int x1, int y1, int x2, int y2, int color) {
-	int i;
-	for(i=y1; i<=y2; i++)
-		drawHLine(x1, x2, i, color);
+	g_raster.fill(g_xfb[g_fbi], x1, y1, x2, y2, color);
 }
 
 void drawdot(float w, float h, float fx, float fy, u32 color) {
-	u32 *fb;
-	int px,py;
-	int x,y;
-	fb = (u32*)g_xfb[g_fbi];
-
-	y = fy * g_fb_height / h;
-	x = fx * g_fb_width  / w / 2;
-
-	for(py=y-4; py<=(y+4); py++) {
-		if(py < 0 || py >= g_fb_height)
-				continue;
-		for(px=x-2; px<=(x+2); px++) {
-			if(px < 0 || px >= g_fb_width/2)
-				continue;
-			fb[g_fb_width/VI_DISPLAY_PIX_SZ*py + px] = color;
-		}
-	}
-
+	rasterDot(g_xfb[g_fbi], w, h, fx, fy, color);
 }
 
-void drawEllipse(int xm, int ym, int a, int b, int color)
-{
-   int dx = 0, dy = b;
-   long a2 = a*a, b2 = b*b;
-   long err = b2-(2*b-1)*a2, e2;
-
-   do {
-       drawPixel(xm+dx, ym+dy, color);
-       drawPixel(xm-dx, ym+dy, color);
-       drawPixel(xm-dx, ym-dy, color);
-       drawPixel(xm+dx, ym-dy, color);
-
-       e2 = 2*err;
-       if (e2 <  (2*dx+1)*b2) { dx++; err += (2*dx+1)*b2; }
-       if (e2 > -(2*dy-1)*a2) { dy--; err -= (2*dy-1)*a2; }
-   } while (dy >= 0);
-
-   while (dx++ < a) {
-	   drawPixel(xm+dx, ym, color);
-	   drawPixel(xm-dx, ym, color);
-   }
+void drawEllipse(int xm, int ym, int a, int b, int color) {
+	rasterEllipse(g_xfb[g_fbi], xm, ym, a, b, color);
 }
 
 void displayIR(int chan) {
@@ -259,7 +233,7 @@ void displayIR(int chan) {
 	float theta;
 
 	// IR dots
-	for(i=0; i<NUM_PLAYERS; i++) {
+	for(i=0; i<4; i++) {
 		if(g_wpd[chan]->ir.dot[i].visible) {
 			drawdot(1024, 768, g_wpd[chan]->ir.dot[i].rx, g_wpd[chan]->ir.dot[i].ry,
 					COLOR_YELLOW);
@@ -281,6 +255,44 @@ void displayIR(int chan) {
 	}
 }
 
+/*****************************************************************************
+ * Beam position in framebuffer lines for beamRace(). The VI counts lines of *
+ * the current field from its vertical sync; the picture starts after the    *
+ * blanking lines and a field covers the whole framebuffer. Fields that      *
+ * went by since the one raced for add their lines, see BeamLineFn. The      *
+ * estimate is moved down by BEAM_LEAD_LINES, so bands are finished with     *
+ * some margin.                                                              *
+ *****************************************************************************/
+static int beamLine(void) {
+	int fields = VIDEO_GetRetraceCount() - g_beam_retrace;
+
+	return (fields * g_beam_field + (int)VIDEO_GetCurrentLine() - g_beam_top)
+		   * g_fb_height / g_beam_lines + BEAM_LEAD_LINES;
+}
+
+/*****************************************************************************
+ * Draws one band of the frame in beam racing mode: clears it and rasterizes *
+ * the tile row it consists of                                               *
+ *****************************************************************************/
+static void drawBand(int y1, int y2, void *arg) {
+	g_raster.fill(g_xfb[g_fbi], 0, y1, g_fb_width - 1, y2, CLEAR_BLACK);
+	tilesWorkRow(g_xfb[g_fbi], y1 / TILE_HEIGHT);
+}
+
+/*****************************************************************************
+ * Playfield lines as tile primitives, so they can be drawn band by band     *
+ *****************************************************************************/
+void queueBackground() {
+	const CollideBounds *f = &g_sim.bounds;
+	int cx = (f->l + f->r) >> 1;
+
+	tilesAddRect(f->l, f->t, f->r, f->t, COLOR_WHITE);
+	tilesAddRect(f->l, f->b, f->r, f->b, COLOR_WHITE);
+	tilesAddRect(f->l, f->t, f->l, f->b, COLOR_WHITE);
+	tilesAddRect(f->r, f->t, f->r, f->b, COLOR_WHITE);
+	tilesAddRect(cx, f->t, cx, f->b, COLOR_WHITE);
+}
+
 void printVideoInfo() {
 
 	if(g_vmode!=NULL)
@@ -357,108 +369,273 @@ void printWiimoteinfo(int chan) {
 }
 
 
+/*****************************************************************************
+ * Rebuilds the status text. Formatting is only redone as often as the       *
+ * quality governor allows, the text itself is printed every frame. It lives *
+ * in the frame arena: frames in between copy it over from the previous      *
+ * frame, whose allocations are still valid.                                 *
+ *****************************************************************************/
+void updateHud(const int *ret) {
+	static const char *music_source[] = { "off", "embedded", "streamed" };
+	static u32 hud_frame = 0;		// frame the current text was allocated in
+	const char *prev = g_hud;
+	OggStats ogg;
+	int i, n = 0;
+
+	g_hud = ARENA_NEW(&g_frame_arena, char, HUD_SIZE);
+	if(g_hud == NULL) {
+		g_hud = g_hud_none;
+		g_hud_stale = 1;
+		return;
+	}
+	if(g_frame % governorSettings()->hud_interval != 0 && !g_hud_stale &&
+	   hud_frame == g_frame - 1) {
+		strcpy(g_hud, prev);
+		hud_frame = g_frame;
+		return;
+	}
+	g_hud_stale = 0;
+	hud_frame = g_frame;
+
+	for(i=0; i<g_sim.num_players && n<HUD_SIZE; i++) {
+		switch(ret[i]) {
+			case WPAD_ERR_NO_CONTROLLER:
+				n += snprintf(g_hud+n, HUD_SIZE-n, " Wiimote %d not connected\n", i);
+				break;
+			case WPAD_ERR_NOT_READY:
+				n += snprintf(g_hud+n, HUD_SIZE-n, " Wiimote %d not ready\n", i);
+				break;
+			case WPAD_ERR_NONE:
+				n += snprintf(g_hud+n, HUD_SIZE-n, " Wiimote %d ready\n", i);
+				break;
+			default:
+				n += snprintf(g_hud+n, HUD_SIZE-n, " Unknown status of Wiimote %d: %d\n", i, ret[i]);
+		}
+	}
+	if(n < HUD_SIZE)
+		n += snprintf(g_hud+n, HUD_SIZE-n, " Quality %d, %u/%u us, input age %u us\n",
+				 governorLevel(), governorCost(), governorBudget(), inputAge());
+	if(n < HUD_SIZE)
+		n += snprintf(g_hud+n, HUD_SIZE-n, " Clear: waited %u us for the GPU, %u us on the CPU,"
+				 " fade %u us\n", clearWaitUs(), clearCpuUs(), clearDecayUs());
+	if(n < HUD_SIZE)
+		n += snprintf(g_hud+n, HUD_SIZE-n, " First frame %u ms, music %s %u/%u ms\n",
+				 g_first_frame_us / 1000, music_source[g_music],
+				 g_assets[ASSET_MUSIC].first_us / 1000,
+				 g_assets[ASSET_MUSIC].load_us / 1000);
+	if(n < HUD_SIZE)
+		n += snprintf(g_hud+n, HUD_SIZE-n, " Startup us: video %u audio %u wpad %u game %u"
+				 " sync %u, storage %u\n",
+				 g_boot_steps[BOOT_VIDEO].us, g_boot_steps[BOOT_AUDIO].us,
+				 g_boot_steps[BOOT_CONTROLS].us, g_boot_steps[BOOT_GAME].us,
+				 g_boot_steps[BOOT_SYNC].us, g_boot_steps[BOOT_STORAGE].us);
+
+	// Audio health since the last update, to tell starved decoding apart
+	// from a blocked player thread
+	GetStatsOgg(NULL, &ogg);
+	if(n < HUD_SIZE)
+		n += snprintf(g_hud+n, HUD_SIZE-n, " Audio: %u+%u us/buffer, fill %u%%, underruns %u,"
+				 " holes %u, wakeups %u\n",
+				 ogg.buffers ? ogg.decode_us / ogg.buffers : 0,
+				 ogg.buffers ? ogg.tap_us / ogg.buffers : 0,
+				 ogg.callbacks ? ogg.fill / ogg.callbacks * 100 / OGG_BUFFER_SAMPLES : 0,
+				 ogg.underruns, ogg.holes, ogg.wakeups);
+	if(tilesDropped() && n < HUD_SIZE)
+		n += snprintf(g_hud+n, HUD_SIZE-n, " Tiles: %u primitives dropped\n",
+				 tilesDropped());
+	if(captureActive() && n < HUD_SIZE)
+		n += snprintf(g_hud+n, HUD_SIZE-n, " Capture: %u us encode, %u frames dropped\n",
+				 captureEncodeUs(), captureDropped());
+	if(g_beam_race.frames && n < HUD_SIZE)
+		n += snprintf(g_hud+n, HUD_SIZE-n, " Beam racing: %u/%u bands late,"
+				 " least slack %d lines\n",
+				 g_beam_race.late, g_beam_race.bands, g_beam_race.min_slack);
+}
+
 // Init and update routines
 
-int rnd(int a, int b) {
-	return rand() % (b-a+1) + a;
+/*****************************************************************************
+ * Changes the number of players at runtime                                  *
+ *****************************************************************************/
+void setPlayers(int num) {
+	simSetPlayers(&g_sim, num);
+	g_hud_stale = 1;
 }
 
-void initToken() {
-	int i;
-	for(i=0; i<NUM_PLAYERS; i++)
+/*****************************************************************************
+ * Steers all tokens in one pass over the connected Wiimotes. Each token     *
+ * moves along its border only, following the IR cursor or, while the        *
+ * cursor is lost, the tilt of the remote. The CPU plays for players whose   *
+ * Wiimote is not connected.                                                 *
+ *****************************************************************************/
+void updateToken(const int *ret) {
+	int i, aim, pos;
+	float tilt;
+	Particle *t;
+	for(i=0; i<g_sim.num_players; i++)
 	{
-		g_player_token[i].dx = 0;
-		g_player_token[i].dy = 0;
-		g_player_token[i].size_x = TOKEN_SIZE_X;
-		g_player_token[i].size_y = TOKEN_SIZE_Y;
-		g_player_token[i].pos_x = (i%2==0)?(g_border_l+2):(g_border_r-g_player_token[i].size_x);
-		g_player_token[i].pos_y = g_border_t+((g_vi_height-g_player_token[i].size_y)>>1);
+		t = simToken(&g_sim, i);
+		if(t == NULL)
+			continue;
+		if(ret[i] != WPAD_ERR_NONE) {
+			simAutoSteer(&g_sim, i, activeParticles(), CPU_TOKEN_SPEED);
+			continue;
+		}
+
+		if(i < 2) {
+			pos = t->pos_y;
+			aim = g_wpd[i]->ir.y - (t->size_y>>1);
+			tilt = -g_wpd[i]->orient.pitch;
+		}
+		else {
+			pos = t->pos_x;
+			aim = g_wpd[i]->ir.x - (t->size_x>>1);
+			tilt = g_wpd[i]->orient.roll;
+		}
+		if(!g_wpd[i]->ir.valid)
+			aim = pos + (int)tilt / TOKEN_TILT_DIVISOR;
+
+		simSteer(&g_sim, i, aim);
 	}
 }
 
-void updateToken() {
-	int i, pos_y;
-	for(i=0; i<NUM_PLAYERS; i++)
+void drawTokens() {
+	int i;
+	Particle *t;
+	for(i=0; i<g_sim.num_players; i++)
 	{
-		// TODO Fit wiimote motion to token
-		if(g_wpd[i]->ir.valid)
-		{
-			pos_y = g_wpd[i]->ir.y - (g_player_token[i].size_y>>1);
-//			g_player_token[i].pos_y = (pos_y<g_border_t)?g_border_t:pos_y;
-//			if(pos_y>g_border_b-g_player_token[i].size_y)
-//				g_player_token[i].pos_y = g_border_b - g_player_token[i].size_y;
-		}
-
-		// Draw token
-		drawParticle(g_player_token[i].pos_x,  g_player_token[i].pos_y,
-					 g_player_token[i].pos_x + g_player_token[i].size_x - 1,
-					 g_player_token[i].pos_y + g_player_token[i].size_y - 1,
+		t = simToken(&g_sim, i);
+		if(t == NULL)
+			continue;
+
+		// Queue token for the tile rasterizer
+		tilesAddRect(t->pos_x,  t->pos_y,
+					 t->pos_x + t->size_x - 1,
+					 t->pos_y + t->size_y - 1,
 					 g_token_colors[i]);
 	}
 }
 
-void initParticles() {
-	srand(time(NULL));
-	int i, size;
-	for(i=0; i<NUM_PARTICLES; i++) {
-		// Create particle with random size, position and speed
-		g_particles[i].size_x = rnd(PARTICLE_MIN_WIDTH, PARTICLE_MAX_WIDTH);
-		g_particles[i].size_y = rnd(PARTICLE_MIN_HEIGHT, PARTICLE_MAX_HEIGHT);
-		g_particles[i].pos_x = rnd(g_border_l, g_border_r-g_particles[i].size_x-1);
-		g_particles[i].pos_y = rnd(g_border_t, g_border_b-g_particles[i].size_y-1);
-		g_particles[i].dx = rnd(PARTICLE_MIN_SPEED, PARTICLE_MAX_SPEED);
-		g_particles[i].dy = rnd(PARTICLE_MIN_SPEED, PARTICLE_MAX_SPEED);
-
-		if(rand() % 1) g_particles[i].dx = -g_particles[i].dx;
-		if(rand() % 1) g_particles[i].dy = -g_particles[i].dy;
-
-		// Determine frequency of collision sound depending on particle size
-		// (linear interpolation)
-		size = g_particles[i].size_x*g_particles[i].size_y;
-		g_particles[i].freq = PARTICLE_MIN_FREQ +
-							 (PARTICLE_MAX_FREQ - PARTICLE_MIN_FREQ) /
-							 (PARTICLE_MAX_SIZE - PARTICLE_MIN_SIZE) *
-							 (PARTICLE_MAX_SIZE - size);
-	}
+/*****************************************************************************
+ * Starts a collision sound unless this frame already used up its share      *
+ *****************************************************************************/
+void playCollisionSound(int freq) {
+	const s16 *pcm;
+	u32 bytes;
+
+	if(g_sfx_left <= 0 || g_sound == NULL)
+		return;
+
+	// Decoded on first use, later calls only look it up
+	pcm = sfxCacheGet(&g_sfx, g_sound, g_sound_size, &bytes);
+	if(pcm == NULL)
+		return;
+	g_sfx_left--;
+	g_voice=ASND_GetFirstUnusedVoice();
+	ASND_SetVoice(g_voice, VOICE_MONO_16BIT, freq, 0,
+				 (void *)pcm, bytes, 63, 63, NULL);
+}
+
+/*****************************************************************************
+ * The quality governor decides how many particles we can afford. Those it   *
+ * takes away are despawned rather than frozen, and new ones are spawned     *
+ * when it gives them back.                                                  *
+ *****************************************************************************/
+int activeParticles() {
+	int num = NUM_PARTICLES * governorSettings()->particles_pct / 100;
+	return (num < 1) ? 1 : num;
 }
 
 void updateParticles() {
 	int i;
-	for(i=0; i<NUM_PARTICLES; i++) {
-		// Apply changes in movement
-		g_particles[i].pos_x += g_particles[i].dx;
-		g_particles[i].pos_y += g_particles[i].dy;
-
-		// Check for collisions with screen boundaries
-		if(g_particles[i].pos_x < g_border_l || g_particles[i].pos_x > (g_border_r-g_particles[i].size_x)) {
-			g_particles[i].dx = -g_particles[i].dx;
-			g_particles[i].pos_x = (g_particles[i].pos_x<g_border_l)?g_border_l:g_border_r-g_particles[i].size_x;
-			g_voice=ASND_GetFirstUnusedVoice();
-			ASND_SetVoice(g_voice, VOICE_MONO_16BIT, g_particles[i].freq, 0,
-						 (u8 *)sound_pcm, sound_pcm_size, 63, 63, NULL);
-		}
+	u8 *hits;
 
-		if(g_particles[i].pos_y < g_border_t || g_particles[i].pos_y > (g_border_b-g_particles[i].size_y)) {
-			g_particles[i].dy = -g_particles[i].dy;
-			g_particles[i].pos_y = (g_particles[i].pos_y<g_border_t)?g_border_t:g_border_b-g_particles[i].size_y;
-			g_voice=ASND_GetFirstUnusedVoice();
-			ASND_SetVoice(g_voice, VOICE_MONO_16BIT, g_particles[i].freq, 0,
-						 (u8 *)sound_pcm, sound_pcm_size, 63, 63, NULL);
-		}
+	g_sfx_left = governorSettings()->sfx_per_frame;
+	simFitBalls(&g_sim, activeParticles());
+
+	hits = ARENA_NEW(&g_frame_arena, u8, g_sim.entities.count);
+	if(hits == NULL)
+		return;
+
+	simStep(&g_sim, activeParticles(), hits);
 
-		// Display updated particle
-		drawParticle(g_particles[i].pos_x,  g_particles[i].pos_y,
-					 g_particles[i].pos_x + g_particles[i].size_x - 1,
-					 g_particles[i].pos_y + g_particles[i].size_y - 1,
-					 COLOR_WHITE);
+	for(i=0; i<g_sim.entities.count; i++) {
+		if(hits[i] & (COLLIDE_BORDER_X | COLLIDE_PADDLE))
+			playCollisionSound(g_sim.entities.items[i].freq);
+		if(hits[i] & COLLIDE_BORDER_Y)
+			playCollisionSound(g_sim.entities.items[i].freq);
 	}
 }
 
+void drawParticles() {
+	int i, n, num, pulse = 0;
+	Particle *p;
+
+	// Particles pulse with the bass of the music
+	if(governorSettings()->effect_detail > 0)
+		pulse = spectrumRead()->level[0] >> 6;
+
+	num = activeParticles();
+	for(i=0, n=0; i<g_sim.entities.count && n<num; i++) {
+		if(g_sim.entities.types[i] != ENTITY_BALL)
+			continue;
+		p = &g_sim.entities.items[i];
+		n++;
+
+		// Queue a round particle for the tile rasterizer, the collision
+		// box stays rectangular
+		tilesAddEllipse(p->pos_x + (p->size_x>>1), p->pos_y + (p->size_y>>1),
+						(p->size_x>>1) + pulse, (p->size_y>>1) + pulse,
+						COLOR_WHITE);
+	}
+}
+
+/*****************************************************************************
+ * Registers everything that makes up the game state with the rewind buffer  *
+ *****************************************************************************/
+void initSnapshots() {
+	EntityPool *pool = &g_sim.entities;
+	SnapshotRegion regions[] = {
+		// Only the live entities, the slot arrays in full. MAX_ENTITIES is
+		// even, so owner ends on a word boundary.
+		{ pool->items,        pool->capacity * sizeof(Particle), &pool->count, sizeof(Particle) },
+		{ pool->types,        (pool->capacity + 3) & ~3,         &pool->count, 1 },
+		{ pool->owner,        pool->capacity * sizeof(u16),      &pool->count, sizeof(u16) },
+		{ pool->dense,        3 * pool->capacity * sizeof(u16) },	// and generation, next_free
+		{ &pool->count,       sizeof(pool->count) },
+		{ &pool->free_head,   sizeof(pool->free_head) },
+		{ g_sim.token,        sizeof(g_sim.token) },
+		{ &g_sim.num_players, sizeof(g_sim.num_players) },
+		{ &g_sim.rng,         sizeof(g_sim.rng) },
+		{ &g_sim.bounds,      sizeof(g_sim.bounds) },
+		{ &g_simulate,        sizeof(g_simulate) }
+	};
+	snapshotInit(regions, sizeof(regions)/sizeof(regions[0]),
+				 REWIND_SECONDS*60, REWIND_RING_WORDS);
+}
+
+
+/*****************************************************************************
+ * Shows msg on the screen and returns to the loader a few seconds later.    *
+ * Only for setup steps the game cannot run without.                         *
+ *****************************************************************************/
+void fatal(const char *msg) {
+	console_init(g_xfb[g_fbi], 20, 20, g_fb_width, g_fb_height,
+				 g_fb_width * VI_DISPLAY_PIX_SZ);
+	printf("\n\n %s\n", msg);
+	VIDEO_SetNextFramebuffer(g_xfb[g_fbi]);
+	VIDEO_Flush();
+	sleep(5);
+	exit(1);
+}
 
 /*****************************************************************************
  * Initialization of the video system                                        *                                  *
  *****************************************************************************/
 void initVideo() {
+	int interlaced;
+	int tiles;
+
 	// Initialise the video system
 	VIDEO_Init();
 
@@ -475,10 +652,15 @@ void initVideo() {
 	g_xfb[1] = MEM_K0_TO_K1(SYS_AllocateFramebuffer(g_vmode));
 	g_fb_width = g_vmode->fbWidth;
 	g_fb_height = g_vmode->xfbHeight;
+	rasterInit(g_fb_width, g_fb_height);
+	tiles = tilesInit(g_fb_width, g_fb_height);
 
 	// Set up the video registers with the chosen mode
 	VIDEO_Configure(g_vmode);
 
+	// Clearing the back buffer is done by the GPU, see clear.c
+	clearInit(g_vmode, g_xfb, (GXColor){0, 0, 0, 0xff});
+
 	// Tell the video hardware where our display memory is
 	VIDEO_SetNextFramebuffer(g_xfb[g_fbi]);
 
@@ -488,18 +670,26 @@ void initVideo() {
 	// Flush the video register changes to the hardware
 	VIDEO_Flush();
 
-	// Wait for Video setup to complete
+	// The first visible line of a field follows the vertical sync and the
+	// pre-blanking of the VI timing, about 21 lines for NTSC and 25 for PAL
+	interlaced = (g_vmode->viTVMode & VI_NON_INTERLACE) ? 0 : 1;
+	g_beam_top = (VIDEO_GetCurrentTvMode() == VI_PAL ? 25 : 21) +
+				 (g_vmode->viYOrigin >> interlaced);
+	g_beam_lines = g_vmode->viHeight >> interlaced;
+	g_beam_field = (VIDEO_GetCurrentTvMode() == VI_PAL ? 625 : 525) >> interlaced;
+	beamInit(&g_beam_race, beamLine, g_fb_height, TILE_HEIGHT);
+
+	if(tiles < 0)
+		fatal("Video mode too large for the tile rasterizer");
+}
+
+/*****************************************************************************
+ * Waits for the video setup to complete. Kept apart from initVideo() so     *
+ * that everything else can be set up while the registers are latched.       *
+ *****************************************************************************/
+void syncVideo() {
 	VIDEO_WaitVSync();
 	if(g_vmode->viTVMode&VI_NON_INTERLACE) VIDEO_WaitVSync();
-
-	// Setup display region
-	g_border_t = (int)((float)g_fb_height * MARGIN_TOP_PERCENT) / 100.f;
-	g_border_b = (int)((float)g_fb_height *
-				 (1.f - MARGIN_BOTTOM_PERCENT/100.f));
-	g_border_l = (int)((float)g_fb_width * MARGIN_LEFT_PERCENT) / 100.f;
-	g_border_r = (int)((float)g_fb_width * (1.f - MARGIN_RIGHT_PERCENT/100.f));
-	g_vi_width = g_border_r - g_border_l;
-	g_vi_height = g_border_b - g_border_t;
 }
 
 /*****************************************************************************
@@ -511,8 +701,56 @@ void initAudio() {
 	ASND_Init(NULL);
 	ASND_Pause(0);
 
-	// Start background music
-	PlayOgg(bg_music_ogg, bg_music_ogg_size, 0, OGG_INFINITE_TIME);
+	sfxCacheInit(&g_sfx, SFX_CACHE_BUDGET);
+#ifndef NO_EMBEDDED_ASSETS
+	g_sound = sound_adpcm;
+	g_sound_size = sound_adpcm_size;
+#endif
+	// Background music is started by updateAssets(), its decoded buffers
+	// drive the visuals through the spectrum analyzer
+	spectrumInit();
+	SetTapOgg(spectrumFeed);
+}
+
+/*****************************************************************************
+ * Switches music and sound over to the loaded assets as soon as they can    *
+ * be used. Music streams from the first pages on, while the rest of the     *
+ * file is still being read.                                                 *
+ *****************************************************************************/
+void updateAssets() {
+	Asset *music = &g_assets[ASSET_MUSIC];
+	Asset *sound = &g_assets[ASSET_SOUND];
+
+	// The asset's state belongs to the loader thread, failures to stream
+	// it are kept here
+	if(g_music == 2 && StatusOgg() != OGG_STATUS_RUNNING) {
+		g_music = 0;
+		g_music_broken = 1;
+	}
+
+	if(g_music == 0 && !g_music_broken && (music->state == ASSET_READY ||
+	   (music->state == ASSET_LOADING && music->loaded >= MUSIC_START_BYTES))) {
+		if(PlayOggStream(music->data, music->size, &music->loaded,
+						 0, OGG_INFINITE_TIME) == 0)
+			g_music = 2;
+		else
+			g_music_broken = 1;
+	}
+
+	// Fall back to the embedded copy, if there is one
+#ifndef NO_EMBEDDED_ASSETS
+	if(g_music == 0 && (music->state == ASSET_FAILED || g_music_broken)) {
+		PlayOgg(bg_music_ogg, bg_music_ogg_size, 0, OGG_INFINITE_TIME);
+		g_music = 1;
+	}
+#endif
+
+	// The file is untrusted, every block the header claims has to be there
+	if(sound->state == ASSET_READY && g_sound != sound->data &&
+	   adpcmSamples(sound->data, sound->size) > 0) {
+		g_sound = sound->data;
+		g_sound_size = sound->size;
+	}
 }
 
 /*****************************************************************************
@@ -523,110 +761,239 @@ void initControls() {
 	// Initialize the attached controllers
 	WPAD_Init();
 
-	for(i=0; i<NUM_PLAYERS;i++)
+	for(i=0; i<WPAD_MAX_WIIMOTES;i++)
 	{
 		//	Configure infrared system of the Wii remote
 		WPAD_SetVRes(i, g_fb_width, g_fb_height);
 		WPAD_SetDataFormat(i, WPAD_FMT_BTNS_ACC_IR);
+		g_wpd[i] = &g_pad[i];
 
 		// Install callbacks
 		SYS_SetResetCallback(cb_WiiResetButtonPressed);
 		SYS_SetPowerCallback(cb_WiiPowerButtonPressed);
 		WPAD_SetPowerButtonCallback(cb_WiimotePowerButtonPressed);
 	}
+
+	// Reports are collected on their own thread from now on
+	inputStart();
 }
 
 /*****************************************************************************
- * Method for initialization                                                 *                                  *
+ * Mounting SD and USB storage blocks for a long time, so it runs on its own *
+ * thread. The game starts without it, assets follow once it is done.        *
  *****************************************************************************/
-void init() {
+void initStorage() {
+	g_storage = fatInitDefault();
+	if(g_storage)
+		assetsStart(g_assets, NUM_ASSETS);
+	else
+		g_assets[ASSET_MUSIC].state = g_assets[ASSET_SOUND].state = ASSET_FAILED;
+}
+
+/*****************************************************************************
+ * Initialization of the game state                                          *
+ *****************************************************************************/
+void initGame() {
+	SimParams params;
+
+	// Frame budget is one field period of the current TV mode
+	governorInit(VIDEO_GetCurrentTvMode() == VI_PAL ? 20000 : 16667);
 
-	/*************************************************************************
-	 * VIDEO, AUDIO, CONTROLS                                                *
-	 *************************************************************************/
-	initVideo();
-	initAudio();
-	initControls();
+	// All game objects come from one preallocated pool, and all scratch
+	// memory needed within a frame comes from the frame arena
+	simDefaults(&params);
+	if(simInit(&g_sim, &params, g_fb_width, g_fb_height, MAX_ENTITIES,
+			DEFAULT_PLAYERS, time(NULL)) < 0)
+		fatal("Out of memory for the entity pool");
+	if(arenaInit(&g_frame_arena, FRAME_ARENA_SIZE) < 0)
+		fatal("Out of memory for the frame arena");
+
+	// Sprites are pre-converted and used in place, see atlas.h
+	if(atlasGet(gfx_atlas, GFX_ATLAS_WIIMOTE, &g_remote_icon) < 0)
+		g_remote_icon.data = NULL;
 
-	/*************************************************************************
-	 * GAME RELATED STUFF                                                    *
-	 *************************************************************************/
 	// Setup particle system
-	initParticles();
-	initToken();
+	simSpawnBalls(&g_sim, NUM_PARTICLES);
+	initSnapshots();
+}
+
+/*****************************************************************************
+ * Startup steps, each with the steps it needs first:                        *
+ *                                                                           *
+ *		video config --> controls, game, video sync --> first frame          *
+ *		audio                                                                *
+ *		storage (thread) --> asset loader (thread)                           *
+ *                                                                           *
+ * Controls and game need the framebuffer size and the TV mode, the sync     *
+ * waits for the registers that video config flushed. The Wii has a single   *
+ * core, so steps only overlap while others block: storage on its own        *
+ * thread, below the game loop as it waits on the SD card most of the time,  *
+ * and the video sync last so that nothing queues behind its waits.          *
+ * tools/boottest runs this table against host stand-ins.                    *
+ *****************************************************************************/
+BootStep g_boot_steps[NUM_BOOT_STEPS] = {
+	[BOOT_STORAGE]  = { "storage",  initStorage,  0,                      60 },
+	[BOOT_VIDEO]    = { "video",    initVideo,    0 },
+	[BOOT_AUDIO]    = { "audio",    initAudio,    0 },
+	[BOOT_CONTROLS] = { "controls", initControls, BOOT_AFTER(BOOT_VIDEO) },
+	[BOOT_GAME]     = { "game",     initGame,     BOOT_AFTER(BOOT_VIDEO) },
+	[BOOT_SYNC]     = { "sync",     syncVideo,    BOOT_AFTER(BOOT_VIDEO) }
+};
+
+/*****************************************************************************
+ * Method for initialization                                                 *
+ *****************************************************************************/
+void init() {
+	if(bootRun(g_boot_steps, NUM_BOOT_STEPS) < 0)
+		fatal("Startup steps depend on each other in a circle");
 }
 
 /******************************************************************************
  * Main method
  *****************************************************************************/
 int main(int argc, char **argv) {
-	int ret[NUM_PLAYERS];
-	int i;
-	u32 type;
+	int ret[WPAD_MAX_WIIMOTES];
+	const CollideBounds *field = &g_sim.bounds;
+	int trail = 0, beam = 0;
+	int i, cx, cy;
 
 	// Initialization
+	g_boot = gettime();
 	init();
 
 	// Game loop
 	while(g_shutDownType==-1) {
+		governorBeginFrame();
+		arenaReset(&g_frame_arena);
+
 		// Setup console, required for printf
 		console_init(g_xfb[g_fbi], 0, 0,
 					 g_fb_width, g_fb_height,
 					 g_fb_width * VI_DISPLAY_PIX_SZ);
-		VIDEO_ClearFrameBuffer(g_vmode, g_xfb[g_fbi], COLOR_BLACK);
 		//printVideoInfo();
 
-		// Check status of the Wiimote
-		WPAD_ReadPending(WPAD_CHAN_ALL, cb_WiimoteEventFired);
-		for(i=0; i<NUM_PLAYERS; i++)
-		{
-			ret[i] = WPAD_Probe(i, &type);
-			switch(ret[i]) {
-				case WPAD_ERR_NO_CONTROLLER:
-					printf(" Wiimote %d not connected\n", i);
-					break;
-				case WPAD_ERR_NOT_READY:
-					printf(" Wiimote %d not ready\n", i);
-					break;
-				case WPAD_ERR_NONE:
-					printf(" Wiimote %d ready\n", i);
-					break;
-				default:
-					printf(" Unknown status of Wiimote %d: %d\n", i, ret[i]);
-			}
+		for(i=0; i<WPAD_MAX_WIIMOTES; i++)
+			ret[i] = inputStatus(i);
+
+		// Connection changes are reported right away, not at the HUD rate
+		if(inputStatusChanged())
+			g_hud_stale = 1;
+
+		// Work that needs no new report comes before taking them, so the
+		// ones arriving meanwhile still make it into this frame. In trail
+		// mode the back buffer holds the last frame faded instead of being
+		// cleared, which costs CPU time, so it is done here where the
+		// governor sees it and before any drawing.
+		updateAssets();
+		if(!beam) {
+			if(trail)
+				clearDecay(g_xfb[g_fbi], g_xfb[g_fbi^1], TRAIL_DECAY);
+			updateHud(ret);
+		}
 
-			// If no error occured, process retrieved controller input
-			if(ret[i] == WPAD_ERR_NONE)
-			{
-				g_wpd[i] = WPAD_Data(i);
-				//printWiimoteinfo(i);
-				displayIR(i);
-			}
+		// Take the newest Wiimote reports right before the simulation,
+		// the input thread has queued them as they arrived. Every channel,
+		// so that remotes without a token can still add a player.
+		for(i=0; i<WPAD_MAX_WIIMOTES; i++)
+			if(inputTake(i, &g_pad[i]) > 0)
+				cb_WiimoteEventFired(i, &g_pad[i]);
+
+		// Update game engine, drawing is only queued at this point.
+		// Holding B on the first Wiimote plays the game state backwards.
+		if(ret[0] == WPAD_ERR_NONE && (g_wpd[0]->btns_h & WPAD_BUTTON_B))
+			snapshotRewind(REWIND_SPEED);
+		else {
+			updateToken(ret);
+			if(g_simulate)
+				updateParticles();
+			snapshotCapture();
 		}
 
-		// Display background
-//		drawBox(g_border_l + (g_vi_width>>1)-10, g_border_t + (g_vi_height>>1)-10,
-//				g_border_l + (g_vi_width>>1)+10, g_border_t + (g_vi_height>>1)+10,
-//				COLOR_WHITE);
-		drawEllipse(g_border_l + (g_vi_width>>1), g_border_t + (g_vi_height>>1),
-					10, 10, COLOR_WHITE);
-		drawBox(g_border_l, g_border_t, g_border_r, g_border_b, COLOR_WHITE);
-		drawVLine(g_border_l + (g_vi_width>>1), g_border_t, g_border_b, COLOR_WHITE);
+		drawParticles();
+		drawTokens();
+
+		// In beam racing mode the frame is drawn into the buffer on screen,
+		// each band right before the beam gets to it. The HUD and the IR
+		// overlay write straight into the framebuffer and are left out.
+		// Input is still taken before the race, not band by band: the tokens
+		// are binned with everything else first, so a report taken right
+		// before their band could no longer move them.
+		if(beam) {
+			queueBackground();
+			tilesBin();
+			beamRace(&g_beam_race, drawBand, NULL);
+			tilesBegin();
+		}
+		else {
+			// Everything below writes into the framebuffer, which the GPU may
+			// still be clearing
+			if(!trail)
+				clearWait();
+
+			printf("%s", g_hud);
+			printf("%s", arenaPrintf(&g_frame_arena, " Arena %u/%u bytes, peak %u\n",
+					(unsigned)g_frame_arena.last, (unsigned)g_frame_arena.size,
+					(unsigned)g_frame_arena.peak));
+
+			for(i=0; i<g_sim.num_players; i++)
+			{
+				// IR overlay is the first thing to go under load
+				if(ret[i] == WPAD_ERR_NONE && governorSettings()->effect_detail > 0)
+				{
+					//printWiimoteinfo(i);
+					displayIR(i);
+				}
+				if(ret[i] == WPAD_ERR_NONE && g_remote_icon.data)
+					blitSprite(g_xfb[g_fbi], g_fb_width, g_fb_height, &g_remote_icon,
+							   field->l + i*(g_remote_icon.width+8), field->b + 4);
+			}
 
-		//drawLine(100, 100, 200, 300, COLOR_WHITE);
+			// Display background
+			cx = (field->l + field->r) >> 1;
+			cy = (field->t + field->b) >> 1;
+//			drawBox(cx-10, cy-10, cx+10, cy+10, COLOR_WHITE);
+			drawEllipse(cx, cy, 10, 10, COLOR_WHITE);
+			drawBox(field->l, field->t, field->r, field->b, COLOR_WHITE);
+			drawVLine(cx, field->t, field->b, COLOR_WHITE);
 
-		// Update game engine and render changes
-		if(g_simulate)
-			updateParticles();
+			//drawLine(100, 100, 200, 300, COLOR_WHITE);
 
-		updateToken();
+			// Rasterize all queued particles and tokens tile by tile
+			tilesFlush(g_xfb[g_fbi]);
+		}
 
-		// Wait for the next frame and switch framebuffer
+		// Wait for the next frame and switch framebuffer, beam racing keeps
+		// the one on screen
 		VIDEO_SetNextFramebuffer(g_xfb[g_fbi]);
 		VIDEO_Flush();
+		captureFrame(g_xfb[g_fbi]);
+		governorEndFrame();
 		VIDEO_WaitVSync();
+		g_beam_retrace = VIDEO_GetRetraceCount();
+		if(g_frame == 0)
+			g_first_frame_us = diff_usec(g_boot, gettime());
+		g_frame++;
+		beam = g_beam;
+
+		// Trails fade the whole last frame on the CPU, several times what a
+		// clear costs, so they only run while the governor has room for
+		// what the last fade took
+		trail = governorOptional(!beam && g_trail && governorSettings()->effect_detail > 1,
+								 clearDecayUs());
+		if(beam)
+			continue;
 		g_fbi^=1;
+
+		// The new back buffer just left scanout, start clearing it unless
+		// it gets the last frame faded instead
+		if(!trail)
+			clearStart(g_xfb[g_fbi]);
 	}
+	inputStop();
+	captureStop();
+	StopOgg();
+	bootJoin(g_boot_steps, NUM_BOOT_STEPS);
+	assetsFree();
 
 	// Perform invoked shutdown of the application
 	SYS_ResetSystem(g_shutDownType, 0, 0);
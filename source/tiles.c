@@ -0,0 +1,276 @@
+#include <stddef.h>
+
+#include "tiles.h"
+#include "spans.h"
+
+/*****************************************************************************
+ * The playfield is divided into TILE_WIDTH x TILE_HEIGHT pixel tiles. Since *
+ * TILE_WIDTH is even, tile borders always fall between two u32 words of the *
+ * external framebuffer, so no word is ever written by two tiles.            *
+ *                                                                           *
+ * Binning is a counting sort: count references per tile, turn the counts    *
+ * into start offsets and scatter the rectangle indices. Each tile then only *
+ * touches its own primitives, clipped to its own area.                      *
+ *****************************************************************************/
+
+typedef struct {
+	s16 x1, y1, x2, y2;		// inclusive corners, already clipped to the fb
+	s16 xm, ym;				// center of an ellipse
+	const u8 *spans;		// half width of an ellipse per row, NULL for rects
+	u32 color;
+} TileRect;
+
+static TileRect tile_rects[TILE_MAX_RECTS];
+static u16 tile_refs[TILE_MAX_REFS];
+static int tile_start[TILE_MAX_TILES+1];
+static int tile_fill[TILE_MAX_TILES];
+
+static int num_rects = 0;
+static int num_refs = 0;			// tile references the queued rects need
+static u32 num_dropped = 0;
+static int fb_w = 0, fb_h = 0;		// framebuffer dimensions in pixels
+static int fb_stride = 0;			// u32 words per row
+static int tile_cols = 0, tile_rows = 0;
+static volatile int next_tile = 0;	// work counter shared by all workers
+static void (*rasterize_tile)(u32 *fb, int t);	// picked by tilesInit()
+
+/*****************************************************************************
+ * TILE_RASTERIZER(NAME, STRIDE) defines a tile rasterizer whose row stride  *
+ * in u32 words is the expression STRIDE, like the kernels of raster.c. The  *
+ * constant strides of the libogc fbWidth values turn every row step into    *
+ * an add of a known offset; tilesInit() picks the set once.                 *
+ *****************************************************************************/
+#define TILE_RASTERIZER(NAME, STRIDE)                                          \
+static void rasterizeTile_##NAME(u32 *fb, int t)                               \
+{                                                                              \
+	int i, x, y, dy;                                                           \
+	int wx1, wx2, y1, y2, sx1, sx2;                                            \
+	int tile_wx1 = (t % tile_cols) * (TILE_WIDTH>>1);                          \
+	int tile_wx2 = tile_wx1 + (TILE_WIDTH>>1) - 1;                             \
+	int tile_y1 = (t / tile_cols) * TILE_HEIGHT;                               \
+	int tile_y2 = tile_y1 + TILE_HEIGHT - 1;                                   \
+	const TileRect *r;                                                         \
+	u32 *row;                                                                  \
+                                                                               \
+	for(i=tile_start[t]; i<tile_start[t+1]; i++) {                             \
+		r = &tile_rects[tile_refs[i]];                                         \
+                                                                               \
+		/* Clip to the tile in framebuffer word coordinates */                 \
+		wx1 = r->x1 >> 1;                                                      \
+		wx2 = r->x2 >> 1;                                                      \
+		y1 = r->y1;                                                            \
+		y2 = r->y2;                                                            \
+		if(wx1 < tile_wx1) wx1 = tile_wx1;                                     \
+		if(wx2 > tile_wx2) wx2 = tile_wx2;                                     \
+		if(y1 < tile_y1) y1 = tile_y1;                                         \
+		if(y2 > tile_y2) y2 = tile_y2;                                         \
+                                                                               \
+		row = fb + y1*(STRIDE);                                                \
+		if(r->spans && wx1 == r->x1 >> 1 && wx2 == r->x2 >> 1 &&               \
+		   y1 == r->y1 && y2 == r->y2 &&                                       \
+		   r->x1 == r->xm - r->spans[0] && r->x2 == r->xm + r->spans[0]) {     \
+			/* The whole ellipse is in the tile: down the span table to */     \
+			/* the middle row and back up, no clamps needed             */     \
+			for(dy=r->ym-y1; dy>0; dy--) {                                     \
+				sx1 = (r->xm - r->spans[dy]) >> 1;                             \
+				sx2 = (r->xm + r->spans[dy]) >> 1;                             \
+				for(x=sx1; x<=sx2; x++)                                        \
+					row[x] = r->color;                                         \
+				row += (STRIDE);                                               \
+			}                                                                  \
+			for(dy=0; dy<=y2-r->ym; dy++) {                                    \
+				sx1 = (r->xm - r->spans[dy]) >> 1;                             \
+				sx2 = (r->xm + r->spans[dy]) >> 1;                             \
+				for(x=sx1; x<=sx2; x++)                                        \
+					row[x] = r->color;                                         \
+				row += (STRIDE);                                               \
+			}                                                                  \
+			continue;                                                          \
+		}                                                                      \
+		if(r->spans) {                                                         \
+			/* One span per row, clipped to the tile like the rectangle */     \
+			for(y=y1; y<=y2; y++) {                                            \
+				dy = y < r->ym ? r->ym - y : y - r->ym;                        \
+				sx1 = (r->xm - r->spans[dy]) >> 1;                             \
+				sx2 = (r->xm + r->spans[dy]) >> 1;                             \
+				if(sx1 < wx1) sx1 = wx1;                                       \
+				if(sx2 > wx2) sx2 = wx2;                                       \
+				for(x=sx1; x<=sx2; x++)                                        \
+					row[x] = r->color;                                         \
+				row += (STRIDE);                                               \
+			}                                                                  \
+			continue;                                                          \
+		}                                                                      \
+		for(y=y1; y<=y2; y++) {                                                \
+			for(x=wx1; x<=wx2; x++)                                            \
+				row[x] = r->color;                                             \
+			row += (STRIDE);                                                   \
+		}                                                                      \
+	}                                                                          \
+}                                                                              \
+
+TILE_RASTERIZER(640, 320)
+TILE_RASTERIZER(704, 352)
+TILE_RASTERIZER(720, 360)
+TILE_RASTERIZER(generic, fb_stride)
+
+int tilesInit(int fb_width, int fb_height)
+{
+	num_dropped = 0;
+	tilesBegin();
+
+	// Clipping against an empty framebuffer drops everything
+	fb_w = fb_h = fb_stride = tile_cols = tile_rows = 0;
+	if(fb_width <= 0 || fb_height <= 0 ||
+	   fb_width > TILE_MAX_COLS*TILE_WIDTH || fb_height > TILE_MAX_ROWS*TILE_HEIGHT)
+		return -1;
+
+	fb_w = fb_width;
+	fb_h = fb_height;
+	fb_stride = fb_width >> 1;
+	tile_cols = (fb_width + TILE_WIDTH - 1) / TILE_WIDTH;
+	tile_rows = (fb_height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+
+	switch(fb_width) {
+		case 640: rasterize_tile = rasterizeTile_640; break;
+		case 704: rasterize_tile = rasterizeTile_704; break;
+		case 720: rasterize_tile = rasterizeTile_720; break;
+		default:  rasterize_tile = rasterizeTile_generic; break;
+	}
+	return 0;
+}
+
+void tilesBegin()
+{
+	num_rects = 0;
+	num_refs = 0;
+	next_tile = 0;
+}
+
+u32 tilesDropped()
+{
+	return num_dropped;
+}
+
+int tilesAddRect(int x1, int y1, int x2, int y2, u32 color)
+{
+	TileRect *r;
+	int refs;
+
+	if(x1 < 0) x1 = 0;
+	if(y1 < 0) y1 = 0;
+	if(x2 >= fb_w) x2 = fb_w - 1;
+	if(y2 >= fb_h) y2 = fb_h - 1;
+	if(x1 > x2 || y1 > y2)
+		return 0; // completely off screen
+
+	// Reserve the references tilesBin() will need, so it never runs out
+	refs = (x2/TILE_WIDTH - x1/TILE_WIDTH + 1) * (y2/TILE_HEIGHT - y1/TILE_HEIGHT + 1);
+	if(num_rects >= TILE_MAX_RECTS || num_refs + refs > TILE_MAX_REFS) {
+		num_dropped++;
+		return -1;
+	}
+	num_refs += refs;
+
+	r = &tile_rects[num_rects++];
+	r->x1 = x1;
+	r->y1 = y1;
+	r->x2 = x2;
+	r->y2 = y2;
+	r->spans = NULL;
+	r->color = color;
+	return 0;
+}
+
+int tilesAddEllipse(int xm, int ym, int a, int b, u32 color)
+{
+	int n = num_rects;
+
+	// Queued like its bounding box, which is what gets binned and clipped
+	if(tilesAddRect(xm - a, ym - b, xm + a, ym + b, color) < 0)
+		return -1;
+	if(num_rects > n) {
+		tile_rects[n].xm = xm;
+		tile_rects[n].ym = ym;
+		tile_rects[n].spans = spansGet(a, b);
+	}
+	return 0;
+}
+
+void tilesBin()
+{
+	int i, tx, ty, t, sum;
+	int tx1, tx2, ty1, ty2;
+	int num_tiles = tile_cols*tile_rows;
+
+	for(t=0; t<num_tiles; t++)
+		tile_fill[t] = 0;
+
+	// Pass 1: count references per tile. Their total is num_refs, which
+	// tilesAddRect() kept within TILE_MAX_REFS.
+	for(i=0; i<num_rects; i++) {
+		tx1 = tile_rects[i].x1 / TILE_WIDTH;
+		tx2 = tile_rects[i].x2 / TILE_WIDTH;
+		ty1 = tile_rects[i].y1 / TILE_HEIGHT;
+		ty2 = tile_rects[i].y2 / TILE_HEIGHT;
+		for(ty=ty1; ty<=ty2; ty++)
+			for(tx=tx1; tx<=tx2; tx++)
+				tile_fill[ty*tile_cols+tx]++;
+	}
+
+	// Pass 2: prefix sum yields the first slot of every tile
+	sum = 0;
+	for(t=0; t<num_tiles; t++) {
+		tile_start[t] = sum;
+		sum += tile_fill[t];
+		tile_fill[t] = tile_start[t];
+	}
+	tile_start[num_tiles] = sum;
+
+	// Pass 3: scatter, preserving submission order within each tile
+	for(i=0; i<num_rects; i++) {
+		tx1 = tile_rects[i].x1 / TILE_WIDTH;
+		tx2 = tile_rects[i].x2 / TILE_WIDTH;
+		ty1 = tile_rects[i].y1 / TILE_HEIGHT;
+		ty2 = tile_rects[i].y2 / TILE_HEIGHT;
+		for(ty=ty1; ty<=ty2; ty++)
+			for(tx=tx1; tx<=tx2; tx++)
+				tile_refs[tile_fill[ty*tile_cols+tx]++] = i;
+	}
+
+	next_tile = 0;
+}
+
+int tilesWork(u32 *fb)
+{
+	int t, done = 0;
+	int num_tiles = tile_cols*tile_rows;
+
+	for(;;) {
+		t = __sync_fetch_and_add(&next_tile, 1);
+		if(t >= num_tiles)
+			break;
+		if(tile_start[t] != tile_start[t+1])
+			rasterize_tile(fb, t);
+		done++;
+	}
+	return done;
+}
+
+void tilesWorkRow(u32 *fb, int row)
+{
+	int t;
+
+	if(row < 0 || row >= tile_rows)
+		return;
+	for(t=row*tile_cols; t<(row+1)*tile_cols; t++)
+		if(tile_start[t] != tile_start[t+1])
+			rasterize_tile(fb, t);
+}
+
+void tilesFlush(u32 *fb)
+{
+	tilesBin();
+	tilesWork(fb);
+	tilesBegin();
+}
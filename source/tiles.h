@@ -0,0 +1,104 @@
+#ifndef __TILES_H__
+#define __TILES_H__
+
+#include <gctypes.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define TILE_WIDTH      64     // tile width in pixels, must be even
+#define TILE_HEIGHT     32     // tile height in pixels
+#define TILE_MAX_COLS   12     // fbWidth up to 768
+#define TILE_MAX_ROWS   18     // xfbHeight up to 576
+#define TILE_MAX_TILES  (TILE_MAX_COLS*TILE_MAX_ROWS)
+#define TILE_MAX_RECTS  4096   // primitives per frame
+#define TILE_MAX_REFS   (TILE_MAX_RECTS*4)
+
+/****************************************************************************
+ * tilesInit
+ *
+ * Sets up the tile grid for a framebuffer of the given dimensions
+ * (in pixels). Must be called again whenever the video mode changes.
+ * returns: -1 if the framebuffer is larger than TILE_MAX_COLS x
+ *          TILE_MAX_ROWS tiles, nothing is drawn then; 0 on success
+ ***************************************************************************/
+int tilesInit(int fb_width, int fb_height);
+
+/****************************************************************************
+ * tilesBegin
+ *
+ * Discards all primitives queued for the previous frame
+ ***************************************************************************/
+void tilesBegin();
+
+/****************************************************************************
+ * tilesAddRect
+ *
+ * Queues a filled rectangle with inclusive corners (x1,y1) and (x2,y2).
+ * The rectangle is clipped against the framebuffer right away.
+ * returns: -1 if the primitive or the tile reference buffer is full and
+ *          the rectangle was dropped, 0 on success
+ ***************************************************************************/
+int tilesAddRect(int x1, int y1, int x2, int y2, u32 color);
+
+/****************************************************************************
+ * tilesAddEllipse
+ *
+ * Queues a filled ellipse around (xm,ym) with the radii a and b. Each row
+ * is filled as one span taken from the cached tables of spans.h. Radii
+ * beyond SPAN_MAX_RADIUS are queued as their bounding rectangle.
+ * returns: -1 if the ellipse was dropped like in tilesAddRect(), 0 on
+ *          success
+ ***************************************************************************/
+int tilesAddEllipse(int xm, int ym, int a, int b, u32 color);
+
+/****************************************************************************
+ * tilesDropped
+ *
+ * returns: number of primitives dropped because the buffers were full,
+ *          counted since tilesInit(). Callers that cannot flush in between
+ *          show it instead of losing primitives silently.
+ ***************************************************************************/
+u32 tilesDropped();
+
+/****************************************************************************
+ * tilesBin
+ *
+ * Sorts the queued primitives into per-tile lists. Has to run once before
+ * tilesWork() is called on any thread.
+ ***************************************************************************/
+void tilesBin();
+
+/****************************************************************************
+ * tilesWork
+ *
+ * Claims tiles one at a time and rasterizes them into fb until none are
+ * left. Tiles never overlap, so any number of threads may call this
+ * concurrently on the same framebuffer without further locking.
+ * returns: number of tiles rasterized by the caller
+ ***************************************************************************/
+int tilesWork(u32 *fb);
+
+/****************************************************************************
+ * tilesWorkRow
+ *
+ * Rasterizes the tiles of one row into fb, covering the framebuffer lines
+ * row*TILE_HEIGHT and up. Lets a caller draw the frame in horizontal bands
+ * after tilesBin(), independent of the tilesWork() counter.
+ ***************************************************************************/
+void tilesWorkRow(u32 *fb, int row);
+
+/****************************************************************************
+ * tilesFlush
+ *
+ * Bins and rasterizes all queued primitives on the calling thread
+ ***************************************************************************/
+void tilesFlush(u32 *fb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * adpcmenc - compresses sound effects to 4 bit ADPCM (see source/adpcm.h)   *
+ *                                                                           *
+ * usage: adpcmenc [-r <rate>] <in.pcm> <out.adpcm>                          *
+ *                                                                           *
+ * Accepts 16 bit PCM WAV files, stereo ones are mixed down to mono. Any     *
+ * other input is taken as raw 16 bit big endian mono samples, the format    *
+ * ASND plays, at the rate given with -r (48000 by default).                 *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adpcm.h"
+
+static void die(const char *msg, const char *arg)
+{
+	fprintf(stderr, "adpcmenc: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+	exit(1);
+}
+
+static u32 le32(const u8 *p) { return p[0] | (p[1]<<8) | (p[2]<<16) | (p[3]<<24); }
+static u16 le16(const u8 *p) { return p[0] | (p[1]<<8); }
+static void put16(u8 *p, u32 v) { p[0] = v >> 8; p[1] = v; }
+static void put32(u8 *p, u32 v) { p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v; }
+
+static u8 * readFile(const char *path, long *len)
+{
+	FILE *f = fopen(path, "rb");
+	u8 *buf;
+
+	if(f == NULL)
+		die("cannot open", path);
+	fseek(f, 0, SEEK_END);
+	*len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = malloc(*len + 1);
+	if(buf == NULL || fread(buf, 1, *len, f) != (size_t)*len)
+		die("cannot read", path);
+	fclose(f);
+	return buf;
+}
+
+/*****************************************************************************
+ * Turns a WAV file into mono samples, returns the sample count              *
+ *****************************************************************************/
+static int parseWav(const u8 *buf, long len, s16 **out, u32 *rate)
+{
+	const u8 *p = buf + 12, *fmt = NULL, *data = NULL;
+	u32 size, data_size = 0;
+	int i, n, channels;
+
+	while(p + 8 <= buf + len) {
+		size = le32(p + 4);
+		if(memcmp(p, "fmt ", 4) == 0)
+			fmt = p + 8;
+		else if(memcmp(p, "data", 4) == 0) {
+			data = p + 8;
+			data_size = size;
+		}
+		p += 8 + size + (size & 1);
+	}
+	if(fmt == NULL || data == NULL)
+		die("incomplete WAV file", NULL);
+	if(data + data_size > buf + len)
+		data_size = buf + len - data;
+
+	channels = le16(fmt + 2);
+	if(le16(fmt) != 1 || le16(fmt + 14) != 16 || channels < 1 || channels > 2)
+		die("only 16 bit PCM WAV files with one or two channels are supported", NULL);
+	*rate = le32(fmt + 4);
+
+	n = data_size / (2 * channels);
+	*out = malloc((n + ADPCM_BLOCK_SAMPLES) * sizeof(s16));
+	for(i=0; i<n; i++) {
+		if(channels == 2)
+			(*out)[i] = ((s16)le16(data + 4*i) + (s16)le16(data + 4*i + 2)) >> 1;
+		else
+			(*out)[i] = (s16)le16(data + 2*i);
+	}
+	return n;
+}
+
+int main(int argc, char **argv)
+{
+	const char *in_path = NULL, *out_path = NULL;
+	u32 rate = 48000;
+	long len;
+	int i, n, blocks;
+	u8 *buf, *out, *o;
+	s16 *pcm;
+	AdpcmState state;
+	FILE *f;
+
+	for(i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-r") == 0 && i+1 < argc)
+			rate = atoi(argv[++i]);
+		else if(in_path == NULL)
+			in_path = argv[i];
+		else
+			out_path = argv[i];
+	}
+	if(in_path == NULL || out_path == NULL)
+		die("usage: adpcmenc [-r <rate>] <in.pcm> <out.adpcm>", NULL);
+
+	buf = readFile(in_path, &len);
+	if(len >= 12 && memcmp(buf, "RIFF", 4) == 0 && memcmp(buf + 8, "WAVE", 4) == 0)
+		n = parseWav(buf, len, &pcm, &rate);
+	else {
+		n = len / 2;
+		pcm = malloc((n + ADPCM_BLOCK_SAMPLES) * sizeof(s16));
+		for(i=0; i<n; i++)
+			pcm[i] = (s16)((buf[2*i] << 8) | buf[2*i + 1]);
+	}
+	if(n <= 0)
+		die("no samples in", in_path);
+
+	// Pad the last block with silence
+	blocks = (n + ADPCM_BLOCK_SAMPLES - 1) / ADPCM_BLOCK_SAMPLES;
+	for(i=n; i<blocks*ADPCM_BLOCK_SAMPLES; i++)
+		pcm[i] = 0;
+
+	out = calloc(1, ADPCM_HEADER_BYTES + blocks * ADPCM_BLOCK_BYTES);
+	put32(out, ADPCM_MAGIC);
+	put32(out + 4, n);
+	put32(out + 8, rate);
+	put16(out + 12, ADPCM_BLOCK_SAMPLES);
+
+	state.predictor = pcm[0];
+	state.index = 0;
+	o = out + ADPCM_HEADER_BYTES;
+	for(i=0; i<blocks; i++, o+=ADPCM_BLOCK_BYTES)
+		adpcmEncodeBlock(pcm + i*ADPCM_BLOCK_SAMPLES, &state, o);
+
+	f = fopen(out_path, "wb");
+	if(f == NULL || fwrite(out, 1, o - out, f) != (size_t)(o - out))
+		die("cannot write", out_path);
+	fclose(f);
+
+	printf("%s: %d samples at %u Hz, %d -> %d bytes\n", in_path, n,
+		   (unsigned)rate, n * 2, (int)(o - out));
+
+	free(out);
+	free(pcm);
+	free(buf);
+	return 0;
+}
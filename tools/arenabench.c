@@ -0,0 +1,135 @@
+/*****************************************************************************
+ * arenabench - frame arena against malloc() (source/arena.h)                *
+ *                                                                           *
+ * usage: arenabench [-f frames]                                             *
+ *                                                                           *
+ * Replays the allocations of a frame the way the game makes them (the hit   *
+ * buffer, the HUD text and a few hundred small event records of random      *
+ * size) once from the frame arena and once from malloc() with everything    *
+ * freed at the end of the frame, and reports the time per allocation. The   *
+ * HUD text is also formatted with arenaPrintf() against snprintf() into a   *
+ * malloc() block. Exits with 1 if an arena allocation is misaligned or      *
+ * overlaps another one from the same frame.                                 *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "arena.h"
+
+#define ALLOCS_PER_FRAME 512
+#define HUD_SIZE         512
+#define ARENA_SIZE       (256*1024)
+
+static u32 rng = 1;
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+typedef struct {
+	size_t size, align;
+} Request;
+
+static void makeFrame(Request *req)
+{
+	int i;
+
+	req[0].size = 4096;		// hit flags
+	req[0].align = 1;
+	req[1].size = HUD_SIZE;	// status text
+	req[1].align = 1;
+	for(i=2; i<ALLOCS_PER_FRAME; i++) {
+		req[i].size = 8 + rnd() % 256;
+		req[i].align = (rnd() & 7) ? 4 : 32;	// some DMA buffers
+	}
+}
+
+int main(int argc, char **argv)
+{
+	FrameArena arena;
+	Request req[ALLOCS_PER_FRAME];
+	void *ptr[ALLOCS_PER_FRAME];
+	u8 *p, *end;
+	double t_arena = 0, t_malloc = 0, t_aprintf = 0, t_printf = 0, t;
+	int f, i, bad = 0, num_frames = 2000;
+	char *s;
+
+	while((i = getopt(argc, argv, "f:")) != -1) {
+		switch(i) {
+			case 'f': num_frames = atoi(optarg); break;
+			default: fprintf(stderr, "arenabench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 1)
+		num_frames = 1;
+	if(arenaInit(&arena, ARENA_SIZE) < 0)
+		return 2;
+
+	for(f=0; f<num_frames; f++) {
+		makeFrame(req);
+
+		t = cpuSeconds();
+		arenaReset(&arena);
+		for(i=0; i<ALLOCS_PER_FRAME; i++)
+			ptr[i] = arenaAlloc(&arena, req[i].size, req[i].align);
+		t_arena += cpuSeconds() - t;
+
+		// Aligned, in order and without overlap
+		for(i=0, end=NULL; i<ALLOCS_PER_FRAME; i++) {
+			p = ptr[i];
+			if(p == NULL || ((size_t)p & (req[i].align-1)) || (end && p < end))
+				bad++;
+			end = p + req[i].size;
+			memset(p, i, req[i].size);
+		}
+
+		t = cpuSeconds();
+		for(i=0; i<ALLOCS_PER_FRAME; i++)
+			ptr[i] = (req[i].align > 16) ? memalign(req[i].align, req[i].size)
+										 : malloc(req[i].size);
+		for(i=0; i<ALLOCS_PER_FRAME; i++)
+			free(ptr[i]);
+		t_malloc += cpuSeconds() - t;
+
+		// The quality line of the HUD, formatted either way
+		t = cpuSeconds();
+		s = arenaPrintf(&arena, " Quality %d, %u/%u us, input age %u us\n",
+						f & 3, rnd() % 20000, 16667, rnd() % 5000);
+		t_aprintf += cpuSeconds() - t;
+		if(s[0] == '\0')
+			bad++;
+
+		t = cpuSeconds();
+		s = malloc(HUD_SIZE);
+		snprintf(s, HUD_SIZE, " Quality %d, %u/%u us, input age %u us\n",
+				 f & 3, rnd() % 20000, 16667, rnd() % 5000);
+		free(s);
+		t_printf += cpuSeconds() - t;
+	}
+
+	printf("%d frames of %d allocations, arena peak %u of %u bytes\n",
+		   num_frames, ALLOCS_PER_FRAME, (unsigned)arena.peak, (unsigned)arena.size);
+	printf("arena:         %7.1f ns per allocation\n",
+		   t_arena / num_frames / ALLOCS_PER_FRAME * 1e9);
+	printf("malloc/free:   %7.1f ns per allocation\n",
+		   t_malloc / num_frames / ALLOCS_PER_FRAME * 1e9);
+	printf("arenaPrintf:   %7.1f ns per HUD line\n", t_aprintf / num_frames * 1e9);
+	printf("malloc+format: %7.1f ns per HUD line\n", t_printf / num_frames * 1e9);
+	if(bad)
+		fprintf(stderr, "arenabench: %d bad arena allocations\n", bad);
+	arenaFree(&arena);
+	return bad ? 1 : 0;
+}
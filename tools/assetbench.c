@@ -0,0 +1,196 @@
+/*****************************************************************************
+ * assetbench - loading assets in the background (source/assets.h)           *
+ *                                                                           *
+ * usage: assetbench [-k KB/s] file...                                       *
+ *                                                                           *
+ * Copies the files into a temporary directory named "sd:", which is where   *
+ * fopen() looks for "sd:/name" on the host, and loads them with the asset   *
+ * loader thread while a 60 Hz loop polls them the way updateAssets() does.  *
+ * Every file has to arrive intact. Reports the time to the first chunk and  *
+ * to the complete file on the host, what the first frame and the music      *
+ * wait for when loading blocks startup and when it runs in the background   *
+ * at a storage speed of -k KB/s (1024 by default, an SD card through        *
+ * libfat), and the bytes EMBED_ASSETS=0 keeps out of the DOL. Exits with 1  *
+ * if an asset fails or differs from its file.                               *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+#include "assets.h"
+
+#define MAX_FILES         8
+#define FRAME_US          16667
+#define MUSIC_START_BYTES (64*1024)	// of template.c, the first file is the music
+#define TIMEOUT_US        (30*1000000)
+
+static pthread_t threads[4];
+static int num_threads = 0;
+
+u64 gettime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+u32 diff_usec(u64 start, u64 end)
+{
+	return end - start;
+}
+
+s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg,
+                     void *stackbase, u32 stack_size, u8 prio)
+{
+	if(num_threads == 4 || pthread_create(&threads[num_threads], NULL, entry, arg) != 0)
+		return -1;
+	*thethread = num_threads++;
+	return 0;
+}
+
+s32 LWP_JoinThread(lwp_t thethread, void **value_ptr)
+{
+	return pthread_join(threads[thethread], value_ptr);
+}
+
+void DCFlushRange(void *startaddress, u32 len)
+{
+}
+
+static u8 *readFile(const char *path, long *size)
+{
+	FILE *f = fopen(path, "rb");
+	u8 *data = NULL;
+
+	if(f == NULL)
+		return NULL;
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	if(*size > 0 && (data = malloc(*size)) != NULL && fread(data, 1, *size, f) != (size_t)*size) {
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	return data;
+}
+
+static int writeFile(const char *path, const u8 *data, long size)
+{
+	FILE *f = fopen(path, "wb");
+	int ok;
+
+	if(f == NULL)
+		return 0;
+	ok = fwrite(data, 1, size, f) == (size_t)size;
+	return fclose(f) == 0 && ok;
+}
+
+int main(int argc, char **argv)
+{
+	Asset assets[MAX_FILES];
+	u8 *data[MAX_FILES];
+	long size[MAX_FILES], total = 0;
+	char dir[] = "/tmp/assetbenchXXXXXX", cwd[1024], path[1024];
+	const char *name;
+	u64 t, start;
+	u32 blocking_us, start_us, music_us = 0, ready_us = 0;
+	int c, i, num_files, done, bad = 0, rate = 1024;
+
+	while((c = getopt(argc, argv, "k:")) != -1) {
+		switch(c) {
+			case 'k': rate = atoi(optarg); break;
+			default: fprintf(stderr, "assetbench: bad arguments\n"); return 2;
+		}
+	}
+	num_files = argc - optind;
+	if(num_files < 1 || num_files > MAX_FILES || rate < 1) {
+		fprintf(stderr, "usage: assetbench [-k KB/s] file...\n");
+		return 2;
+	}
+
+	// What a blocking load before the first frame reads on the host
+	t = gettime();
+	for(i=0; i<num_files; i++) {
+		data[i] = readFile(argv[optind+i], &size[i]);
+		if(data[i] == NULL) {
+			fprintf(stderr, "assetbench: cannot read %s\n", argv[optind+i]);
+			return 2;
+		}
+		total += size[i];
+	}
+	blocking_us = diff_usec(t, gettime());
+
+	if(getcwd(cwd, sizeof(cwd)) == NULL || mkdtemp(dir) == NULL || chdir(dir) < 0 ||
+	   mkdir("sd:", 0755) < 0) {
+		fprintf(stderr, "assetbench: cannot create the storage directory\n");
+		return 2;
+	}
+	for(i=0; i<num_files; i++) {
+		name = strrchr(argv[optind+i], '/');
+		name = name ? name+1 : argv[optind+i];
+		snprintf(path, sizeof(path), "sd:/%s", name);
+		if(!writeFile(path, data[i], size[i])) {
+			fprintf(stderr, "assetbench: cannot write %s/%s\n", dir, path);
+			return 2;
+		}
+		memset(&assets[i], 0, sizeof(assets[i]));
+		assets[i].name = strdup(name);
+	}
+
+	// The game only waits for assetsStart(), then polls once per frame
+	start = gettime();
+	if(assetsStart(assets, num_files) < 0) {
+		fprintf(stderr, "assetbench: cannot start the loader\n");
+		return 2;
+	}
+	start_us = diff_usec(start, gettime());
+	do {
+		usleep(FRAME_US);
+		t = diff_usec(start, gettime());
+		if(music_us == 0 && (assets[0].state == ASSET_READY ||
+		   (assets[0].state == ASSET_LOADING && assets[0].loaded >= MUSIC_START_BYTES)))
+			music_us = t;
+		for(i=0, done=0; i<num_files; i++)
+			done += assets[i].state == ASSET_READY || assets[i].state == ASSET_FAILED;
+	} while(done < num_files && t < TIMEOUT_US);
+	ready_us = t;
+
+	for(i=0; i<num_files; i++) {
+		if(assets[i].state != ASSET_READY || assets[i].size != size[i] ||
+		   assets[i].loaded != size[i] || memcmp(assets[i].data, data[i], size[i]) != 0 ||
+		   assets[i].first_us > assets[i].load_us) {
+			fprintf(stderr, "assetbench: %s did not load intact\n", assets[i].name);
+			bad++;
+		}
+		printf("%-16s %9ld bytes, first chunk %7.2f ms, complete %7.2f ms\n", assets[i].name,
+			   size[i], assets[i].first_us / 1e3, assets[i].load_us / 1e3);
+	}
+	assetsFree();
+
+	printf("host: first frame waits %.3f ms for assetsStart() instead of %.3f ms of"
+		   " blocking reads; music after %.1f ms, all assets polled ready after %.1f ms\n",
+		   start_us / 1e3, blocking_us / 1e3, music_us / 1e3, ready_us / 1e3);
+	printf("at %d KB/s: first frame after %.0f ms blocking, background streams music after"
+		   " %.0f ms and is done after %.0f ms\n", rate, total / 1.024 / rate,
+		   (size[0] < MUSIC_START_BYTES ? size[0] : MUSIC_START_BYTES) / 1.024 / rate,
+		   total / 1.024 / rate);
+	printf("DOL: the embedded copies add %ld bytes, EMBED_ASSETS=0 leaves them out\n", total);
+
+	for(i=0; i<num_files; i++) {
+		snprintf(path, sizeof(path), "sd:/%s", assets[i].name);
+		unlink(path);
+		free((char *)assets[i].name);
+		free(data[i]);
+	}
+	rmdir("sd:");
+	if(chdir(cwd) == 0)
+		rmdir(dir);
+	return bad ? 1 : 0;
+}
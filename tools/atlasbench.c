@@ -0,0 +1,266 @@
+/*****************************************************************************
+ * atlasbench - startup cost of the sprite atlas (see source/atlas.h)        *
+ *                                                                           *
+ * usage: atlasbench <atlas> image...                                        *
+ *                                                                           *
+ * Compares two ways of getting sprites ready at startup, with the files     *
+ * already in memory as if they were linked into the DOL:                    *
+ *   - decode: parse each PPM/PAM image, expand it to RGBA and convert it    *
+ *     into a freshly allocated YUY2 sprite, as a game without the atlas     *
+ *     would have to                                                         *
+ *   - atlas: atlasGet() for every image of the blob atlaspack made from     *
+ *     the same images                                                       *
+ * Reports the time per startup and the memory each one keeps. Exits with 1  *
+ * if the two disagree on any pixel pair. A 640x480 PAM image is decoded as  *
+ * well to show how the decode cost grows with the image size.               *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "atlas.h"
+
+#define REPEAT 20000
+
+static const u32 * volatile sink;	// keeps the timed loops from being dropped
+
+typedef struct {
+	u8 *data;
+	long size;
+} File;
+
+static void die(const char *msg, const char *arg)
+{
+	fprintf(stderr, "atlasbench: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+	exit(2);
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void readFile(const char *path, File *file)
+{
+	FILE *f = fopen(path, "rb");
+
+	if(f == NULL)
+		die("cannot open", path);
+	fseek(f, 0, SEEK_END);
+	file->size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	file->data = malloc(file->size);
+	if(file->data == NULL || fread(file->data, 1, file->size, f) != (size_t)file->size)
+		die("cannot read", path);
+	fclose(f);
+}
+
+/*****************************************************************************
+ * Runtime decoding, binary PPM (P6) and PAM (P7) only                       *
+ *****************************************************************************/
+static const u8 *token(const u8 *p, const u8 *end, char *buf, int len)
+{
+	int n = 0;
+
+	while(p < end && (isspace(*p) || *p == '#')) {
+		if(*p == '#')
+			while(p < end && *p != '\n') p++;
+		else
+			p++;
+	}
+	while(p < end && !isspace(*p) && n < len-1)
+		buf[n++] = *p++;
+	buf[n] = 0;
+	return p;
+}
+
+static int decodeImage(const File *file, Sprite *spr, u32 *heap)
+{
+	const u8 *p = file->data, *end = file->data + file->size;
+	char tok[32];
+	int i, n, w = -1, h = -1, depth = 3, keyed = 0;
+	u8 *rgba, *q;
+	u32 *pairs;
+
+	p = token(p, end, tok, sizeof(tok));
+	if(strcmp(tok, "P7") == 0) {
+		for(;;) {
+			p = token(p, end, tok, sizeof(tok));
+			if(!tok[0] || strcmp(tok, "ENDHDR") == 0)
+				break;
+			if(strcmp(tok, "WIDTH") == 0) { p = token(p, end, tok, sizeof(tok)); w = atoi(tok); }
+			else if(strcmp(tok, "HEIGHT") == 0) { p = token(p, end, tok, sizeof(tok)); h = atoi(tok); }
+			else if(strcmp(tok, "DEPTH") == 0) { p = token(p, end, tok, sizeof(tok)); depth = atoi(tok); }
+			else p = token(p, end, tok, sizeof(tok));
+		}
+	}
+	else if(strcmp(tok, "P6") == 0) {
+		p = token(p, end, tok, sizeof(tok)); w = atoi(tok);
+		p = token(p, end, tok, sizeof(tok)); h = atoi(tok);
+		p = token(p, end, tok, sizeof(tok));
+	}
+	p++;	// the single whitespace before the samples
+	n = w * h;
+	if(w <= 0 || h <= 0 || (depth != 3 && depth != 4) || p + n*depth > end)
+		return -1;
+
+	rgba = malloc(n * 4);
+	pairs = malloc(((w+1) >> 1) * h * sizeof(u32));
+	if(rgba == NULL || pairs == NULL)
+		die("out of memory", NULL);
+	for(i=0, q=rgba; i<n; i++, q+=4, p+=depth) {
+		q[0] = p[0];
+		q[1] = p[1];
+		q[2] = p[2];
+		q[3] = (depth == 4) ? p[3] : (p[0] == 255 && p[1] == 0 && p[2] == 255) ? 0 : 255;
+		keyed |= q[3] < COLOR_ALPHA_CUTOFF;
+	}
+	colorConvertRGBA(rgba, w, h, w*4, pairs, (w+1) >> 1, ATLAS_KEY);
+	free(rgba);
+
+	spr->width = w;
+	spr->height = h;
+	spr->pitch = (w+1) >> 1;
+	spr->flags = keyed ? SPRITE_KEYED : 0;
+	spr->key = ATLAS_KEY;
+	spr->data = pairs;
+	heap[0] += spr->pitch * h * sizeof(u32);	// kept
+	heap[1] += n * 4;							// scratch
+	return 0;
+}
+
+/*****************************************************************************
+ * The blob is big endian. On a little endian host its numbers are swapped   *
+ * once up front, which the Wii never has to do.                             *
+ *****************************************************************************/
+static u32 swap32(u32 v) { return (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24); }
+static u16 swap16(u16 v) { return (v >> 8) | (v << 8); }
+
+static void toHostOrder(u8 *blob)
+{
+	AtlasHeader *hdr = (AtlasHeader *)blob;
+	AtlasEntry *e = (AtlasEntry *)(hdr + 1);
+	u32 *pairs;
+	int i, j;
+
+	if(hdr->magic == ATLAS_MAGIC)
+		return;
+	hdr->magic = swap32(hdr->magic);
+	hdr->version = swap16(hdr->version);
+	hdr->count = swap16(hdr->count);
+	hdr->size = swap32(hdr->size);
+	for(i=0; i<hdr->count; i++) {
+		e[i].width = swap16(e[i].width);
+		e[i].height = swap16(e[i].height);
+		e[i].pitch = swap16(e[i].pitch);
+		e[i].flags = swap16(e[i].flags);
+		e[i].key = swap32(e[i].key);
+		e[i].offset = swap32(e[i].offset);
+		pairs = (u32 *)(blob + e[i].offset);
+		for(j=0; j<e[i].pitch*e[i].height; j++)
+			pairs[j] = swap32(pairs[j]);
+	}
+}
+
+static int samePixels(const Sprite *a, const Sprite *b)
+{
+	int y;
+
+	if(a->width != b->width || a->height != b->height || a->flags != b->flags)
+		return 0;
+	for(y=0; y<a->height; y++)
+		if(memcmp(a->data + y*a->pitch, b->data + y*b->pitch, ((a->width+1) >> 1) * sizeof(u32)))
+			return 0;
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	File atlas, *images, big;
+	Sprite *decoded, spr;
+	u32 heap[2], files = 0;
+	double t_decode, t_atlas, t_big;
+	int i, r, n, bad = 0;
+	char hdr[80];
+
+	if(argc < 3)
+		die("usage: atlasbench <atlas> image...", NULL);
+	n = argc - 2;
+	readFile(argv[1], &atlas);
+	toHostOrder(atlas.data);
+	if(atlasCount(atlas.data) != n)
+		die("atlas does not hold the given images", argv[1]);
+
+	images = malloc(n * sizeof(File));
+	decoded = malloc(n * sizeof(Sprite));
+	for(i=0; i<n; i++) {
+		readFile(argv[i+2], &images[i]);
+		files += images[i].size;
+	}
+
+	// Runtime decoding, freeing the sprites again between startups
+	t_decode = cpuSeconds();
+	for(r=0; r<REPEAT; r++) {
+		heap[0] = heap[1] = 0;
+		for(i=0; i<n; i++)
+			if(decodeImage(&images[i], &decoded[i], heap) < 0)
+				die("cannot decode", argv[i+2]);
+		if(r < REPEAT-1)
+			for(i=0; i<n; i++)
+				free((void *)decoded[i].data);
+	}
+	t_decode = (cpuSeconds() - t_decode) / REPEAT;
+
+	// The atlas only fills in the Sprite structs
+	t_atlas = cpuSeconds();
+	for(r=0; r<REPEAT; r++)
+		for(i=0; i<n; i++) {
+			atlasGet(atlas.data, i, &spr);
+			sink = spr.data;
+		}
+	t_atlas = (cpuSeconds() - t_atlas) / REPEAT;
+
+	for(i=0; i<n; i++) {
+		atlasGet(atlas.data, i, &spr);
+		if(!samePixels(&spr, &decoded[i])) {
+			fprintf(stderr, "atlasbench: %s differs from its atlas entry\n", argv[i+2]);
+			bad = 1;
+		}
+	}
+
+	printf("%d images, %u bytes as PPM/PAM files, %ld bytes as atlas\n", n, files, atlas.size);
+	printf("decode: %9.2f us per startup, %u bytes of sprites kept, %u bytes of scratch\n",
+		   t_decode * 1e6, heap[0], heap[1]);
+	printf("atlas:  %9.3f us per startup, 0 bytes kept, 0 bytes of scratch\n", t_atlas * 1e6);
+
+	// A full-screen image for scale
+	n = snprintf(hdr, sizeof(hdr), "P7\nWIDTH 640\nHEIGHT 480\nDEPTH 4\nMAXVAL 255\nENDHDR\n");
+	big.size = n + 640*480*4;
+	big.data = malloc(big.size);
+	memcpy(big.data, hdr, n);
+	for(i=n; i<big.size; i++)
+		big.data[i] = i * 7;
+	t_big = cpuSeconds();
+	for(r=0; r<REPEAT/100; r++) {
+		heap[0] = heap[1] = 0;
+		decodeImage(&big, &spr, heap);
+		free((void *)spr.data);
+	}
+	t_big = (cpuSeconds() - t_big) / (REPEAT/100);
+	printf("decode of one 640x480 image: %.0f us, %u bytes kept, %u bytes of scratch\n",
+		   t_big * 1e6, heap[0], heap[1]);
+
+	for(i=0; i<argc-2; i++) {
+		free((void *)decoded[i].data);
+		free(images[i].data);
+	}
+	free(big.data);
+	free(decoded);
+	free(images);
+	free(atlas.data);
+	return bad;
+}
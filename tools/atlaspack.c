@@ -0,0 +1,258 @@
+/*****************************************************************************
+ * atlaspack - bakes images into a YUY2 sprite atlas (see source/atlas.h)    *
+ *                                                                           *
+ * usage: atlaspack -o <out.atlas> [-H <ids.h>] image...                     *
+ *                                                                           *
+ * Accepts binary (P6) and plain (P3) PPM as well as PAM (P7) with RGB or    *
+ * RGB_ALPHA tuples, maxval 255. Pure magenta (255,0,255) in PPM images and  *
+ * alpha below COLOR_ALPHA_CUTOFF in PAM images are transparent.             *
+ *                                                                           *
+ * Runs on the build host; the output is big endian and ready to be linked   *
+ * in with bin2o.                                                            *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "atlas.h"
+
+#define MAX_IMAGES 1024
+
+typedef struct {
+	char name[ATLAS_NAME_LEN];
+	int width, height, keyed;
+	u8 *rgba;
+} Image;
+
+static Image images[MAX_IMAGES];
+static int num_images = 0;
+
+static void die(const char *msg, const char *arg)
+{
+	fprintf(stderr, "atlaspack: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+	exit(1);
+}
+
+static void put16(u8 *p, u32 v) { p[0] = v >> 8; p[1] = v; }
+static void put32(u8 *p, u32 v) { p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v; }
+
+/*****************************************************************************
+ * Netpbm header parsing                                                     *
+ *****************************************************************************/
+static int readToken(FILE *f, char *buf, int len)
+{
+	int c, n = 0;
+
+	// Skip whitespace and comments
+	for(;;) {
+		c = fgetc(f);
+		if(c == '#')
+			while(c != '\n' && c != EOF) c = fgetc(f);
+		else if(!isspace(c))
+			break;
+	}
+	while(c != EOF && !isspace(c) && n < len-1) {
+		buf[n++] = c;
+		c = fgetc(f);
+	}
+	buf[n] = 0;
+	return n;
+}
+
+static int readInt(FILE *f)
+{
+	char buf[32];
+	if(!readToken(f, buf, sizeof(buf)))
+		return -1;
+	return atoi(buf);
+}
+
+static void loadImage(const char *path)
+{
+	FILE *f;
+	Image *img;
+	char magic[8], tok[32];
+	const char *base, *dot;
+	int i, n, depth = 3, maxval, plain = 0;
+	u8 *p;
+
+	if(num_images >= MAX_IMAGES)
+		die("too many images", path);
+	img = &images[num_images++];
+
+	f = fopen(path, "rb");
+	if(!f)
+		die("cannot open", path);
+
+	readToken(f, magic, sizeof(magic));
+	if(strcmp(magic, "P7") == 0) {
+		img->width = img->height = maxval = -1;
+		depth = 0;
+		while(readToken(f, tok, sizeof(tok)) && strcmp(tok, "ENDHDR") != 0) {
+			if(strcmp(tok, "WIDTH") == 0) img->width = readInt(f);
+			else if(strcmp(tok, "HEIGHT") == 0) img->height = readInt(f);
+			else if(strcmp(tok, "DEPTH") == 0) depth = readInt(f);
+			else if(strcmp(tok, "MAXVAL") == 0) maxval = readInt(f);
+			else if(strcmp(tok, "TUPLTYPE") == 0) readToken(f, tok, sizeof(tok));
+		}
+		// readToken() already consumed the newline after ENDHDR
+		if(depth != 3 && depth != 4)
+			die("PAM images must be RGB or RGB_ALPHA", path);
+	}
+	else if(strcmp(magic, "P6") == 0 || strcmp(magic, "P3") == 0) {
+		plain = (magic[1] == '3');
+		img->width = readInt(f);
+		img->height = readInt(f);
+		maxval = readInt(f);
+	}
+	else
+		die("not a PPM or PAM image", path);
+
+	if(img->width <= 0 || img->height <= 0 || img->width > 0xffff || img->height > 0xffff)
+		die("bad image dimensions", path);
+	if(maxval != 255)
+		die("only maxval 255 is supported", path);
+
+	n = img->width * img->height;
+	img->rgba = malloc(n * 4);
+	if(!img->rgba)
+		die("out of memory", path);
+
+	for(i=0, p=img->rgba; i<n; i++, p+=4) {
+		if(plain) {
+			p[0] = readInt(f);
+			p[1] = readInt(f);
+			p[2] = readInt(f);
+		}
+		else if(fread(p, 1, depth, f) != (size_t)depth)
+			die("truncated image", path);
+
+		if(depth == 3)
+			p[3] = (p[0] == 255 && p[1] == 0 && p[2] == 255) ? 0 : 255;
+		if(p[3] < COLOR_ALPHA_CUTOFF)
+			img->keyed = 1;
+	}
+	fclose(f);
+
+	// Name is the file name without directory and extension
+	base = strrchr(path, '/');
+	base = base ? base+1 : path;
+	dot = strchr(base, '.');
+	n = dot ? dot - base : (int)strlen(base);
+	if(n >= ATLAS_NAME_LEN)
+		n = ATLAS_NAME_LEN-1;
+	memcpy(img->name, base, n);
+}
+
+/*****************************************************************************
+ * Output                                                                    *
+ *****************************************************************************/
+static void writeIds(const char *path, const char *out_path)
+{
+	FILE *f;
+	char guard[80], ident[64];
+	const char *base;
+	int i, j;
+
+	f = fopen(path, "w");
+	if(!f)
+		die("cannot create", path);
+
+	base = strrchr(out_path, '/');
+	base = base ? base+1 : out_path;
+	for(j=0; base[j] && j<(int)sizeof(ident)-1; j++)
+		ident[j] = isalnum((unsigned char)base[j]) ? toupper((unsigned char)base[j]) : '_';
+	ident[j] = 0;
+	snprintf(guard, sizeof(guard), "__%s_IDS_H__", ident);
+
+	fprintf(f, "/* Generated by atlaspack, do not edit */\n");
+	fprintf(f, "#ifndef %s\n#define %s\n\n", guard, guard);
+	for(i=0; i<num_images; i++) {
+		fprintf(f, "#define %s_", ident);
+		for(j=0; images[i].name[j]; j++)
+			fputc(isalnum((unsigned char)images[i].name[j]) ?
+				  toupper((unsigned char)images[i].name[j]) : '_', f);
+		fprintf(f, " %d\n", i);
+	}
+	fprintf(f, "#define %s_COUNT %d\n\n#endif\n", ident, num_images);
+	fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+	const char *out_path = NULL, *ids_path = NULL;
+	u32 offset, size, *pairs;
+	u8 *blob, *e;
+	int i, j, pitch, words;
+	FILE *f;
+
+	for(i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-o") == 0 && i+1 < argc)
+			out_path = argv[++i];
+		else if(strcmp(argv[i], "-H") == 0 && i+1 < argc)
+			ids_path = argv[++i];
+		else
+			loadImage(argv[i]);
+	}
+	if(!out_path || num_images == 0)
+		die("usage: atlaspack -o <out.atlas> [-H <ids.h>] image...", NULL);
+
+	// Lay out header, table and 32 byte aligned images
+	offset = sizeof(AtlasHeader) + num_images*sizeof(AtlasEntry);
+	size = offset;
+	for(i=0; i<num_images; i++) {
+		size = (size + ATLAS_ALIGN-1) & ~(ATLAS_ALIGN-1);
+		size += ((images[i].width+1) >> 1) * images[i].height * 4;
+	}
+	size = (size + ATLAS_ALIGN-1) & ~(ATLAS_ALIGN-1);
+
+	blob = calloc(1, size);
+	if(!blob)
+		die("out of memory", NULL);
+
+	put32(blob, ATLAS_MAGIC);
+	put16(blob + 4, ATLAS_VERSION);
+	put16(blob + 6, num_images);
+	put32(blob + 8, size);
+
+	for(i=0; i<num_images; i++) {
+		offset = (offset + ATLAS_ALIGN-1) & ~(ATLAS_ALIGN-1);
+		pitch = (images[i].width+1) >> 1;
+		words = pitch * images[i].height;
+
+		e = blob + sizeof(AtlasHeader) + i*sizeof(AtlasEntry);
+		put16(e, images[i].width);
+		put16(e + 2, images[i].height);
+		put16(e + 4, pitch);
+		put16(e + 6, images[i].keyed ? SPRITE_KEYED : 0);
+		put32(e + 8, ATLAS_KEY);
+		put32(e + 12, offset);
+		memcpy(e + 16, images[i].name, ATLAS_NAME_LEN);
+
+		// Convert with the same code the game uses, then store big endian
+		pairs = malloc(words * 4);
+		if(!pairs)
+			die("out of memory", NULL);
+		colorConvertRGBA(images[i].rgba, images[i].width, images[i].height,
+						 images[i].width*4, pairs, pitch, ATLAS_KEY);
+		for(j=0; j<words; j++)
+			put32(blob + offset + j*4, pairs[j]);
+		free(pairs);
+
+		offset += words * 4;
+	}
+
+	f = fopen(out_path, "wb");
+	if(!f)
+		die("cannot create", out_path);
+	if(fwrite(blob, 1, size, f) != size)
+		die("write failed", out_path);
+	fclose(f);
+
+	if(ids_path)
+		writeIds(ids_path, out_path);
+
+	free(blob);
+	return 0;
+}
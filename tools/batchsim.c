@@ -0,0 +1,275 @@
+/*****************************************************************************
+ * batchsim - runs headless matches of the game simulation (source/sim.h)    *
+ *                                                                           *
+ * usage: batchsim [-r runs] [-f frames] [-b balls] [-p players] [-s seed]   *
+ *                 [-v paddle speed] [-j threads] [-o out.csv]               *
+ *                 [-P name=value ...]                                       *
+ *                                                                           *
+ * Every run is an independent Sim with its own seed, played by the game's   *
+ * CPU players (simAutoSteer) moving at no more than the paddle speed. Runs  *
+ * are spread over a pool of threads, one line of statistics per run goes to *
+ * the CSV file (stdout by default) and the throughput is reported on        *
+ * stderr. -P overrides a gameplay constant, e.g. -P ball_max_speed=14;      *
+ * -P help lists them.                                                       *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "sim.h"
+
+#define FB_WIDTH  640	// playfield is laid out like on a 640x480 mode
+#define FB_HEIGHT 480
+
+typedef struct {
+	const char *name;
+	size_t offset;
+} Param;
+
+static const Param params[] = {
+	{ "ball_min_width",  offsetof(SimParams, ball_min_width) },
+	{ "ball_max_width",  offsetof(SimParams, ball_max_width) },
+	{ "ball_min_height", offsetof(SimParams, ball_min_height) },
+	{ "ball_max_height", offsetof(SimParams, ball_max_height) },
+	{ "ball_min_speed",  offsetof(SimParams, ball_min_speed) },
+	{ "ball_max_speed",  offsetof(SimParams, ball_max_speed) },
+	{ "token_width",     offsetof(SimParams, token_width) },
+	{ "token_length",    offsetof(SimParams, token_length) },
+	{ "margin_top",      offsetof(SimParams, margin_top) },
+	{ "margin_bottom",   offsetof(SimParams, margin_bottom) },
+	{ "margin_left",     offsetof(SimParams, margin_left) },
+	{ "margin_right",    offsetof(SimParams, margin_right) },
+};
+#define NUM_PARAMS (int)(sizeof(params)/sizeof(params[0]))
+
+typedef struct {
+	u32 seed;
+	u32 frames;
+	u32 paddle_hits;	// bounces off a token
+	u32 wall_hits;		// bounces off a border nobody guards
+	u32 misses;			// bounces off a guarded border, ends a rally
+	u32 rallies;		// finished rallies, including the last one
+	u32 max_rally;		// most paddle hits between two misses
+	u32 sounds;			// collision sounds the game would start
+	double cpu_s;
+} RunStats;
+
+// Shared read-only setup, plus the work counter
+static SimParams sim_params;
+static int num_runs = 1000, num_frames = 3600, num_balls = 1, num_players = 2;
+static int paddle_speed = 8;
+static u32 base_seed = 1;
+static RunStats *results;
+static volatile int next_run = 0;
+
+static void die(const char *msg, const char *arg)
+{
+	fprintf(stderr, "batchsim: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+	exit(2);
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double wallSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*****************************************************************************
+ * A border contact counts as a miss if the player guarding it is in the     *
+ * game. Which of the two borders of an axis was hit follows from the side   *
+ * of the playfield the ball ended up on.                                    *
+ *****************************************************************************/
+static int missed(const Sim *sim, const Particle *p, int axis)
+{
+	const CollideBounds *b = &sim->bounds;
+	int player;
+
+	if(axis == 0)
+		player = (p->pos_x + (p->size_x>>1) < ((b->l + b->r) >> 1)) ? 0 : 1;
+	else
+		player = (p->pos_y + (p->size_y>>1) < ((b->t + b->b) >> 1)) ? 2 : 3;
+	return player < sim->num_players;
+}
+
+static void runMatch(int run, RunStats *st)
+{
+	Sim sim;
+	u8 *hits;
+	u32 rally = 0;
+	int f, i;
+	double t0 = cpuSeconds();
+
+	memset(st, 0, sizeof(*st));
+	st->seed = base_seed + run * 0x9e3779b9u;
+	if(simInit(&sim, &sim_params, FB_WIDTH, FB_HEIGHT,
+			   num_balls + num_players, num_players, st->seed) < 0)
+		die("out of memory", NULL);
+	simSpawnBalls(&sim, num_balls);
+	hits = malloc(sim.entities.capacity);
+	if(hits == NULL)
+		die("out of memory", NULL);
+
+	for(f=0; f<num_frames; f++) {
+		for(i=0; i<num_players; i++)
+			simAutoSteer(&sim, i, num_balls, paddle_speed);
+		simStep(&sim, num_balls, hits);
+
+		for(i=0; i<sim.entities.count; i++) {
+			if(!hits[i])
+				continue;
+			// Same rule as updateParticles() in the game
+			if(hits[i] & (COLLIDE_BORDER_X | COLLIDE_PADDLE))
+				st->sounds++;
+			if(hits[i] & COLLIDE_BORDER_Y)
+				st->sounds++;
+
+			if(hits[i] & COLLIDE_PADDLE) {
+				st->paddle_hits++;
+				rally++;
+			}
+			if(hits[i] & COLLIDE_BORDER_X) {
+				if(missed(&sim, &sim.entities.items[i], 0)) {
+					st->misses++;
+					st->rallies++;
+					if(rally > st->max_rally) st->max_rally = rally;
+					rally = 0;
+				}
+				else
+					st->wall_hits++;
+			}
+			if(hits[i] & COLLIDE_BORDER_Y) {
+				if(missed(&sim, &sim.entities.items[i], 1)) {
+					st->misses++;
+					st->rallies++;
+					if(rally > st->max_rally) st->max_rally = rally;
+					rally = 0;
+				}
+				else
+					st->wall_hits++;
+			}
+		}
+	}
+	st->rallies++;
+	if(rally > st->max_rally) st->max_rally = rally;
+	st->frames = num_frames;
+
+	free(hits);
+	simFree(&sim);
+	st->cpu_s = cpuSeconds() - t0;
+}
+
+static void *worker(void *arg)
+{
+	int run;
+
+	for(;;) {
+		run = __sync_fetch_and_add(&next_run, 1);
+		if(run >= num_runs)
+			break;
+		runMatch(run, &results[run]);
+	}
+	return NULL;
+}
+
+static void setParam(const char *arg)
+{
+	const char *eq = strchr(arg, '=');
+	int i;
+
+	if(strcmp(arg, "help") == 0) {
+		for(i=0; i<NUM_PARAMS; i++)
+			fprintf(stderr, "%s=%d\n", params[i].name,
+					*(int *)((char *)&sim_params + params[i].offset));
+		exit(0);
+	}
+	for(i=0; eq && i<NUM_PARAMS; i++) {
+		if(strlen(params[i].name) == (size_t)(eq - arg) &&
+		   strncmp(params[i].name, arg, eq - arg) == 0) {
+			*(int *)((char *)&sim_params + params[i].offset) = atoi(eq + 1);
+			return;
+		}
+	}
+	die("unknown parameter", arg);
+}
+
+int main(int argc, char **argv)
+{
+	const char *out_path = NULL;
+	int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t *threads;
+	FILE *out = stdout;
+	double wall, cpu = 0;
+	u64 frames = 0;
+	int i, c;
+
+	simDefaults(&sim_params);
+	while((c = getopt(argc, argv, "r:f:b:p:s:v:j:o:P:")) != -1) {
+		switch(c) {
+			case 'r': num_runs = atoi(optarg); break;
+			case 'f': num_frames = atoi(optarg); break;
+			case 'b': num_balls = atoi(optarg); break;
+			case 'p': num_players = atoi(optarg); break;
+			case 's': base_seed = strtoul(optarg, NULL, 0); break;
+			case 'v': paddle_speed = atoi(optarg); break;
+			case 'j': num_threads = atoi(optarg); break;
+			case 'o': out_path = optarg; break;
+			case 'P': setParam(optarg); break;
+			default: die("bad arguments, see the top of batchsim.c", NULL);
+		}
+	}
+	if(num_runs < 1 || num_frames < 1 || num_balls < 1 ||
+	   num_players < 1 || num_players > SIM_MAX_PLAYERS)
+		die("bad arguments, see the top of batchsim.c", NULL);
+	if(num_threads < 1)
+		num_threads = 1;
+
+	results = calloc(num_runs, sizeof(RunStats));
+	threads = malloc(num_threads * sizeof(pthread_t));
+	if(results == NULL || threads == NULL)
+		die("out of memory", NULL);
+
+	wall = wallSeconds();
+	for(i=0; i<num_threads; i++)
+		if(pthread_create(&threads[i], NULL, worker, NULL) != 0)
+			die("cannot create thread", NULL);
+	for(i=0; i<num_threads; i++)
+		pthread_join(threads[i], NULL);
+	wall = wallSeconds() - wall;
+
+	if(out_path && (out = fopen(out_path, "w")) == NULL)
+		die("cannot open", out_path);
+	fprintf(out, "run,seed,frames,balls,players,paddle_hits,wall_hits,misses,"
+				 "max_rally,mean_rally,sounds\n");
+	for(i=0; i<num_runs; i++) {
+		const RunStats *st = &results[i];
+		fprintf(out, "%d,%u,%u,%d,%d,%u,%u,%u,%u,%.2f,%u\n", i, st->seed,
+				st->frames, num_balls, num_players, st->paddle_hits,
+				st->wall_hits, st->misses, st->max_rally,
+				(double)st->paddle_hits / st->rallies, st->sounds);
+		frames += st->frames;
+		cpu += st->cpu_s;
+	}
+	if(out != stdout)
+		fclose(out);
+
+	fprintf(stderr, "%d runs, %llu frames on %d threads in %.2f s: "
+			"%.0f frames/s, %.0f frames/s per core\n",
+			num_runs, (unsigned long long)frames, num_threads, wall,
+			frames / wall, cpu > 0 ? frames / cpu : 0);
+
+	free(threads);
+	free(results);
+	return 0;
+}
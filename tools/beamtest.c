@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * beamtest - late band detection of beam racing (source/beam.h)             *
+ *                                                                           *
+ * usage: beamtest [-f frames] [-v]                                          *
+ *                                                                           *
+ * Runs beamRace() against a simulated scanline counter: a field of 560      *
+ * lines, 80 of vertical blank followed by 480 visible ones, on a clock that *
+ * only the band draws advance. Every frame starts at the next vertical      *
+ * sync, like after VIDEO_WaitVSync(). An independent checker notes each     *
+ * band that was finished after the beam scanned its first line, and each    *
+ * band that was started while the previous field still showed it. Draw      *
+ * costs follow several profiles, from well ahead of the beam to falling a   *
+ * field behind. -v prints every late band. Exits with 1 if beamRace()       *
+ * counts a different number of late bands than the checker in any frame,    *
+ * or if a band is started early.                                            *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "beam.h"
+
+#define FIELD   560		// lines per field
+#define VBLANK  80		// lines before the picture
+#define HEIGHT  480		// framebuffer and picture lines
+#define BAND    32		// TILE_HEIGHT
+
+typedef struct {
+	const char *name;
+	int base, spread;	// lines of beam time per band: base + rand % spread
+	int spike;			// every band this far into the frame costs a field
+} Profile;
+
+static const Profile profiles[] = {
+	{ "idle",        1,  2,  0 },
+	{ "steady",     20,  1,  0 },
+	{ "random",      0, 60,  0 },
+	{ "spike",      10,  1,  7 },
+	{ "behind",     40,  1,  0 },
+	{ "overrun",    80, 20,  0 },
+};
+
+static long now = 0;		// simulated clock in lines since the first field
+static long field = 0;		// start of the field the frame is drawn for
+static int checked_late;
+static long early;
+static int verbose = 0;
+static const Profile *profile;
+static u32 rng = 1;
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+// The VI's line counter and the fields since the race started, mapped to
+// framebuffer lines like beamLine()
+static int simLine(void)
+{
+	return (int)(now - field) - VBLANK;
+}
+
+static void drawBand(int y1, int y2, void *arg)
+{
+	int cost = profile->base + rnd() % profile->spread;
+
+	// The previous field scans this band until field - FIELD + VBLANK + y2
+	if(now <= field - FIELD + VBLANK + y2) {
+		fprintf(stderr, "beamtest: %s: band %d started while still on screen\n",
+				profile->name, y1 / BAND);
+		early++;
+	}
+	if(profile->spike && y1 / BAND == profile->spike)
+		cost += FIELD;
+	now += cost;
+
+	// Late once the beam got to the band's first line in this field
+	if(now >= field + VBLANK + y1) {
+		checked_late++;
+		if(verbose)
+			printf("%s: band %d done at line %ld of the field\n", profile->name,
+				   y1 / BAND, now - field - VBLANK);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	BeamRace br;
+	long mismatch = 0, late_total;
+	int c, f, k, late, num_frames = 1000;
+
+	while((c = getopt(argc, argv, "f:v")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			case 'v': verbose = 1; break;
+			default: fprintf(stderr, "beamtest: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 1)
+		num_frames = 1;
+
+	printf("%d frames of %d bands, %d of %d lines visible\n", num_frames,
+		   (HEIGHT + BAND - 1) / BAND, HEIGHT, FIELD);
+	for(k=0; k<(int)(sizeof(profiles)/sizeof(profiles[0])); k++) {
+		profile = &profiles[k];
+		beamInit(&br, simLine, HEIGHT, BAND);
+		now = 0;
+		late_total = 0;
+		for(f=0; f<num_frames; f++) {
+			// VIDEO_WaitVSync()
+			field = (now + FIELD - 1) / FIELD * FIELD;
+			if(field == now && f > 0)
+				field += FIELD;
+			now = field;
+
+			checked_late = 0;
+			late = beamRace(&br, drawBand, NULL);
+			late_total += checked_late;
+			if(late != checked_late) {
+				fprintf(stderr, "beamtest: %s, frame %d: beamRace() counted %d late bands,"
+						" the checker %d\n", profile->name, f, late, checked_late);
+				mismatch++;
+			}
+		}
+		printf("%-8s late %5u of %5u bands (checker %5ld), least slack %4d lines\n",
+			   profile->name, br.late, br.bands, late_total, br.min_slack);
+		if(br.late != late_total)
+			mismatch++;
+	}
+	return (mismatch || early) ? 1 : 0;
+}
@@ -0,0 +1,295 @@
+/*****************************************************************************
+ * boottest - startup steps against host stand-ins (source/boot.h)           *
+ *                                                                           *
+ * usage: boottest [-v us] [-a us] [-c us] [-s ms]                           *
+ *                                                                           *
+ * Runs the step table of template.c's init() with bootRun() on one pinned   *
+ * core, the way the Wii runs it. The game step is the real one: governor,   *
+ * entity pool, frame arena, particles and rewind buffer. The libogc steps   *
+ * are stand-ins: video config spins -v us (2000 by default), audio -a us    *
+ * (1000), controls -c us (500), the sync sleeps until the next field of a   *
+ * 60 Hz clock that starts with the tool and storage sleeps -s ms (300, an   *
+ * SD card mount). Host threads have no priorities. Prints when each step    *
+ * started and how long it took, and the time to the first frame, one field  *
+ * after bootRun() returns, for the table of template.c, for the order       *
+ * init() had before the table, with the sync inside video config and        *
+ * storage in line, and for the table in reverse. Exits with 1 if a step     *
+ * starts before a step it comes after, if bootRun() accepts a table that    *
+ * cannot run or if the table of template.c is not faster to the first       *
+ * frame than the order before it.                                           *
+ *****************************************************************************/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+#include "boot.h"
+#include "governor.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "sim.h"
+
+#define FIELD_US        16667
+#define FB_WIDTH        640
+#define FB_HEIGHT       480
+// Of template.c
+#define DEFAULT_PLAYERS 2
+#define NUM_PARTICLES   1
+#define MAX_ENTITIES    4096
+#define FRAME_ARENA_SIZE (256*1024)
+#define REWIND_SECONDS  10
+#define REWIND_RING_WORDS (1024*1024)
+
+enum { BOOT_STORAGE, BOOT_VIDEO, BOOT_AUDIO, BOOT_CONTROLS, BOOT_GAME,
+	   BOOT_SYNC, NUM_BOOT_STEPS };
+
+static pthread_t threads[8];
+static int num_threads = 0;
+static u64 vi_start;			// the first field of the video clock
+static int video_us = 2000, audio_us = 1000, controls_us = 500, storage_ms = 300;
+static Sim sim;
+static FrameArena arena;
+
+u64 gettime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+u32 diff_usec(u64 start, u64 end)
+{
+	return end - start;
+}
+
+s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg,
+                     void *stackbase, u32 stack_size, u8 prio)
+{
+	if(num_threads == 8 || pthread_create(&threads[num_threads], NULL, entry, arg) != 0)
+		return -1;
+	*thethread = num_threads++;
+	return 0;
+}
+
+s32 LWP_JoinThread(lwp_t thethread, void **value_ptr)
+{
+	return pthread_join(threads[thethread], value_ptr);
+}
+
+// CPU time of this thread, so that the other threads on the core stretch it
+static void spin(int us)
+{
+	struct timespec ts;
+	double start, now;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	start = ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+	do {
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		now = ts.tv_sec * 1e6 + ts.tv_nsec * 1e-3;
+	} while(now - start < us);
+}
+
+static void waitVSync()
+{
+	u64 since = gettime() - vi_start;
+	usleep(FIELD_US - since % FIELD_US);
+}
+
+static void initStorage()
+{
+	usleep(storage_ms * 1000);
+}
+
+static void initVideo()
+{
+	spin(video_us);
+}
+
+static void initVideoSync()
+{
+	spin(video_us);
+	waitVSync();
+}
+
+static void initAudio()
+{
+	spin(audio_us);
+}
+
+static void initControls()
+{
+	spin(controls_us);
+}
+
+static void initGame()
+{
+	EntityPool *pool = &sim.entities;
+	SimParams params;
+	SnapshotRegion regions[6];
+
+	governorInit(FIELD_US);
+	simDefaults(&params);
+	if(simInit(&sim, &params, FB_WIDTH, FB_HEIGHT, MAX_ENTITIES, DEFAULT_PLAYERS, 1) < 0 ||
+	   arenaInit(&arena, FRAME_ARENA_SIZE) < 0) {
+		fprintf(stderr, "boottest: out of memory\n");
+		exit(2);
+	}
+	simSpawnBalls(&sim, NUM_PARTICLES);
+
+	// The entity pool the way initSnapshots() registers it
+	memset(regions, 0, sizeof(regions));
+	regions[0] = (SnapshotRegion){ pool->items, pool->capacity * sizeof(Particle),
+								   &pool->count, sizeof(Particle) };
+	regions[1] = (SnapshotRegion){ pool->types, (pool->capacity + 3) & ~3, &pool->count, 1 };
+	regions[2] = (SnapshotRegion){ pool->owner, pool->capacity * sizeof(u16),
+								   &pool->count, sizeof(u16) };
+	regions[3] = (SnapshotRegion){ pool->dense, 3 * pool->capacity * sizeof(u16) };
+	regions[4] = (SnapshotRegion){ &pool->count, sizeof(pool->count) };
+	regions[5] = (SnapshotRegion){ sim.token, sizeof(sim.token) };
+	if(snapshotInit(regions, 6, REWIND_SECONDS*60, REWIND_RING_WORDS) < 0) {
+		fprintf(stderr, "boottest: cannot set up the rewind buffer\n");
+		exit(2);
+	}
+}
+
+static void freeGame()
+{
+	snapshotFree();
+	arenaFree(&arena);
+	simFree(&sim);
+}
+
+static void none()
+{
+}
+
+// g_boot_steps of template.c
+static const BootStep table[NUM_BOOT_STEPS] = {
+	[BOOT_STORAGE]  = { "storage",  initStorage,  0,                      60 },
+	[BOOT_VIDEO]    = { "video",    initVideo,    0 },
+	[BOOT_AUDIO]    = { "audio",    initAudio,    0 },
+	[BOOT_CONTROLS] = { "controls", initControls, BOOT_AFTER(BOOT_VIDEO) },
+	[BOOT_GAME]     = { "game",     initGame,     BOOT_AFTER(BOOT_VIDEO) },
+	[BOOT_SYNC]     = { "sync",     waitVSync,    BOOT_AFTER(BOOT_VIDEO) }
+};
+
+// init() before the table, every step after the one before
+static const BootStep sequential[] = {
+	{ "video+sync", initVideoSync, 0 },
+	{ "audio",      initAudio,     BOOT_AFTER(0) },
+	{ "controls",   initControls,  BOOT_AFTER(1) },
+	{ "storage",    initStorage,   BOOT_AFTER(2) },
+	{ "game",       initGame,      BOOT_AFTER(3) }
+};
+
+static void reverse(const BootStep *src, BootStep *dst, int count)
+{
+	int i, k;
+
+	for(i=0; i<count; i++) {
+		dst[count-1-i] = src[i];
+		dst[count-1-i].after = 0;
+		for(k=0; k<count; k++)
+			if(src[i].after & BOOT_AFTER(k))
+				dst[count-1-i].after |= BOOT_AFTER(count-1-k);
+	}
+}
+
+// Time to the first frame in us, -1 if a step started too early
+static int run(const char *name, const BootStep *src, int count, int *bad)
+{
+	BootStep steps[BOOT_MAX_STEPS];
+	u64 start;
+	u32 first_us;
+	int i, k, early = 0;
+
+	memcpy(steps, src, count * sizeof(BootStep));
+	vi_start = start = gettime();
+	if(bootRun(steps, count) < 0) {
+		fprintf(stderr, "boottest: %s: bootRun() failed\n", name);
+		(*bad)++;
+		return -1;
+	}
+	waitVSync();
+	first_us = diff_usec(start, gettime());
+	bootJoin(steps, count);
+	freeGame();
+
+	printf("%s: first frame after %.1f ms\n", name, first_us / 1e3);
+	for(i=0; i<count; i++) {
+		printf("  %-10s %s started %7.2f ms, took %7.2f ms\n", steps[i].name,
+			   steps[i].prio ? "thread" : "      ", steps[i].start_us / 1e3, steps[i].us / 1e3);
+		for(k=0; k<count; k++) {
+			if((steps[i].after & BOOT_AFTER(k)) && steps[i].start_us < steps[k].start_us + steps[k].us) {
+				fprintf(stderr, "boottest: %s: %s started before %s was done\n", name,
+						steps[i].name, steps[k].name);
+				early++;
+			}
+		}
+	}
+	*bad += early;
+	return early ? -1 : (int)first_us;
+}
+
+int main(int argc, char **argv)
+{
+	BootStep steps[NUM_BOOT_STEPS];
+	cpu_set_t cpus;
+	int c, bad = 0, graph, before;
+
+	while((c = getopt(argc, argv, "v:a:c:s:")) != -1) {
+		switch(c) {
+			case 'v': video_us = atoi(optarg); break;
+			case 'a': audio_us = atoi(optarg); break;
+			case 'c': controls_us = atoi(optarg); break;
+			case 's': storage_ms = atoi(optarg); break;
+			default: fprintf(stderr, "boottest: bad arguments\n"); return 2;
+		}
+	}
+
+	// One core like the Wii, threads only run while the others block
+	CPU_ZERO(&cpus);
+	CPU_SET(sched_getcpu() < 0 ? 0 : sched_getcpu(), &cpus);
+	if(sched_setaffinity(0, sizeof(cpus), &cpus) < 0)
+		fprintf(stderr, "boottest: cannot pin to one core, the threads run in parallel\n");
+
+	graph = run("template.c table", table, NUM_BOOT_STEPS, &bad);
+	before = run("before the table", sequential, 5, &bad);
+	reverse(table, steps, NUM_BOOT_STEPS);
+	run("table in reverse", steps, NUM_BOOT_STEPS, &bad);
+
+	// A step waiting for the thread joins it
+	memcpy(steps, table, sizeof(table));
+	steps[BOOT_GAME].after |= BOOT_AFTER(BOOT_STORAGE);
+	run("game after storage", steps, NUM_BOOT_STEPS, &bad);
+
+	// Tables that cannot run
+	for(c=0; c<NUM_BOOT_STEPS; c++)
+		steps[c] = (BootStep){ table[c].name, none, table[c].after, table[c].prio };
+	steps[BOOT_VIDEO].after = BOOT_AFTER(BOOT_SYNC);
+	if(bootRun(steps, NUM_BOOT_STEPS) != -1) {
+		fprintf(stderr, "boottest: bootRun() ran video and sync waiting for each other\n");
+		bad++;
+	}
+	bootJoin(steps, NUM_BOOT_STEPS);
+	steps[BOOT_VIDEO].after = 0;
+	steps[BOOT_GAME].after = BOOT_AFTER(NUM_BOOT_STEPS);
+	if(bootRun(steps, NUM_BOOT_STEPS) != -1) {
+		fprintf(stderr, "boottest: bootRun() ran game after a step that does not exist\n");
+		bad++;
+	}
+	bootJoin(steps, NUM_BOOT_STEPS);
+
+	if(graph >= 0 && before >= 0 && graph >= before) {
+		fprintf(stderr, "boottest: the table is not faster than the order before it\n");
+		bad++;
+	}
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+/*****************************************************************************
+ * capbench - cost of recording a frame with captureFrame() (source/rle.h)   *
+ *                                                                           *
+ * usage: capbench [-f frames]                                               *
+ *                                                                           *
+ * captureFrame() encodes each 640x480 frame on the game loop, so its cost   *
+ * comes out of the 16.7 ms frame budget at 60 Hz. This encodes a sequence   *
+ * of synthetic frames the way the game would produce them (black, the       *
+ * playfield and a few hundred moving balls), then the worst case of a new   *
+ * full-screen image every frame, and reports the time per frame and the     *
+ * share of the budget. Every frame is decoded again and compared; exits     *
+ * with 1 if any differs.                                                    *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "capture.h"
+#include "rle.h"
+
+#define FB_WIDTH   640
+#define FB_HEIGHT  480
+#define FB_WORDS   (FB_WIDTH/2 * FB_HEIGHT)
+#define BUDGET_US  16667
+#define NUM_BALLS  300
+
+static u32 rng = 1;
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void fillRect(u32 *fb, int x1, int y1, int x2, int y2, u32 color)
+{
+	int x, y;
+
+	for(y=y1; y<=y2; y++)
+		for(x=x1>>1; x<=x2>>1; x++)
+			fb[y*(FB_WIDTH/2) + x] = color;
+}
+
+/*****************************************************************************
+ * One frame of the game: the balls move by their speed and bounce off the   *
+ * playfield border                                                          *
+ *****************************************************************************/
+static void gameFrame(u32 *fb, int *balls)
+{
+	int i, *b;
+
+	for(i=0; i<FB_WORDS; i++)
+		fb[i] = CAPTURE_BLACK;
+	fillRect(fb, 32, 32, FB_WIDTH-33, 33, 0xff80ff80);
+	fillRect(fb, 32, FB_HEIGHT-34, FB_WIDTH-33, FB_HEIGHT-33, 0xff80ff80);
+	fillRect(fb, FB_WIDTH/2, 32, FB_WIDTH/2+1, FB_HEIGHT-33, 0xff80ff80);
+	for(i=0, b=balls; i<NUM_BALLS; i++, b+=5) {
+		b[0] += b[2];
+		b[1] += b[3];
+		if(b[0] < 40 || b[0] > FB_WIDTH-50) b[2] = -b[2];
+		if(b[1] < 40 || b[1] > FB_HEIGHT-50) b[3] = -b[3];
+		fillRect(fb, b[0], b[1], b[0]+7, b[1]+7, b[4]);
+	}
+}
+
+static void noiseFrame(u32 *fb)
+{
+	int i;
+
+	for(i=0; i<FB_WORDS; i++)
+		fb[i] = rnd();
+}
+
+static int run(const char *name, int num_frames, int game)
+{
+	u32 *fb = malloc(FB_WORDS * sizeof(u32));
+	u32 *ref = malloc(FB_WORDS * sizeof(u32));
+	u32 *check = malloc(FB_WORDS * sizeof(u32));
+	u32 *out = malloc(RLE_MAX_WORDS(FB_WORDS) * sizeof(u32));
+	int *balls = malloc(NUM_BALLS * 5 * sizeof(int));
+	double t, total = 0, worst = 0;
+	long words = 0;
+	int i, f, n, bad = 0;
+
+	if(!fb || !ref || !check || !out || !balls) {
+		fprintf(stderr, "capbench: out of memory\n");
+		exit(2);
+	}
+	for(i=0; i<FB_WORDS; i++)
+		ref[i] = check[i] = CAPTURE_BLACK;
+	for(i=0; i<NUM_BALLS*5; i+=5) {
+		balls[i] = 40 + rnd() % (FB_WIDTH-100);
+		balls[i+1] = 40 + rnd() % (FB_HEIGHT-100);
+		balls[i+2] = 1 + rnd() % 4;
+		balls[i+3] = 1 + rnd() % 4;
+		balls[i+4] = rnd();
+	}
+
+	for(f=0; f<num_frames; f++) {
+		if(game)
+			gameFrame(fb, balls);
+		else
+			noiseFrame(fb);
+
+		t = cpuSeconds();
+		n = rleEncode(fb, ref, FB_WORDS, out);
+		t = cpuSeconds() - t;
+		total += t;
+		if(t > worst)
+			worst = t;
+		words += n;
+
+		if(rleDecode(out, n, check, FB_WORDS) < 0 || memcmp(check, fb, FB_WORDS * sizeof(u32)))
+			bad = 1;
+	}
+
+	t = total / num_frames;
+	printf("%-10s %8.3f ms/frame (worst %6.3f), %5.1f%% of the 60 Hz budget, %6.1f KB/frame\n",
+		   name, t * 1e3, worst * 1e3, t * 1e6 * 100 / BUDGET_US,
+		   words * 4.0 / num_frames / 1024);
+
+	free(balls);
+	free(out);
+	free(check);
+	free(ref);
+	free(fb);
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	int c, bad, num_frames = 120;
+
+	while((c = getopt(argc, argv, "f:")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			default: fprintf(stderr, "capbench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 1)
+		num_frames = 1;
+
+	printf("%dx%d, %d frames\n", FB_WIDTH, FB_HEIGHT, num_frames);
+	bad = run("game", num_frames, 1);
+	bad |= run("noise", num_frames, 0);
+	if(bad)
+		fprintf(stderr, "capbench: decoded frames differ from the recorded ones\n");
+	return bad;
+}
@@ -0,0 +1,210 @@
+/*****************************************************************************
+ * capdiff - decodes framebuffer capture streams (see source/capture.h)      *
+ *                                                                           *
+ * usage: capdiff [-d <dir>] <capture.fbc> [golden.fbc]                      *
+ *                                                                           *
+ * With one stream, prints a summary of its frames. With two, compares them  *
+ * frame by frame, matched by frame number, and exits with 1 if any pixel    *
+ * pair differs or a frame is missing from either side. -d writes every      *
+ * mismatching frame of both streams to <dir> as PPM images.                 *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "rle.h"
+
+typedef struct {
+	const char *path;
+	FILE *f;
+	CaptureHeader hdr;
+	CaptureFrame cur;
+	u32 *frame;
+	u32 *payload;
+	int eof;
+} Stream;
+
+static u32 be32(const u8 *p) { return (p[0]<<24) | (p[1]<<16) | (p[2]<<8) | p[3]; }
+static u16 be16(const u8 *p) { return (p[0]<<8) | p[1]; }
+
+static void die(const char *msg, const char *arg)
+{
+	fprintf(stderr, "capdiff: %s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
+	exit(2);
+}
+
+static void openStream(Stream *s, const char *path)
+{
+	u8 raw[sizeof(CaptureHeader)];
+	u32 i;
+
+	memset(s, 0, sizeof(*s));
+	s->path = path;
+	s->f = fopen(path, "rb");
+	if(!s->f)
+		die("cannot open", path);
+	if(fread(raw, 1, sizeof(raw), s->f) != sizeof(raw))
+		die("truncated header", path);
+
+	s->hdr.magic = be32(raw);
+	s->hdr.version = be16(raw + 4);
+	s->hdr.width = be16(raw + 8);
+	s->hdr.height = be16(raw + 10);
+	s->hdr.words = be32(raw + 12);
+	if(s->hdr.magic != CAPTURE_MAGIC || s->hdr.version != CAPTURE_VERSION)
+		die("not a capture stream", path);
+	if(s->hdr.words != (u32)(s->hdr.width >> 1) * s->hdr.height)
+		die("inconsistent header", path);
+
+	s->frame = malloc(s->hdr.words * sizeof(u32));
+	s->payload = malloc(RLE_MAX_WORDS(s->hdr.words) * sizeof(u32));
+	if(!s->frame || !s->payload)
+		die("out of memory", path);
+	for(i=0; i<s->hdr.words; i++)
+		s->frame[i] = CAPTURE_BLACK;
+}
+
+/*****************************************************************************
+ * Reads and applies the next frame, returns 0 at the end of the stream      *
+ *****************************************************************************/
+static int nextFrame(Stream *s)
+{
+	u8 raw[sizeof(CaptureFrame)];
+	u32 i;
+
+	if(s->eof || fread(raw, 1, sizeof(raw), s->f) != sizeof(raw)) {
+		s->eof = 1;
+		return 0;
+	}
+	s->cur.frame = be32(raw);
+	s->cur.words = be32(raw + 4);
+	if(s->cur.words > RLE_MAX_WORDS(s->hdr.words) ||
+	   fread(s->payload, sizeof(u32), s->cur.words, s->f) != s->cur.words)
+		die("truncated frame", s->path);
+
+	for(i=0; i<s->cur.words; i++)
+		s->payload[i] = be32((u8 *)&s->payload[i]);
+	if(rleDecode(s->payload, s->cur.words, s->frame, s->hdr.words) < 0)
+		die("corrupt frame", s->path);
+	return 1;
+}
+
+static u8 clamp8(int v)
+{
+	return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+static void writePPM(const char *dir, const char *tag, const Stream *s)
+{
+	char path[1024];
+	FILE *f;
+	u32 i, c;
+	int y[2], cb, cr, k;
+	u8 rgb[6];
+
+	snprintf(path, sizeof(path), "%s/%s_%06u.ppm", dir, tag, s->cur.frame);
+	f = fopen(path, "wb");
+	if(!f)
+		die("cannot create", path);
+	fprintf(f, "P6\n%d %d\n255\n", s->hdr.width, s->hdr.height);
+	for(i=0; i<s->hdr.words; i++) {
+		c = s->frame[i];
+		y[0] = c >> 24;
+		y[1] = (c >> 8) & 0xff;
+		cb = ((c >> 16) & 0xff) - 128;
+		cr = (c & 0xff) - 128;
+		for(k=0; k<2; k++) {
+			rgb[k*3+0] = clamp8(y[k] + ((359*cr) >> 8));
+			rgb[k*3+1] = clamp8(y[k] - ((88*cb + 183*cr) >> 8));
+			rgb[k*3+2] = clamp8(y[k] + ((454*cb) >> 8));
+		}
+		fwrite(rgb, 1, 6, f);
+	}
+	fclose(f);
+}
+
+static int summary(Stream *s)
+{
+	u32 frames = 0, gaps = 0, expect = 0;
+	double words = 0;
+
+	while(nextFrame(s)) {
+		if(s->cur.frame != expect)
+			gaps += s->cur.frame - expect;
+		expect = s->cur.frame + 1;
+		words += s->cur.words;
+		frames++;
+	}
+	printf("%s: %dx%d, %u frames, %u dropped, %.1f bytes/frame\n",
+		   s->path, s->hdr.width, s->hdr.height, frames, gaps,
+		   frames ? words * 4 / frames : 0.0);
+	return 0;
+}
+
+static int compare(Stream *a, Stream *b, const char *dir)
+{
+	u32 i, diff, compared = 0, mismatched = 0, missing = 0;
+	int have_a = nextFrame(a), have_b = nextFrame(b);
+
+	while(have_a || have_b) {
+		// Frames only present on one side count as failures
+		if(!have_b || (have_a && a->cur.frame < b->cur.frame)) {
+			printf("frame %u: missing in %s\n", a->cur.frame, b->path);
+			missing++;
+			have_a = nextFrame(a);
+			continue;
+		}
+		if(!have_a || b->cur.frame < a->cur.frame) {
+			printf("frame %u: missing in %s\n", b->cur.frame, a->path);
+			missing++;
+			have_b = nextFrame(b);
+			continue;
+		}
+
+		for(i=0, diff=0; i<a->hdr.words; i++)
+			diff += (a->frame[i] != b->frame[i]);
+		if(diff) {
+			printf("frame %u: %u of %u pixel pairs differ\n",
+				   a->cur.frame, diff, a->hdr.words);
+			if(dir) {
+				writePPM(dir, "capture", a);
+				writePPM(dir, "golden", b);
+			}
+			mismatched++;
+		}
+		compared++;
+		have_a = nextFrame(a);
+		have_b = nextFrame(b);
+	}
+
+	printf("%u frames compared, %u differ, %u missing\n", compared, mismatched, missing);
+	return (mismatched || missing) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *dir = NULL, *paths[2];
+	int i, n = 0;
+	Stream a, b;
+
+	for(i=1; i<argc; i++) {
+		if(strcmp(argv[i], "-d") == 0 && i+1 < argc)
+			dir = argv[++i];
+		else if(n < 2)
+			paths[n++] = argv[i];
+		else
+			n = 3;
+	}
+	if(n < 1 || n > 2)
+		die("usage: capdiff [-d <dir>] <capture.fbc> [golden.fbc]", NULL);
+
+	openStream(&a, paths[0]);
+	if(n == 1)
+		return summary(&a);
+
+	openStream(&b, paths[1]);
+	if(a.hdr.width != b.hdr.width || a.hdr.height != b.hdr.height)
+		die("streams have different dimensions", NULL);
+	return compare(&a, &b, dir);
+}
@@ -0,0 +1,175 @@
+/*****************************************************************************
+ * collidetest - fast balls against thin paddles (source/collide.h)          *
+ *                                                                           *
+ * usage: collidetest [-f frames] [-s speed]                                 *
+ *                                                                           *
+ * Moves balls of random size at up to speed pixels per frame on each axis   *
+ * (100 by default) through a playfield with paddles as thin as the tokens   *
+ * of the game, using collideStep(). Every frame, each ball's straight path  *
+ * is also swept against every paddle in floating point; whenever that path  *
+ * clearly enters a paddle before any border, collideStep() must have        *
+ * reported the contact. No ball may end a frame inside a paddle, also not   *
+ * after bouncing off a border next to one. Exits with 1 if a ball tunnels.  *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "collide.h"
+
+#define NUM_BALLS   256
+#define NUM_PADDLES 4
+#define EPSILON     1e-3	// of a frame, where fixed point may round either way
+
+static u32 rng = 1;
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static int range(int lo, int hi)
+{
+	return lo + (int)(rnd() % (u32)(hi - lo + 1));
+}
+
+static int overlaps(const Particle *p, const Particle *q)
+{
+	return p->pos_x < q->pos_x + q->size_x && q->pos_x < p->pos_x + p->size_x &&
+		   p->pos_y < q->pos_y + q->size_y && q->pos_y < p->pos_y + p->size_y;
+}
+
+/*****************************************************************************
+ * Reference sweep: entry and exit time of p moving by (dx, dy) into q, as   *
+ * fractions of the frame                                                    *
+ *****************************************************************************/
+static void axisRef(double a, double len, double d, double b, double blen,
+					double *entry, double *exit)
+{
+	if(d == 0) {
+		*entry = (a + len <= b || a >= b + blen) ? 1e9 : -1e9;
+		*exit = (a + len <= b || a >= b + blen) ? -1e9 : 1e9;
+	}
+	else if(d > 0) {
+		*entry = (b - (a + len)) / d;
+		*exit = (b + blen - a) / d;
+	}
+	else {
+		*entry = (b + blen - a) / d;
+		*exit = (b - (a + len)) / d;
+	}
+}
+
+static double sweepRef(const Particle *p, const Particle *q, double limit)
+{
+	double ex, xx, ey, xy, entry, exit;
+
+	axisRef(p->pos_x, p->size_x, p->dx, q->pos_x, q->size_x, &ex, &xx);
+	axisRef(p->pos_y, p->size_y, p->dy, q->pos_y, q->size_y, &ey, &xy);
+	entry = (ex > ey) ? ex : ey;
+	exit = (xx < xy) ? xx : xy;
+	if(exit > limit)
+		exit = limit;
+	return (entry >= EPSILON && entry + EPSILON < exit) ? entry : -1;
+}
+
+// Fraction of the frame until p first touches a border, 1 if it does not
+static double borderTime(const Particle *p, const CollideBounds *f)
+{
+	double t = 1, u;
+
+	u = (p->dx > 0) ? (double)(f->r - p->size_x - p->pos_x) / p->dx :
+		(p->dx < 0) ? (double)(f->l - p->pos_x) / p->dx : 1;
+	if(u < t)
+		t = u;
+	u = (p->dy > 0) ? (double)(f->b - p->size_y - p->pos_y) / p->dy :
+		(p->dy < 0) ? (double)(f->t - p->pos_y) / p->dy : 1;
+	if(u < t)
+		t = u;
+	return t;
+}
+
+int main(int argc, char **argv)
+{
+	static const CollideBounds field = { 32, 24, 608, 456 };
+	Particle balls[NUM_BALLS], before[NUM_BALLS], pads[NUM_PADDLES], *paddles[NUM_PADDLES];
+	u8 types[NUM_BALLS], hits[NUM_BALLS];
+	int c, f, i, k, first, speed = 100, num_frames = 20000;
+	long checked = 0, contacts = 0, bad = 0;
+	double limit, t, best;
+
+	while((c = getopt(argc, argv, "f:s:")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			case 's': speed = atoi(optarg); break;
+			default: fprintf(stderr, "collidetest: bad arguments\n"); return 2;
+		}
+	}
+	if(speed < 1)
+		speed = 1;
+
+	// Tokens of four players, 5 pixels thin like TOKEN_SIZE_X, away from
+	// the borders so that balls can pass behind them
+	memset(pads, 0, sizeof(pads));
+	pads[0] = (Particle){ 120, 200, 5, 50 };
+	pads[1] = (Particle){ 515, 150, 5, 50 };
+	pads[2] = (Particle){ 250, 100, 50, 5 };
+	pads[3] = (Particle){ 350, 370, 50, 5 };
+	for(k=0; k<NUM_PADDLES; k++)
+		paddles[k] = &pads[k];
+
+	for(i=0; i<NUM_BALLS; i++) {
+		types[i] = ENTITY_BALL;
+		memset(&balls[i], 0, sizeof(balls[i]));
+		balls[i].size_x = range(1, 10);
+		balls[i].size_y = range(1, 10);
+		do {
+			balls[i].pos_x = range(field.l, field.r - balls[i].size_x);
+			balls[i].pos_y = range(field.t, field.b - balls[i].size_y);
+			for(k=0; k<NUM_PADDLES && !overlaps(&balls[i], &pads[k]); k++);
+		} while(k < NUM_PADDLES);
+		balls[i].dx = range(-speed, speed);
+		balls[i].dy = range(-speed, speed);
+	}
+
+	for(f=0; f<num_frames; f++) {
+		memcpy(before, balls, sizeof(balls));
+		collideStep(balls, types, NUM_BALLS, NUM_BALLS, paddles, NUM_PADDLES, &field, hits);
+
+		for(i=0; i<NUM_BALLS; i++) {
+			// The first paddle on the straight path has to be hit
+			limit = borderTime(&before[i], &field);
+			for(k=0, first=-1, best=2; k<NUM_PADDLES; k++) {
+				if(overlaps(&balls[i], &pads[k])) {
+					fprintf(stderr, "collidetest: frame %d, ball %d at (%d,%d) moving (%d,%d)"
+							" ends inside paddle %d\n", f, i, before[i].pos_x,
+							before[i].pos_y, before[i].dx, before[i].dy, k);
+					bad++;
+				}
+				t = sweepRef(&before[i], &pads[k], limit);
+				if(t >= 0 && t < best) {
+					best = t;
+					first = k;
+				}
+			}
+			if(hits[i] & COLLIDE_PADDLE)
+				contacts++;
+			if(first < 0)
+				continue;
+			checked++;
+			if(!(hits[i] & COLLIDE_PADDLE)) {
+				fprintf(stderr, "collidetest: frame %d, ball %d at (%d,%d) moving (%d,%d)"
+						" tunnels through paddle %d\n", f, i, before[i].pos_x,
+						before[i].pos_y, before[i].dx, before[i].dy, first);
+				bad++;
+			}
+		}
+	}
+
+	printf("%d frames, %d balls at up to %d px/frame: %ld paddle contacts, %ld checked"
+		   " against the reference, %ld tunnelled\n",
+		   num_frames, NUM_BALLS, speed, contacts, checked, bad);
+	return bad ? 1 : 0;
+}
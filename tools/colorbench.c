@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * colorbench - tests and benchmarks the colour pipeline (source/color.h)    *
+ *                                                                           *
+ * usage: colorbench [-f frames]                                             *
+ *                                                                           *
+ * Checks colorConvertRGBA() against a plain per-pixel implementation of     *
+ * the same matrix on images with odd widths and random alpha, then times    *
+ * full-screen 640x480 conversions with both and blitSprite() at even and    *
+ * odd x. Exits with 1 if any pair differs.                                  *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "color.h"
+
+#define FB_WIDTH  640
+#define FB_HEIGHT 480
+
+static u32 rng = 1;
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int clamp8(int v)
+{
+	return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+/*****************************************************************************
+ * Reference: one pixel at a time, as written down in color.c                *
+ *****************************************************************************/
+static u32 refPair(const u8 *p, const u8 *q)
+{
+	int y0 = (77*p[0] + 150*p[1] + 29*p[2] + 128) >> 8;
+	int y1 = (77*q[0] + 150*q[1] + 29*q[2] + 128) >> 8;
+	int rs = p[0] + q[0], gs = p[1] + q[1], bs = p[2] + q[2];
+	int cb = ((-43*rs -  85*gs + 128*bs + 256) >> 9) + 128;
+	int cr = ((128*rs - 107*gs -  21*bs + 256) >> 9) + 128;
+	return YUY2_PACK(y0, clamp8(cb), y1, clamp8(cr));
+}
+
+static void refConvert(const u8 *src, int width, int height, int src_pitch,
+                       u32 *dst, int dst_pitch, u32 key)
+{
+	int x, y, a0, a1;
+	const u8 *p;
+
+	for(y=0; y<height; y++) {
+		for(x=0; x<width; x+=2) {
+			p = src + y*src_pitch + x*4;
+			a0 = p[3] >= COLOR_ALPHA_CUTOFF;
+			a1 = x+1 < width && p[7] >= COLOR_ALPHA_CUTOFF;
+			if(!a0 && !a1)
+				dst[y*dst_pitch + x/2] = key;
+			else
+				dst[y*dst_pitch + x/2] = refPair(a0 ? p : p+4, a1 ? p+4 : p);
+		}
+	}
+}
+
+static int testConvert()
+{
+	static const int widths[] = { 1, 2, 3, 17, 64, 255 };
+	u8 *img = malloc(256*4*32);
+	u32 *a = malloc(128*32*4), *b = malloc(128*32*4);
+	int i, j, w, bad = 0;
+
+	for(i=0; i<(int)(sizeof(widths)/sizeof(widths[0])); i++) {
+		w = widths[i];
+		for(j=0; j<256*4*32; j++)
+			img[j] = rnd();
+		// Every pixel saturated in some channel now and then
+		for(j=0; j<256*4*32; j+=37)
+			img[j] = (j & 64) ? 255 : 0;
+		colorConvertRGBA(img, w, 32, 256*4, a, 128, 0x12345678);
+		refConvert(img, w, 32, 256*4, b, 128, 0x12345678);
+		for(j=0; j<32; j++)
+			if(memcmp(a + j*128, b + j*128, ((w+1)/2) * sizeof(u32)) != 0)
+				bad++;
+	}
+	free(img);
+	free(a);
+	free(b);
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	u8 *img, *spr_rgba;
+	u32 *pairs, *fb, *spr_data;
+	Sprite spr;
+	double t;
+	int i, f, c, x, y, keyed, bad, num_frames = 50, blits;
+
+	while((c = getopt(argc, argv, "f:")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			default: fprintf(stderr, "colorbench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 1)
+		num_frames = 1;
+
+	bad = testConvert();
+	printf("conversion vs per-pixel reference: %s\n", bad ? "MISMATCH" : "identical");
+
+	img = malloc(FB_WIDTH*FB_HEIGHT*4);
+	pairs = malloc(FB_WIDTH/2*FB_HEIGHT*sizeof(u32));
+	fb = calloc(FB_WIDTH/2*FB_HEIGHT, sizeof(u32));
+	if(!img || !pairs || !fb)
+		return 2;
+	for(i=0; i<FB_WIDTH*FB_HEIGHT*4; i++)
+		img[i] = rnd() | ((i & 3) == 3 ? 0x80 : 0);	// opaque
+
+	t = cpuSeconds();
+	for(f=0; f<num_frames; f++)
+		refConvert(img, FB_WIDTH, FB_HEIGHT, FB_WIDTH*4, pairs, FB_WIDTH/2, 0);
+	t = (cpuSeconds() - t) / num_frames;
+	printf("640x480 per-pixel reference: %6.3f ms, %6.1f Mpixels/s\n",
+		   t * 1e3, FB_WIDTH*FB_HEIGHT / t * 1e-6);
+
+	t = cpuSeconds();
+	for(f=0; f<num_frames; f++)
+		colorConvertRGBA(img, FB_WIDTH, FB_HEIGHT, FB_WIDTH*4, pairs, FB_WIDTH/2, 0);
+	t = (cpuSeconds() - t) / num_frames;
+	printf("640x480 colorConvertRGBA:    %6.3f ms, %6.1f Mpixels/s\n",
+		   t * 1e3, FB_WIDTH*FB_HEIGHT / t * 1e-6);
+
+	// A 64x64 sprite with a transparent corner, blitted all over the screen
+	spr_rgba = malloc(64*64*4);
+	spr_data = malloc(32*64*sizeof(u32));
+	for(i=0; i<64*64; i++) {
+		spr_rgba[i*4] = rnd(); spr_rgba[i*4+1] = rnd(); spr_rgba[i*4+2] = rnd();
+		spr_rgba[i*4+3] = ((i & 63) < 16 && i < 16*64) ? 0 : 255;
+	}
+	colorConvertRGBA(spr_rgba, 64, 64, 64*4, spr_data, 32, 0);
+	spr.width = spr.height = 64;
+	spr.pitch = 32;
+	spr.key = 0;
+	spr.data = spr_data;
+
+	for(keyed=0; keyed<2; keyed++) {
+		spr.flags = keyed ? SPRITE_KEYED : 0;
+		for(c=0; c<2; c++) {
+			blits = 0;
+			t = cpuSeconds();
+			for(f=0; f<num_frames; f++)
+				for(y=0; y+64<=FB_HEIGHT; y+=32)
+					for(x=c; x+64<=FB_WIDTH; x+=32, blits++)
+						blitSprite(fb, FB_WIDTH, FB_HEIGHT, &spr, x, y);
+			t = cpuSeconds() - t;
+			printf("blitSprite 64x64 %s x, %s: %6.1f Mpixels/s\n", c ? "odd " : "even",
+				   keyed ? "keyed  " : "opaque ", blits * 64.0 * 64 / t * 1e-6);
+		}
+	}
+
+	free(spr_data);
+	free(spr_rgba);
+	free(fb);
+	free(pairs);
+	free(img);
+	return bad ? 1 : 0;
+}
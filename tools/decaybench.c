@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * decaybench - cost of fading a frame for the trails (source/color.h)       *
+ *                                                                           *
+ * usage: decaybench [-f frames]                                             *
+ *                                                                           *
+ * Checks colorDecay() against a per-byte fade for every k from 0 to 256,    *
+ * then times it on 640x480 YUY2 frames next to the fill loop of             *
+ * VIDEO_ClearFrameBuffer(), the cost of a frame without trails. Frames:     *
+ * the game's, black but for the HUD, the playfield box and the fading       *
+ * copies of four tokens and a ball; the same with 3000 particles; and one   *
+ * without any black. clearDecay() adds the cache maintenance of the Wii,    *
+ * which the host has no equivalent of. Exits with 1 if a faded pair         *
+ * differs from the reference.                                               *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "color.h"
+
+#define FB_WIDTH    640
+#define FB_HEIGHT   480
+#define WORDS       (FB_WIDTH / 2 * FB_HEIGHT)
+#define BLACK       0x10801080	// CLEAR_BLACK of clear.h
+#define TRAIL_DECAY 192			// of template.c
+
+static u32 rng = 1;
+static volatile u32 sink;	// keeps the timed loops from being dropped
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static u8 fadeByte(u32 b, u32 k, u32 black)
+{
+	return (b * k + black * (256 - k)) >> 8;
+}
+
+static u32 fadeRef(u32 w, int k)
+{
+	return YUY2_PACK(fadeByte(YUY2_Y0(w), k, YUY2_Y0(BLACK)),
+					 fadeByte(YUY2_CB(w), k, YUY2_CB(BLACK)),
+					 fadeByte(YUY2_Y1(w), k, YUY2_Y1(BLACK)),
+					 fadeByte(YUY2_CR(w), k, YUY2_CR(BLACK)));
+}
+
+// What VIDEO_ClearFrameBuffer() does
+static void __attribute__((noinline)) fill(u32 *fb, int n, u32 color)
+{
+	int i;
+
+	for(i=0; i<n; i++)
+		fb[i] = color;
+}
+
+static void rect(u32 *fb, int x, int y, int w, int h, u32 color)
+{
+	int i, j;
+
+	for(j=y; j<y+h && j<FB_HEIGHT; j++)
+		for(i=x; i<x+w && i<FB_WIDTH/2; i++)
+			fb[j * FB_WIDTH/2 + i] = color;
+}
+
+// The HUD text on top, the playfield box with its center line and the
+// trails: 16 fading copies of every token and ball
+static void gameFrame(u32 *fb)
+{
+	int i;
+
+	fill(fb, WORDS, BLACK);
+	for(i=0; i<8*8*FB_WIDTH/2; i++)
+		if(rnd() % 4 == 0)
+			fb[i] = 0xeb80eb80;
+	rect(fb, 16, 24, 288, 1, 0xeb80eb80);
+	rect(fb, 16, 456, 288, 1, 0xeb80eb80);
+	rect(fb, 16, 24, 1, 432, 0xeb80eb80);
+	rect(fb, 160, 24, 1, 432, 0xeb80eb80);
+	rect(fb, 303, 24, 1, 432, 0xeb80eb80);
+	for(i=0; i<16; i++) {
+		rect(fb, 40 + i, 100 + 4*i, 3, 50, 0x80408040 + i);
+		rect(fb, 270 - i, 300 - 4*i, 3, 50, 0x80c080c0 + i);
+		rect(fb, 60 + 8*i, 40, 25, 3, 0x60506050 + i);
+		rect(fb, 200 - 8*i, 440, 25, 3, 0x60b060b0 + i);
+		rect(fb, 100 + 3*i, 200 + 5*i, 3, 8, 0xeb80eb80 - i);
+	}
+}
+
+static double timeDecay(u32 *dst, const u32 *src, int num_frames, int *lit)
+{
+	double t;
+	int f, i;
+
+	for(i=0, *lit=0; i<WORDS; i++)
+		*lit += src[i] != BLACK;
+	t = cpuSeconds();
+	for(f=0; f<num_frames; f++) {
+		colorDecay(dst, src, WORDS, TRAIL_DECAY, BLACK);
+		sink += dst[f % WORDS];
+	}
+	return (cpuSeconds() - t) / num_frames;
+}
+
+int main(int argc, char **argv)
+{
+	u32 *src = malloc(WORDS * sizeof(u32));
+	u32 *dst = malloc(WORDS * sizeof(u32));
+	static const char *names[] = { "game", "3000 particles", "no black" };
+	double t, t_fill, t_decay;
+	int c, i, k, f, lit, bad = 0, num_frames = 2000;
+
+	while((c = getopt(argc, argv, "f:")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			default: fprintf(stderr, "decaybench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 1)
+		num_frames = 1;
+	if(!src || !dst) {
+		fprintf(stderr, "decaybench: out of memory\n");
+		return 2;
+	}
+
+	// Every k, random pairs and black, also in the odd words at the end
+	for(k=0; k<=256; k++) {
+		for(i=0; i<1027; i++)
+			src[i] = (rnd() & 1) ? rnd() : BLACK;
+		colorDecay(dst, src, 1027, k, BLACK);
+		for(i=0; i<1027; i++) {
+			if(dst[i] != fadeRef(src[i], k)) {
+				fprintf(stderr, "decaybench: k=%d faded %08x to %08x instead of %08x\n",
+						k, src[i], dst[i], fadeRef(src[i], k));
+				bad++;
+				break;
+			}
+		}
+	}
+
+	t = cpuSeconds();
+	for(f=0; f<num_frames; f++) {
+		fill(dst, WORDS, BLACK);
+		sink += dst[f % WORDS];
+	}
+	t_fill = (cpuSeconds() - t) / num_frames;
+	printf("%dx%d, %d frames: fill %.1f us\n", FB_WIDTH, FB_HEIGHT, num_frames, t_fill * 1e6);
+
+	for(k=0; k<3; k++) {
+		if(k < 2)
+			gameFrame(src);
+		if(k == 1)
+			for(i=0; i<3000; i++)
+				rect(src, 16 + rnd() % 286, 24 + rnd() % 430, 2, 4, rnd() | 0x80008000);
+		if(k == 2)
+			for(i=0; i<WORDS; i++)
+				src[i] = rnd() | 0x80008000;
+		t_decay = timeDecay(dst, src, num_frames, &lit);
+		printf("decay, %-14s %5.1f%% not black: %6.1f us, %4.1fx the fill\n", names[k],
+			   lit * 100.0 / WORDS, t_decay * 1e6, t_decay / t_fill);
+	}
+
+	free(dst);
+	free(src);
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/*****************************************************************************
+ * ellipsebench - filled against outlined circles (source/tiles.h)           *
+ *                                                                           *
+ * usage: ellipsebench [-n shapes] [-f frames]                               *
+ *                                                                           *
+ * Draws n circles (10000 by default) of radius 1 to 16 at random places on  *
+ * a 640x480 framebuffer in three ways: as outlines a pixel at a time the    *
+ * way drawEllipse() does, filled through tilesAddEllipse() and as filled    *
+ * rectangles through tilesAddRect(), which is what balls cost before they   *
+ * were round. Reports the time per batch of n. The tiled circles are also   *
+ * compared with the same spans drawn directly with the hline kernel; exits  *
+ * with 1 if they differ.                                                    *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "raster.h"
+#include "spans.h"
+#include "tiles.h"
+
+#define FB_WIDTH  640
+#define FB_HEIGHT 480
+#define FB_WORDS  (FB_WIDTH/2 * FB_HEIGHT)
+
+typedef struct {
+	int xm, ym;
+	u32 color;
+} Shape;
+
+static u32 rng = 1;
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// drawEllipse() of template.c
+static void outline(u32 *fb, int xm, int ym, int a, int b, u32 color)
+{
+	int dx = 0, dy = b;
+	long a2 = a*a, b2 = b*b;
+	long err = b2-(2*b-1)*a2, e2;
+
+	do {
+		g_raster.pixel(fb, xm+dx, ym+dy, color);
+		g_raster.pixel(fb, xm-dx, ym+dy, color);
+		g_raster.pixel(fb, xm-dx, ym-dy, color);
+		g_raster.pixel(fb, xm+dx, ym-dy, color);
+
+		e2 = 2*err;
+		if(e2 <  (2*dx+1)*b2) { dx++; err += (2*dx+1)*b2; }
+		if(e2 > -(2*dy-1)*a2) { dy--; err -= (2*dy-1)*a2; }
+	} while(dy >= 0);
+
+	while(dx++ < a) {
+		g_raster.pixel(fb, xm+dx, ym, color);
+		g_raster.pixel(fb, xm-dx, ym, color);
+	}
+}
+
+// One span per row straight into the framebuffer
+static void spansDirect(u32 *fb, int xm, int ym, int r, u32 color)
+{
+	const u8 *spans = spansGet(r, r);
+	int dy;
+
+	g_raster.hline(fb, xm-spans[0], xm+spans[0], ym, color);
+	for(dy=1; dy<=r; dy++) {
+		g_raster.hline(fb, xm-spans[dy], xm+spans[dy], ym-dy, color);
+		g_raster.hline(fb, xm-spans[dy], xm+spans[dy], ym+dy, color);
+	}
+}
+
+static void tiled(u32 *fb, const Shape *s, int n, int r, int round)
+{
+	int i;
+
+	for(i=0; i<n; i++) {
+		if((round ? tilesAddEllipse(s[i].xm, s[i].ym, r, r, s[i].color) :
+			tilesAddRect(s[i].xm-r, s[i].ym-r, s[i].xm+r, s[i].ym+r, s[i].color)) < 0) {
+			tilesFlush(fb);
+			tilesBegin();
+			i--;
+		}
+	}
+	tilesFlush(fb);
+	tilesBegin();
+}
+
+int main(int argc, char **argv)
+{
+	static const int radii[] = { 1, 2, 4, 8, 16 };
+	Shape *shapes;
+	u32 *fb, *ref;
+	double t[3];
+	int c, f, i, k, r, bad = 0, num_shapes = 10000, num_frames = 20;
+
+	while((c = getopt(argc, argv, "n:f:")) != -1) {
+		switch(c) {
+			case 'n': num_shapes = atoi(optarg); break;
+			case 'f': num_frames = atoi(optarg); break;
+			default: fprintf(stderr, "ellipsebench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_shapes < 1)
+		num_shapes = 1;
+	if(num_frames < 1)
+		num_frames = 1;
+
+	shapes = malloc(num_shapes * sizeof(Shape));
+	fb = malloc(FB_WORDS * sizeof(u32));
+	ref = malloc(FB_WORDS * sizeof(u32));
+	if(!shapes || !fb || !ref) {
+		fprintf(stderr, "ellipsebench: out of memory\n");
+		return 2;
+	}
+	rasterInit(FB_WIDTH, FB_HEIGHT);
+	if(tilesInit(FB_WIDTH, FB_HEIGHT) < 0) {
+		fprintf(stderr, "ellipsebench: framebuffer too large\n");
+		return 2;
+	}
+	for(i=0; i<num_shapes; i++) {
+		shapes[i].xm = rnd() % FB_WIDTH;
+		shapes[i].ym = rnd() % FB_HEIGHT;
+		shapes[i].color = rnd();
+	}
+
+	printf("%d circles, %dx%d, us per batch:\n", num_shapes, FB_WIDTH, FB_HEIGHT);
+	printf("radius   outline   filled via tiles   rect via tiles\n");
+	for(k=0; k<(int)(sizeof(radii)/sizeof(radii[0])); k++) {
+		r = radii[k];
+
+		// Same spans, same drawing order: the frames have to match
+		memset(ref, 0, FB_WORDS * sizeof(u32));
+		for(i=0; i<num_shapes; i++)
+			spansDirect(ref, shapes[i].xm, shapes[i].ym, r, shapes[i].color);
+		memset(fb, 0, FB_WORDS * sizeof(u32));
+		tiled(fb, shapes, num_shapes, r, 1);
+		if(memcmp(fb, ref, FB_WORDS * sizeof(u32)) != 0) {
+			fprintf(stderr, "ellipsebench: tiled circles of radius %d differ\n", r);
+			bad++;
+		}
+
+		t[0] = cpuSeconds();
+		for(f=0; f<num_frames; f++)
+			for(i=0; i<num_shapes; i++)
+				outline(fb, shapes[i].xm, shapes[i].ym, r, r, shapes[i].color);
+		t[0] = cpuSeconds() - t[0];
+		t[1] = cpuSeconds();
+		for(f=0; f<num_frames; f++)
+			tiled(fb, shapes, num_shapes, r, 1);
+		t[1] = cpuSeconds() - t[1];
+		t[2] = cpuSeconds();
+		for(f=0; f<num_frames; f++)
+			tiled(fb, shapes, num_shapes, r, 0);
+		t[2] = cpuSeconds() - t[2];
+
+		printf("%6d %9.0f %18.0f %16.0f\n", r, t[0] * 1e6 / num_frames,
+			   t[1] * 1e6 / num_frames, t[2] * 1e6 / num_frames);
+	}
+
+	free(ref);
+	free(fb);
+	free(shapes);
+	return bad ? 1 : 0;
+}
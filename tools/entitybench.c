@@ -0,0 +1,154 @@
+/*****************************************************************************
+ * entitybench - spawn/despawn churn of the entity pool (source/entity.h)    *
+ *                                                                           *
+ * usage: entitybench [-n operations]                                        *
+ *                                                                           *
+ * Spawns and despawns entities in random order, keeping the pool at least   *
+ * half full, once with the game's capacity and once with the largest        *
+ * possible one. Every handle is checked against a shadow copy of what it    *
+ * should resolve to, and stale handles must not resolve. Reports            *
+ * operations per second next to the 100k per second the game has to         *
+ * sustain, the same churn through malloc()/free() and the time to iterate   *
+ * the live entities. Exits with 1 if the pool gives a wrong answer.         *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "entity.h"
+
+#define TARGET_OPS 100000	// spawn or despawn operations per second
+
+static u32 rng = 1;
+static volatile long sink;	// keeps the timed loops from being dropped
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int churn(int capacity, int num_ops)
+{
+	EntityPool pool;
+	EntityHandle *live, *dead, h;
+	Particle **blocks, *p;
+	double t_pool, t_malloc, t_iter;
+	int i, j, n = 0, num_dead = 0, bad = 0;
+
+	live = malloc(capacity * sizeof(EntityHandle));
+	dead = malloc(capacity * sizeof(EntityHandle));
+	blocks = malloc(capacity * sizeof(Particle *));
+	if(!live || !dead || !blocks || entityPoolInit(&pool, capacity) < 0) {
+		fprintf(stderr, "entitybench: out of memory\n");
+		exit(2);
+	}
+
+	// Pool: spawn while less than half full, otherwise either at random.
+	// Each entity carries its own handle in pos_x to check lookups.
+	t_pool = cpuSeconds();
+	for(i=0; i<num_ops; i++) {
+		if(n == 0 || (n < capacity/2 && (rnd() & 3)) || (n < capacity && (rnd() & 1))) {
+			h = entitySpawn(&pool, (rnd() & 1) ? ENTITY_BALL : ENTITY_PADDLE);
+			p = entityGet(&pool, h);
+			if(p == NULL) {
+				bad++;
+				continue;
+			}
+			p->pos_x = h;
+			live[n++] = h;
+		}
+		else {
+			j = rnd() % n;
+			if(entityDespawn(&pool, live[j]) < 0)
+				bad++;
+			if(num_dead < capacity)
+				dead[num_dead++] = live[j];
+			live[j] = live[--n];
+		}
+	}
+	t_pool = cpuSeconds() - t_pool;
+
+	// Every live handle resolves to its own entity, no stale one resolves
+	if(pool.count != n)
+		bad++;
+	for(i=0; i<n; i++) {
+		p = entityGet(&pool, live[i]);
+		if(p == NULL || (EntityHandle)p->pos_x != live[i])
+			bad++;
+	}
+	for(i=0; i<num_dead; i++)
+		if(entityGet(&pool, dead[i]) != NULL)
+			bad++;
+
+	// The same churn with one heap block per entity
+	rng = 1;
+	n = 0;
+	t_malloc = cpuSeconds();
+	for(i=0; i<num_ops; i++) {
+		if(n == 0 || (n < capacity/2 && (rnd() & 3)) || (n < capacity && (rnd() & 1))) {
+			rnd();
+			blocks[n] = calloc(1, sizeof(Particle));
+			if(blocks[n] == NULL)
+				break;
+			n++;
+		}
+		else {
+			j = rnd() % n;
+			free(blocks[j]);
+			blocks[j] = blocks[--n];
+		}
+	}
+	t_malloc = cpuSeconds() - t_malloc;
+	for(i=0; i<n; i++)
+		free(blocks[i]);
+
+	// Iterating the live entities is a walk over a dense array
+	t_iter = cpuSeconds();
+	for(j=0; j<100; j++)
+		for(i=0; i<pool.count; i++)
+			if(pool.types[i] == ENTITY_BALL)
+				sink += pool.items[i].pos_x;
+	t_iter = (cpuSeconds() - t_iter) / 100;
+
+	printf("capacity %5d: pool %7.1f Mops/s (%6.0fx target), malloc %7.1f Mops/s,"
+		   " iterating %5d live %7.2f us\n",
+		   capacity, num_ops / t_pool * 1e-6, num_ops / t_pool / TARGET_OPS,
+		   num_ops / t_malloc * 1e-6, pool.count, t_iter * 1e6);
+
+	entityPoolFree(&pool);
+	free(blocks);
+	free(dead);
+	free(live);
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	int c, bad, num_ops = 2000000;
+
+	while((c = getopt(argc, argv, "n:")) != -1) {
+		switch(c) {
+			case 'n': num_ops = atoi(optarg); break;
+			default: fprintf(stderr, "entitybench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_ops < 1)
+		num_ops = 1;
+
+	printf("%d spawn/despawn operations\n", num_ops);
+	bad = churn(4096, num_ops);
+	bad += churn(ENTITY_MAX, num_ops);
+	if(bad)
+		fprintf(stderr, "entitybench: %d wrong answers from the pool\n", bad);
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+/*****************************************************************************
+ * govtest - load ramp test of the quality governor (source/governor.h)      *
+ *                                                                           *
+ * usage: govtest [-v]                                                       *
+ *                                                                           *
+ * Runs governor.c against a simulated clock: every frame takes as long as   *
+ * the load curve of the scenario says, scaled by the particle share of the  *
+ * current level where the load depends on it. Checks the moving average,    *
+ * that steps down need the average above 85% (or a missed VSync) for a few  *
+ * frames in a row, that steps up need 120 frames below 50%, that no two     *
+ * changes come within the 30 frame hold time, and that a load between both  *
+ * marks never moves the level. Where the load scales, no frame may miss its *
+ * VSync once the hold time after the last change is over, and the average   *
+ * may not stay above the high mark for longer than a step down takes. An    *
+ * optional effect on top of flat and changing loads may only start with     *
+ * room for its cost below the high mark, has to be charged at once, has to  *
+ * stop before the level drops for it and may not start again sooner than a  *
+ * step up. -v prints every level change. Exits with 1 if a check fails.     *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "governor.h"
+
+#define BUDGET   16667
+#define HIGH_PCT 85
+#define LOW_PCT  50
+#define HOLD     30
+#define DOWN     4
+#define UP       120
+#define SETTLE   600		// last frames in which the level must not change
+#define WANT     100		// frame from which the optional effect is wanted
+
+static u64 now = 0;			// simulated clock in microseconds
+static int verbose = 0;
+static int failed = 0;
+
+u64 gettime(void)
+{
+	return now;
+}
+
+u32 diff_usec(u64 start, u64 end)
+{
+	return end - start;
+}
+
+typedef struct {
+	const char *name;
+	int frames;
+	int (*load)(int frame);	// percent of the budget at full quality
+	int scaled;				// load scales with particles_pct
+	int min_level, max_level;	// range the level has to end up in
+} Scenario;
+
+static int flat70(int f) { return 70; }
+static int flat40(int f) { return 40; }
+static int spikes(int f) { return (f % 50 == 0) ? 110 : 40; }
+
+// 40% up to 150% over 600 frames, held, then down to 20%
+static int ramp(int f)
+{
+	if(f < 600) return 40 + f * 110 / 600;
+	if(f < 900) return 150;
+	if(f < 1500) return 150 - (f - 900) * 130 / 600;
+	return 20;
+}
+
+// Particles are most of the work, so lower levels really are cheaper
+static int heavy(int f) { return 130; }
+
+static void fail(const Scenario *s, int frame, const char *msg)
+{
+	fprintf(stderr, "govtest: %s, frame %d: %s\n", s->name, frame, msg);
+	failed = 1;
+}
+
+static void run(const Scenario *s)
+{
+	int f, pct, cost, level, last_change = -1000, changes = 0;
+	int over = 0, under = 0, prev_level, late = 0;
+
+	governorInit(BUDGET);
+	for(f=0; f<s->frames; f++) {
+		pct = s->load(f);
+		if(s->scaled)
+			pct = 20 + (pct - 20) * governorSettings()->particles_pct / 100;
+		cost = BUDGET * pct / 100;
+
+		prev_level = governorLevel();
+		governorBeginFrame();
+		now += cost;
+		governorEndFrame();
+		now += BUDGET - (cost % BUDGET);	// wait for VSync
+		level = governorLevel();
+
+		// Streaks of frames above and below the marks
+		over = (governorCost()*100 > BUDGET*HIGH_PCT || cost > BUDGET) ? over+1 : 0;
+		under = (governorCost()*100 < BUDGET*LOW_PCT) ? under+1 : 0;
+		late += cost > BUDGET;
+
+		// Where the level changes the load, the governor has had its chance
+		// to step down once the hold time is over: a missed VSync or an
+		// average above the high mark for longer than a step takes means
+		// the frame time is not held
+		if(s->scaled && level == prev_level && f >= DOWN && f - last_change > HOLD &&
+		   (cost > BUDGET || over > DOWN))
+			fail(s, f, "over budget after settling");
+
+		if(level == prev_level)
+			continue;
+		changes++;
+		if(verbose)
+			printf("  %s frame %4d: level %d -> %d, load %3d%%, average %5u us\n",
+				   s->name, f, prev_level, level, pct, governorCost());
+		if(f - last_change <= HOLD)
+			fail(s, f, "changed within the hold time");
+		if(level > prev_level && over < DOWN)
+			fail(s, f, "stepped down without being over the high mark");
+		if(level < prev_level && under < UP)
+			fail(s, f, "stepped up too early");
+		if(level < prev_level && governorCost()*100 >= BUDGET*LOW_PCT)
+			fail(s, f, "stepped up above the low mark");
+		if(level > prev_level + 1 || level < prev_level - 1)
+			fail(s, f, "skipped a level");
+		if(f >= s->frames - SETTLE)
+			fail(s, f, "still changing at the end");
+		last_change = f;
+	}
+
+	level = governorLevel();
+	if(level < s->min_level || level > s->max_level)
+		fail(s, s->frames, "ended on the wrong level");
+	printf("%-8s %5d frames, %2d level changes, %3d over budget, final level %d,"
+		   " average %5u us\n", s->name, s->frames, changes, late, level, governorCost());
+}
+
+/*****************************************************************************
+ * An optional effect of opt percent on top of the load: it may only start   *
+ * if the average stays below the high mark with it, is charged at once,     *
+ * has to stop before the level drops for it and waits as long as a step up  *
+ * before starting again                                                     *
+ *****************************************************************************/
+typedef struct {
+	const char *name;
+	int (*load)(int frame);
+	int opt;				// percent of the budget the effect costs
+	int on_at_end;			// whether it has to run at the end, -1 either
+	int max_starts;
+} OptionalScenario;
+
+static int flat45(int f) { return 45; }
+
+// 40% up to 80% and back, with the effect it goes over the high mark
+static int swell(int f)
+{
+	if(f < 400) return 40;
+	if(f < 800) return 40 + (f - 400) * 40 / 400;
+	if(f < 1200) return 80;
+	return 40;
+}
+
+// 50% and 58% in turns of 30 frames, over the high mark half the time with it
+static int wobble(int f) { return (f / 30) & 1 ? 58 : 50; }
+
+static void runOptional(const OptionalScenario *o)
+{
+	const Scenario s = { o->name };
+	int f, on = 0, was_on, cost, avg, starts = 0, stop = -1000;
+	int opt_us = BUDGET * o->opt / 100;
+
+	governorInit(BUDGET);
+	for(f=0; f<2000; f++) {
+		cost = BUDGET * o->load(f) / 100 + (on ? opt_us : 0);
+		governorBeginFrame();
+		now += cost;
+		governorEndFrame();
+		now += BUDGET - (cost % BUDGET);
+
+		avg = governorCost();
+		was_on = on;
+		on = governorOptional(f >= WANT, opt_us);
+		if(on && !was_on) {
+			starts++;
+			if((avg + opt_us)*100 >= BUDGET*HIGH_PCT)
+				fail(&s, f, "started without room for its cost");
+			if(governorCost() != avg + opt_us)
+				fail(&s, f, "started without being charged");
+			if(f - stop < UP)
+				fail(&s, f, "started again too early");
+		}
+		if(!on && was_on)
+			stop = f;
+		if(governorLevel() != 0 && o->load(f)*100 < BUDGET*HIGH_PCT)
+			fail(&s, f, "level dropped for the optional effect");
+	}
+	if(o->on_at_end >= 0 && on != o->on_at_end)
+		fail(&s, f, on ? "still runs at the end" : "does not run at the end");
+	if(starts > o->max_starts)
+		fail(&s, f, "started too often");
+	printf("%-8s optional %2d%%: %d starts, %s at the end, level %d\n", o->name, o->opt,
+		   starts, on ? "runs" : "off", governorLevel());
+
+	// Not wanted anymore: the charge goes and nothing stays on
+	if(on) {
+		avg = governorCost();
+		if(governorOptional(0, opt_us) || governorCost() > avg - opt_us + 1)
+			fail(&s, f, "kept running or charged after it was not wanted");
+	}
+}
+
+/*****************************************************************************
+ * The moving average has to follow a step in load with weight 1/8           *
+ *****************************************************************************/
+static void checkAverage()
+{
+	static const Scenario s = { "average", 0, NULL, 0, 0, 0 };
+	u32 expect = 0;
+	int f;
+
+	governorInit(BUDGET);
+	for(f=0; f<64; f++) {
+		governorBeginFrame();
+		now += 8000;
+		governorEndFrame();
+		expect += 8000 - expect / 8;
+		if(governorCost() != expect / 8)
+			fail(&s, f, "moving average differs from 1/8 weighting");
+	}
+	if(governorCost() < 7900)
+		fail(&s, f, "moving average does not converge");
+}
+
+int main(int argc, char **argv)
+{
+	static const Scenario scenarios[] = {
+		{ "flat70",  2000, flat70, 0, 0, 0 },	// between the marks
+		{ "flat40",  2000, flat40, 0, 0, 0 },
+		{ "spikes",  2000, spikes, 0, 0, 0 },	// single missed frames
+		{ "ramp",    2400, ramp,   1, 0, 0 },	// back to full at the end
+		{ "heavy",   3000, heavy,  1, 1, 2 },	// has to settle
+	};
+	static const OptionalScenario optional[] = {
+		{ "fits",   flat45, 30, 1, 1 },	// 75% with it
+		{ "tight",  flat45, 45, 0, 0 },	// 90% with it, never starts
+		{ "swell",  swell,  30, 1, 2 },	// has to stop and come back
+		{ "wobble", wobble, 30, -1, 2000/UP + 1 },	// must not bounce
+	};
+	int c, i;
+
+	while((c = getopt(argc, argv, "v")) != -1) {
+		switch(c) {
+			case 'v': verbose = 1; break;
+			default: fprintf(stderr, "govtest: bad arguments\n"); return 2;
+		}
+	}
+
+	checkAverage();
+	for(i=0; i<(int)(sizeof(scenarios)/sizeof(scenarios[0])); i++)
+		run(&scenarios[i]);
+	for(i=0; i<(int)(sizeof(optional)/sizeof(optional[0])); i++)
+		runOptional(&optional[i]);
+	printf("governor: %s\n", failed ? "FAILED" : "ok");
+	return failed;
+}
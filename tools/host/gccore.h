@@ -0,0 +1,20 @@
+/*
+ * Minimal stand-in for libogc's gccore.h. Only the types, the thread calls
+ * and the cache flush are declared; the host tool that links a shared
+ * source using them defines them, the threads usually on top of pthreads.
+ */
+#ifndef __GCCORE_H__
+#define __GCCORE_H__
+
+#include <gctypes.h>
+
+typedef u32 lwp_t;
+#define LWP_THREAD_NULL 0xffffffff
+
+s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg,
+                     void *stackbase, u32 stack_size, u8 prio);
+s32 LWP_JoinThread(lwp_t thethread, void **value_ptr);
+
+void DCFlushRange(void *startaddress, u32 len);
+
+#endif
@@ -0,0 +1,19 @@
+/*
+ * Minimal stand-in for libogc's gctypes.h so that shared sources from
+ * source/ can be compiled into the host tools.
+ */
+#ifndef __GCTYPES_H__
+#define __GCTYPES_H__
+
+#include <stdint.h>
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t   s8;
+typedef int16_t  s16;
+typedef int32_t  s32;
+typedef int64_t  s64;
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * Minimal stand-in for libogc's lwp_watchdog.h. The host tool that links a
+ * shared source using the clock defines both functions, usually on top of
+ * a simulated clock it advances itself.
+ */
+#ifndef __LWP_WATCHDOG_H__
+#define __LWP_WATCHDOG_H__
+
+#include <gctypes.h>
+
+u64 gettime(void);
+u32 diff_usec(u64 start, u64 end);
+
+#endif
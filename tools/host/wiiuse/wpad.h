@@ -0,0 +1,29 @@
+/*
+ * Minimal stand-in for libogc's wiiuse/wpad.h: the report fields, status
+ * codes and the two calls the input thread makes. The host tool that links
+ * input.c defines WPAD_ReadPending() and WPAD_Probe() as a fake driver.
+ */
+#ifndef __WPAD_H__
+#define __WPAD_H__
+
+#include <gctypes.h>
+
+#define WPAD_MAX_WIIMOTES       4
+#define WPAD_CHAN_ALL           -1
+
+#define WPAD_ERR_NONE           0
+#define WPAD_ERR_NO_CONTROLLER  -1
+#define WPAD_ERR_NOT_READY      -2
+#define WPAD_ERR_TRANSFER       -3
+
+typedef struct {
+	s16 err;
+	u32 btns_h, btns_l, btns_d, btns_u;
+} WPADData;
+
+typedef void (*WPADDataCallback)(s32 chan, const WPADData *data);
+
+s32 WPAD_ReadPending(s32 chan, WPADDataCallback datacb);
+s32 WPAD_Probe(s32 chan, u32 *type);
+
+#endif
@@ -0,0 +1,261 @@
+/*****************************************************************************
+ * inputbench - Wiimote report latency of the input thread (source/input.h)  *
+ *                                                                           *
+ * usage: inputbench [-f frames] [-r report interval in us]                  *
+ *                                                                           *
+ * Runs input.c against a fake driver on a real clock. A driver thread makes *
+ * a report about every 10 ms like a Wiimote in IR mode, numbered in btns_h  *
+ * and with random presses in btns_d, and notes when it arrived. A game loop *
+ * on a 60 Hz clock does the work that needs no input first, then the        *
+ * simulation, then spins for a random part of the frame as if drawing. Each *
+ * run is done twice: reading the reports at VSync the way the game did      *
+ * before the input thread, and taking them from the thread right before the *
+ * simulation the way template.c does now. Reports the time from the arrival *
+ * of the newest report to the start of the simulation for both, with the    *
+ * asset and HUD work alone and with the trail fade added. Exits with 1 if   *
+ * the thread loses a press or reports are taken out of order.               *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+#include "input.h"
+
+#define FRAME_US   16667
+#define MAX_SEQ    (1<<16)		// reports remembered by the driver
+
+static pthread_t threads[4];
+static int num_threads = 0;
+
+static pthread_mutex_t drv_mutex = PTHREAD_MUTEX_INITIALIZER;
+static WPADData drv_pending[64];	// arrived, not yet read
+static int drv_count = 0;
+static u64 drv_arrival[MAX_SEQ];
+static u32 drv_btns_d[MAX_SEQ];
+static volatile u32 drv_seq = 0;
+static volatile int drv_running = 1;
+static int report_us = 10000;
+
+static u32 rng = 1, drv_rng = 2;	// one per thread
+
+static u32 rnd(u32 *state)
+{
+	*state ^= *state << 13; *state ^= *state >> 17; *state ^= *state << 5;
+	return *state;
+}
+
+u64 gettime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+u32 diff_usec(u64 start, u64 end)
+{
+	return end - start;
+}
+
+s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg,
+                     void *stackbase, u32 stack_size, u8 prio)
+{
+	if(num_threads == 4 || pthread_create(&threads[num_threads], NULL, entry, arg) != 0)
+		return -1;
+	*thethread = num_threads++;
+	return 0;
+}
+
+s32 LWP_JoinThread(lwp_t thethread, void **value_ptr)
+{
+	return pthread_join(threads[thethread], value_ptr);
+}
+
+/*****************************************************************************
+ * Fake driver: one Wiimote on channel 0                                     *
+ *****************************************************************************/
+s32 WPAD_ReadPending(s32 chan, WPADDataCallback datacb)
+{
+	WPADData reports[64];
+	int i, n;
+
+	pthread_mutex_lock(&drv_mutex);
+	n = drv_count;
+	memcpy(reports, drv_pending, n * sizeof(WPADData));
+	drv_count = 0;
+	pthread_mutex_unlock(&drv_mutex);
+
+	for(i=0; i<n; i++)
+		datacb(0, &reports[i]);
+	return n;
+}
+
+s32 WPAD_Probe(s32 chan, u32 *type)
+{
+	return (chan == 0) ? WPAD_ERR_NONE : WPAD_ERR_NO_CONTROLLER;
+}
+
+static void *driver(void *arg)
+{
+	WPADData d;
+	u64 next = gettime();
+	u32 seq;
+
+	// A quarter of jitter, so the reports drift against the frames
+	while(drv_running && drv_seq < MAX_SEQ-1) {
+		next += report_us - report_us/4 + rnd(&drv_rng) % (report_us/2);
+		while(gettime() < next)
+			usleep(100);
+
+		seq = drv_seq + 1;
+		memset(&d, 0, sizeof(d));
+		d.btns_h = seq;
+		d.btns_d = (rnd(&drv_rng) & 3) ? 0 : 1 << (rnd(&drv_rng) % 16);
+		drv_btns_d[seq] = d.btns_d;
+		drv_arrival[seq] = gettime();
+
+		pthread_mutex_lock(&drv_mutex);
+		if(drv_count < 64)
+			drv_pending[drv_count++] = d;
+		pthread_mutex_unlock(&drv_mutex);
+		drv_seq = seq;
+	}
+	return NULL;
+}
+
+/*****************************************************************************
+ * The read of the game loop before the input thread: WPAD_ReadPending() at  *
+ * the top of every frame, keeping the newest report                         *
+ *****************************************************************************/
+static WPADData top_data;
+static int top_count;
+
+static void topReport(s32 chan, const WPADData *data)
+{
+	top_data = *data;
+	top_count++;
+}
+
+/*****************************************************************************
+ * Runs num_frames frames: VSync, pre_us of work that needs no input, the    *
+ * simulation, then the rest of the frame. With late set the reports are     *
+ * taken from the input thread right before the simulation, otherwise they   *
+ * are read at VSync. Measures the time from the arrival of the newest       *
+ * report to the start of the simulation.                                    *
+ *****************************************************************************/
+static int run(int late, int pre_us, int num_frames)
+{
+	WPADData data;
+	u64 start, now, work, lat, lat_sum = 0, lat_max = 0;
+	u32 last = 0, expect, i;
+	int f, n, taken = 0, merged = 0, lost = 0, bad = 0;
+
+	// Drop what arrived during the last run
+	WPAD_ReadPending(WPAD_CHAN_ALL, topReport);
+	last = drv_seq;
+	if(late && inputStart() < 0) {
+		fprintf(stderr, "inputbench: cannot start the input thread\n");
+		exit(2);
+	}
+
+	start = gettime();
+	for(f=0; f<num_frames; f++) {
+		// VSync
+		while(gettime() < start + (u64)f * FRAME_US)
+			usleep(200);
+
+		if(!late) {
+			top_count = 0;
+			WPAD_ReadPending(WPAD_CHAN_ALL, topReport);
+			data = top_data;
+			n = top_count;
+		}
+		work = gettime() + pre_us;
+		while(gettime() < work);
+		if(late)
+			n = inputTake(0, &data);
+
+		// The simulation starts
+		now = gettime();
+		if(n > 0) {
+			if(data.btns_h <= last || data.btns_h >= MAX_SEQ) {
+				fprintf(stderr, "inputbench: frame %d took report %u after %u\n",
+						f, data.btns_h, last);
+				bad++;
+			}
+			else {
+				// Every press since the last frame has to be in the merged bits,
+				// unless the queue overflowed
+				for(i=last+1, expect=0; i<=data.btns_h; i++)
+					expect |= drv_btns_d[i];
+				if(late && (u32)n == data.btns_h - last && data.btns_d != expect) {
+					fprintf(stderr, "inputbench: frame %d lost presses %08x\n",
+							f, expect & ~data.btns_d);
+					bad++;
+				}
+				if((u32)n != data.btns_h - last)
+					lost += data.btns_h - last - n;
+				lat = now - drv_arrival[data.btns_h];
+				lat_sum += lat;
+				if(lat > lat_max)
+					lat_max = lat;
+				last = data.btns_h;
+			}
+			taken++;
+			merged += n;
+		}
+
+		// The rest of the frame's work
+		work = now + FRAME_US/8 + rnd(&rng) % (FRAME_US/2);
+		while(gettime() < work);
+	}
+	if(late)
+		inputStop();
+
+	printf("%-6s %5d us before the simulation: %4d reports in %3d frames, %2d overwritten,"
+		   " arrival to simulation average %5llu us, worst %5llu us\n",
+		   late ? "thread" : "top", pre_us, merged, taken, lost,
+		   (unsigned long long)(taken ? lat_sum / taken : 0), (unsigned long long)lat_max);
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	// The asset check and HUD text, then with the trail fade of a frame
+	static const int pre_us[] = { 300, 3000 };
+	pthread_t h_driver;
+	int c, k, bad = 0, num_frames = 120;
+
+	while((c = getopt(argc, argv, "f:r:")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			case 'r': report_us = atoi(optarg); break;
+			default: fprintf(stderr, "inputbench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 1)
+		num_frames = 1;
+	if(report_us < 100)
+		report_us = 100;
+
+	if(pthread_create(&h_driver, NULL, driver, NULL) != 0) {
+		fprintf(stderr, "inputbench: cannot start threads\n");
+		return 2;
+	}
+
+	printf("%d frames per run, a report every %d us, frames of %d us\n", num_frames,
+		   report_us, FRAME_US);
+	for(k=0; k<(int)(sizeof(pre_us)/sizeof(pre_us[0])); k++) {
+		bad += run(0, pre_us[k], num_frames);
+		bad += run(1, pre_us[k], num_frames);
+	}
+	printf("inputAge() %u us\n", inputAge());
+
+	drv_running = 0;
+	pthread_join(h_driver, NULL);
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,166 @@
+/*****************************************************************************
+ * intercepttest - closed form intercepts against stepping (source/sim.h)    *
+ *                                                                           *
+ * usage: intercepttest [-b balls] [-v max speed]                            *
+ *                                                                           *
+ * Spawns b random balls (4096 by default) in a four player match and asks   *
+ * simIntercept() where each of them reaches every token heading for it.     *
+ * Each prediction is checked by stepping the ball alone through             *
+ * collideStep() until the predicted frame: the ball has to start that frame *
+ * at the predicted position and reach the token's face during it. Runs at   *
+ * the game's top speed and at -v pixels per frame (40 by default), then in  *
+ * playfields flatter than that speed, where balls bounce several times a    *
+ * frame between the borders along the token's path, down to more bounces    *
+ * than collideStep() follows as contacts. Reports the time per ball of      *
+ * simIntercept(), of the simAutoSteer() pass and of stepping.               *
+ * Exits with 1 if a prediction differs in frame or position.                *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sim.h"
+
+#define FB_WIDTH  640
+#define FB_HEIGHT 480
+#define PLAYERS   4
+
+static volatile int sink;	// keeps the timed loops from being dropped
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Distance to the token's face along the approach, like approach() of sim.c
+static int distance(int player, const Particle *t, const Particle *p)
+{
+	switch(player) {
+		case 0:  return p->pos_x - (t->pos_x + t->size_x);
+		case 1:  return t->pos_x - (p->pos_x + p->size_x);
+		case 2:  return p->pos_y - (t->pos_y + t->size_y);
+		default: return t->pos_y - (p->pos_y + p->size_y);
+	}
+}
+
+static int speedTo(int player, const Particle *p)
+{
+	switch(player) {
+		case 0:  return -p->dx;
+		case 1:  return p->dx;
+		case 2:  return -p->dy;
+		default: return p->dy;
+	}
+}
+
+/*****************************************************************************
+ * Steps a copy of ball i with the borders only, the way the prediction      *
+ * sees it. Returns 1 if it starts frame n at pos and reaches the face then. *
+ *****************************************************************************/
+static int stepped(Sim *sim, int player, int i, int n, int pos)
+{
+	const Particle *t = simToken(sim, player);
+	Particle b = sim->entities.items[i];
+	u8 type = ENTITY_BALL, hit;
+	int f, d;
+
+	for(f=1; f<n; f++)
+		collideStep(&b, &type, 1, 1, NULL, 0, &sim->bounds, &hit);
+	d = distance(player, t, &b);
+	if((player < 2 ? b.pos_y : b.pos_x) != pos)
+		return 0;
+	return d >= 0 && d <= speedTo(player, &b);
+}
+
+static void run(const char *name, SimParams *params, int num_balls, int *bad)
+{
+	Sim sim;
+	double t_predict, t_steer, t_step;
+	long checked = 0, wrong = 0;
+	int i, k, pos, frames;
+
+	if(simInit(&sim, params, FB_WIDTH, FB_HEIGHT, num_balls + PLAYERS, PLAYERS, 1) < 0) {
+		fprintf(stderr, "intercepttest: out of memory\n");
+		exit(2);
+	}
+	simSpawnBalls(&sim, num_balls);
+
+	t_step = cpuSeconds();
+	for(i=0; i<sim.entities.count; i++) {
+		if(sim.entities.types[i] != ENTITY_BALL)
+			continue;
+		for(k=0; k<PLAYERS; k++) {
+			pos = simIntercept(&sim, k, &sim.entities.items[i], &frames);
+			if(pos < 0)
+				continue;
+			checked++;
+			if(!stepped(&sim, k, i, frames, pos)) {
+				if(wrong++ < 5)
+					fprintf(stderr, "intercepttest: %s: ball %d to player %d predicted at %d in"
+							" frame %d\n", name, i, k, pos, frames);
+			}
+		}
+	}
+	t_step = cpuSeconds() - t_step;
+
+	t_predict = cpuSeconds();
+	for(i=0; i<sim.entities.count; i++)
+		for(k=0; k<PLAYERS; k++)
+			sink += simIntercept(&sim, k, &sim.entities.items[i], &frames);
+	t_predict = cpuSeconds() - t_predict;
+
+	t_steer = cpuSeconds();
+	for(k=0; k<PLAYERS; k++)
+		simAutoSteer(&sim, k, num_balls, 6);
+	t_steer = cpuSeconds() - t_steer;
+
+	printf("%-22s %6ld checked, %4ld wrong; ns per ball: intercept %5.1f, steer pass %5.1f,"
+		   " stepping %7.1f\n", name, checked, wrong,
+		   t_predict * 1e9 / (sim.entities.count * PLAYERS),
+		   t_steer * 1e9 / (num_balls * PLAYERS),
+		   t_step * 1e9 / (num_balls * PLAYERS));
+	*bad += wrong;
+	simFree(&sim);
+}
+
+int main(int argc, char **argv)
+{
+	SimParams params;
+	char name[64];
+	int c, bad = 0, num_balls = 4096, max_speed = 40;
+
+	while((c = getopt(argc, argv, "b:v:")) != -1) {
+		switch(c) {
+			case 'b': num_balls = atoi(optarg); break;
+			case 'v': max_speed = atoi(optarg); break;
+			default: fprintf(stderr, "intercepttest: bad arguments\n"); return 2;
+		}
+	}
+	if(num_balls < 1)
+		num_balls = 1;
+
+	simDefaults(&params);
+	snprintf(name, sizeof(name), "up to %d px/frame", params.ball_max_speed);
+	run(name, &params, num_balls, &bad);
+
+	params.ball_max_speed = max_speed;
+	snprintf(name, sizeof(name), "up to %d px/frame", max_speed);
+	run(name, &params, num_balls, &bad);
+
+	// 24 lines of playfield, less than the speed: several bounces a frame
+	params.margin_top = 45;
+	params.margin_bottom = 50;
+	params.ball_max_height = 4;
+	snprintf(name, sizeof(name), "%d px/frame, 24 lines", max_speed);
+	run(name, &params, num_balls, &bad);
+
+	// 5 lines: more bounces than COLLIDE_MAX_CONTACTS, left to mirror()
+	params.margin_top = 49;
+	snprintf(name, sizeof(name), "%d px/frame, 5 lines", max_speed);
+	run(name, &params, num_balls, &bad);
+
+	return bad ? 1 : 0;
+}
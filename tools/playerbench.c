@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * playerbench - frame cost with one to four players (source/sim.h)          *
+ *                                                                           *
+ * usage: playerbench [-f frames]                                            *
+ *                                                                           *
+ * Runs the game's per-frame simulation work (simAutoSteer() for every CPU   *
+ * player, then one simStep() sweeping all balls against all tokens) with    *
+ * one, two, three and four players and a growing number of balls, and       *
+ * reports the time per frame and the cost of four players relative to one.  *
+ * All tokens go through the single collideStep() pass; the extra players    *
+ * only add paddles to the inner loop and intercepts to steer. Exits with 1  *
+ * if a ball ends up outside the playfield.                                  *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sim.h"
+
+#define CAPACITY  4096			// MAX_ENTITIES of template.c
+#define CPU_SPEED 6				// CPU_TOKEN_SPEED of template.c
+#define BUDGET_US 16667
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int check(Sim *sim)
+{
+	const EntityPool *pool = &sim->entities;
+	const CollideBounds *f = &sim->bounds;
+	const Particle *p;
+	int i, bad = 0;
+
+	for(i=0; i<pool->count; i++) {
+		if(pool->types[i] != ENTITY_BALL)
+			continue;
+		p = &pool->items[i];
+		if(p->pos_x < f->l || p->pos_x + p->size_x > f->r ||
+		   p->pos_y < f->t || p->pos_y + p->size_y > f->b)
+			bad++;
+	}
+	return bad;
+}
+
+static double run(int players, int balls, int num_frames, int *bad)
+{
+	SimParams params;
+	Sim sim;
+	u8 *hits = malloc(CAPACITY);
+	double t;
+	int f, k;
+
+	simDefaults(&params);
+	if(!hits || simInit(&sim, &params, 640, 480, CAPACITY, players, 1) < 0) {
+		fprintf(stderr, "playerbench: out of memory\n");
+		exit(2);
+	}
+	simSpawnBalls(&sim, balls);
+
+	t = cpuSeconds();
+	for(f=0; f<num_frames; f++) {
+		for(k=0; k<players; k++)
+			simAutoSteer(&sim, k, balls, CPU_SPEED);
+		simStep(&sim, balls, hits);
+	}
+	t = (cpuSeconds() - t) / num_frames;
+	*bad += check(&sim);
+
+	simFree(&sim);
+	free(hits);
+	return t;
+}
+
+int main(int argc, char **argv)
+{
+	static const int balls[] = { 1, 100, 1000, 4000 };
+	double t[4];
+	int c, i, k, bad = 0, num_frames = 600;
+
+	while((c = getopt(argc, argv, "f:")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			default: fprintf(stderr, "playerbench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 1)
+		num_frames = 1;
+
+	printf("%d frames, us per frame   1 player  2 players  3 players  4 players   4 vs 1\n",
+		   num_frames);
+	for(i=0; i<(int)(sizeof(balls)/sizeof(balls[0])); i++) {
+		for(k=0; k<4; k++)
+			t[k] = run(k+1, balls[i], num_frames, &bad);
+		printf("%5d balls %16.2f %10.2f %10.2f %10.2f %7.2fx (%4.1f%% of a frame)\n",
+			   balls[i], t[0] * 1e6, t[1] * 1e6, t[2] * 1e6, t[3] * 1e6, t[3] / t[0],
+			   t[3] * 1e6 * 100 / BUDGET_US);
+	}
+	if(bad)
+		fprintf(stderr, "playerbench: %d balls outside the playfield\n", bad);
+	return bad ? 1 : 0;
+}
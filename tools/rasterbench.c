@@ -0,0 +1,417 @@
+/*****************************************************************************
+ * rasterbench - tests and benchmarks the raster kernels (source/raster.h)   *
+ *                                                                           *
+ * usage: rasterbench [-f frames]                                            *
+ *                                                                           *
+ * Renders every primitive of every kernel set (the stride-specialized ones  *
+ * and the generic one) at many sizes and positions, including ones that     *
+ * are partly or completely off screen, into a RAM framebuffer for each      *
+ * video mode size libogc uses: the kernels and the lines, boxes, ellipses   *
+ * and IR dots drawn with them, ellipses also centered off screen and with   *
+ * radii far beyond it. Each result is compared with a per-pixel reference   *
+ * that clips one pixel at a time, and the guard words around the           *
+ * framebuffer must stay untouched. The reference renderer stands in for     *
+ * stored golden images, which would be needed for every mode size. Then     *
+ * every kernel of every set is timed in pixels per second.                  *
+ *                                                                           *
+ * The tile rasterizers of tiles.c are run on the same queue of particles    *
+ * with each stride-specialized variant and the generic one, compared and    *
+ * timed. Exits with 1 on any difference.                                    *
+ *                                                                           *
+ * raster.c and tiles.c are included rather than linked so that all          *
+ * variants can be called directly, not only the ones the init functions     *
+ * pick.                                                                     *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "raster.c"
+#include "tiles.c"
+
+#define MAX_WIDTH  720
+#define MAX_HEIGHT 576
+#define GUARD      1024			// u32 words before and after the framebuffer
+#define GUARD_WORD 0xdeadbeef
+
+typedef struct {
+	const char *name;
+	const RasterKernels *k;
+	int width;					// 0 for the generic set, which takes any width
+} Variant;
+
+static const Variant variants[] = {
+	{ "640",     &kernels_640,     640 },
+	{ "704",     &kernels_704,     704 },
+	{ "720",     &kernels_720,     720 },
+	{ "generic", &kernels_generic, 0 },
+};
+#define NUM_VARIANTS (int)(sizeof(variants)/sizeof(variants[0]))
+
+// fbWidth x xfbHeight combinations of the libogc GXRModeObj tables
+static const int modes[][2] = {
+	{ 640, 480 }, { 640, 528 }, { 640, 574 }, { 640, 576 },
+	{ 704, 480 }, { 704, 576 }, { 720, 480 }, { 720, 574 },
+};
+#define NUM_MODES (int)(sizeof(modes)/sizeof(modes[0]))
+
+static u32 rng = 1;
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*****************************************************************************
+ * Reference: every primitive is a set of pixels, each clipped on its own    *
+ *****************************************************************************/
+static void refPixel(u32 *fb, int w, int h, int x, int y, u32 color)
+{
+	if(x >= 0 && x < w && y >= 0 && y < h)
+		fb[y*(w>>1) + (x>>1)] = color;
+}
+
+static void refFill(u32 *fb, int w, int h, int x1, int y1, int x2, int y2, u32 color)
+{
+	int x, y;
+
+	// Only the part that can be on screen, so huge coordinates stay cheap
+	if(x1 < -1) x1 = -1;
+	if(y1 < -1) y1 = -1;
+	if(x2 > w) x2 = w;
+	if(y2 > h) y2 = h;
+	for(y=y1; y<=y2; y++)
+		for(x=x1; x<=x2; x++)
+			refPixel(fb, w, h, x, y, color);
+}
+
+// Bresenham's line, pixel by pixel, without skipping anything off screen
+static void refLine(u32 *fb, int w, int h, int x0, int y0, int x1, int y1, u32 color)
+{
+	int dx =  abs(x1-x0), sx = x0<x1 ? 1 : -1;
+	int dy = -abs(y1-y0), sy = y0<y1 ? 1 : -1;
+	int err = dx+dy, e2;
+
+	for(;;) {
+		refPixel(fb, w, h, x0, y0, color);
+		if(x0 == x1 && y0 == y1)
+			break;
+		e2 = 2*err;
+		if(e2 > dy) { err += dy; x0 += sx; }
+		if(e2 < dx) { err += dx; y0 += sy; }
+	}
+}
+
+// The midpoint ellipse of drawEllipse(), walked all around in 64 bits
+static void refEllipse(u32 *fb, int w, int h, int xm, int ym, int a, int b, u32 color)
+{
+	long long a2 = (long long)a*a, b2 = (long long)b*b;
+	long long err = b2-(2LL*b-1)*a2, e2;
+	int dx = 0, dy = b;
+
+	if(a < 0 || b < 0)
+		return;
+	if(a == 0 && b == 0) {
+		refPixel(fb, w, h, xm, ym, color);
+		return;
+	}
+	do {
+		refPixel(fb, w, h, xm+dx, ym+dy, color);
+		refPixel(fb, w, h, xm-dx, ym+dy, color);
+		refPixel(fb, w, h, xm-dx, ym-dy, color);
+		refPixel(fb, w, h, xm+dx, ym-dy, color);
+		e2 = 2*err;
+		if(e2 <  (2LL*dx+1)*b2) { dx++; err += (2LL*dx+1)*b2; }
+		if(e2 > -(2LL*dy-1)*a2) { dy--; err -= (2LL*dy-1)*a2; }
+	} while(dy >= 0);
+	while(dx++ < a) {
+		refPixel(fb, w, h, xm+dx, ym, color);
+		refPixel(fb, w, h, xm-dx, ym, color);
+	}
+}
+
+// The dot of the old drawdot(): 5 pixel pairs by 9 lines around the scaled
+// position, each pair clipped
+static void refDot(u32 *fb, int w, int h, float sw, float sh, float fx, float fy, u32 color)
+{
+	float x = fx * w / sw / 2, y = fy * h / sh;
+	int px, py;
+
+	if(!(x > -8 && x < w && y > -8 && y < h + 8))
+		return;
+	for(py=(int)y-4; py<=(int)y+4; py++)
+		for(px=(int)x-2; px<=(int)x+2; px++)
+			if(py >= 0 && py < h && px >= 0 && px < w/2)
+				fb[py*(w>>1) + px] = color;
+}
+
+/*****************************************************************************
+ * Coordinates around one edge of the screen: far outside, just outside, on  *
+ * it and just inside, odd and even                                          *
+ *****************************************************************************/
+static int edgeCoord(int size)
+{
+	static const int near[] = { -100000, -65, -2, -1, 0, 1, 2, 3 };
+	int i = rnd() % 20;
+
+	if(i < 8)
+		return near[i];
+	if(i < 16)
+		return size - 1 - near[i-8];
+	return (int)(rnd() % (size + 64)) - 32;
+}
+
+static int checkGuards(const u32 *buf, int words)
+{
+	int i;
+
+	for(i=0; i<GUARD; i++)
+		if(buf[i] != GUARD_WORD || buf[GUARD+words+i] != GUARD_WORD)
+			return 0;
+	return 1;
+}
+
+// Radii of the ellipses: dots, the sizes drawn, beyond the screen and one
+// whose terms overflow 32 bits
+static int radius()
+{
+	static const int r[] = { 0, 1, 2, 3, 10, 37, 300, 1000 };
+	int i = rnd() % 64;
+
+	return i < 63 ? r[i & 7] : 40000;
+}
+
+// Dot positions in the IR camera's 1024x768: on and around the screen and
+// far out, where the conversion to int would overflow
+static float dotCoord(float size)
+{
+	static const float far[] = { -1e12f, -3000.0f, 5000.0f, 1e12f };
+	int i = rnd() % 16;
+
+	if(i < 4)
+		return far[i];
+	return ((int)(rnd() % 2048) - 512) * size / 1024 + (rnd() % 4) * 0.3f;
+}
+
+static int testVariant(const Variant *v, int w, int h, u32 *a, u32 *b)
+{
+	u32 *fa = a + GUARD, *fb = b + GUARD, color;
+	int words = (w>>1) * h, i, x1, y1, x2, y2, ra, rb, kind, bad = 0;
+	float fx, fy;
+
+	// The composite primitives draw through g_raster
+	g_raster = *v->k;
+
+	for(i=0; i<GUARD*2+words; i++)
+		a[i] = b[i] = GUARD_WORD;
+	memset(fa, 0, words * sizeof(u32));
+	memset(fb, 0, words * sizeof(u32));
+
+	for(i=0; i<6000; i++) {
+		x1 = edgeCoord(w);
+		y1 = edgeCoord(h);
+		// Sizes from one pixel up to more than the screen
+		x2 = (rnd() & 1) ? x1 + (int)(rnd() % 8) : edgeCoord(w);
+		y2 = (rnd() & 1) ? y1 + (int)(rnd() % 8) : edgeCoord(h);
+		color = rnd();
+		kind = i & 7;
+		switch(kind) {
+			case 0:
+				v->k->pixel(fa, x1, y1, color);
+				refPixel(fb, w, h, x1, y1, color);
+				break;
+			case 1:
+				v->k->hline(fa, x1, x2, y1, color);
+				refFill(fb, w, h, x1, y1, x2, y1, color);
+				break;
+			case 2:
+				v->k->vline(fa, x1, y1, y2, color);
+				refFill(fb, w, h, x1, y1, x1, y2, color);
+				break;
+			case 3:
+				v->k->fill(fa, x1, y1, x2, y2, color);
+				refFill(fb, w, h, x1, y1, x2, y2, color);
+				break;
+			case 4:
+				rasterLine(fa, x1, y1, x2, y2, color);
+				refLine(fb, w, h, x1, y1, x2, y2, color);
+				break;
+			case 5:
+				rasterBox(fa, x1, y1, x2, y2, color);
+				refFill(fb, w, h, x1, y1, x2, y1, color);
+				refFill(fb, w, h, x1, y2, x2, y2, color);
+				refFill(fb, w, h, x1, y1, x1, y2, color);
+				refFill(fb, w, h, x2, y1, x2, y2, color);
+				break;
+			case 6:
+				ra = radius();
+				rb = (rnd() & 1) ? ra : radius();
+				x2 = ra;
+				y2 = rb;
+				rasterEllipse(fa, x1, y1, ra, rb, color);
+				refEllipse(fb, w, h, x1, y1, ra, rb, color);
+				break;
+			case 7:
+				fx = dotCoord(1024);
+				fy = dotCoord(768);
+				x1 = fx;
+				y1 = fy;
+				x2 = y2 = 0;
+				rasterDot(fa, 1024, 768, fx, fy, color);
+				refDot(fb, w, h, 1024, 768, fx, fy, color);
+				break;
+		}
+		if(memcmp(a, b, (GUARD*2+words) * sizeof(u32)) != 0 || !checkGuards(a, words)) {
+			fprintf(stderr, "rasterbench: %s kernels at %dx%d differ for primitive %d"
+					" (%d,%d)-(%d,%d)\n", v->name, w, h, kind, x1, y1, x2, y2);
+			memcpy(a, b, (GUARD*2+words) * sizeof(u32));
+			bad++;
+		}
+	}
+	return bad;
+}
+
+/*****************************************************************************
+ * Benchmark, the same primitives the game draws: full lines of the field,   *
+ * particle sized rectangles and single pixels                               *
+ *****************************************************************************/
+static void benchVariant(const Variant *v, int w, int h, u32 *fb, int num_frames)
+{
+	double t[4], pixels[4] = { 0 };
+	int f, i, x, y;
+
+	t[0] = cpuSeconds();
+	for(f=0; f<num_frames; f++)
+		for(i=0; i<20000; i++)
+			v->k->pixel(fb, rnd() % w, rnd() % h, i);
+	t[0] = cpuSeconds() - t[0];
+	pixels[0] = 20000.0 * num_frames;
+
+	t[1] = cpuSeconds();
+	for(f=0; f<num_frames; f++)
+		for(y=0; y<h; y++)
+			v->k->hline(fb, 0, w-1, y, f);
+	t[1] = cpuSeconds() - t[1];
+	pixels[1] = (double)w * h * num_frames;
+
+	t[2] = cpuSeconds();
+	for(f=0; f<num_frames; f++)
+		for(x=0; x<w; x+=2)
+			v->k->vline(fb, x, 0, h-1, f);
+	t[2] = cpuSeconds() - t[2];
+	pixels[2] = (double)w/2 * h * num_frames;
+
+	t[3] = cpuSeconds();
+	for(f=0; f<num_frames; f++)
+		for(y=0; y+8<=h; y+=4)
+			for(x=0; x+8<=w; x+=8)
+				v->k->fill(fb, x, y, x+7, y+7, f);
+	t[3] = cpuSeconds() - t[3];
+	pixels[3] = (double)(w/8) * ((h-8)/4+1) * 64 * num_frames;
+
+	printf("%-8s %4dx%-4d %10.1f %10.1f %10.1f %10.1f\n", v->name, w, h,
+		   pixels[0] / t[0] * 1e-6, pixels[1] / t[1] * 1e-6,
+		   pixels[2] / t[2] * 1e-6, pixels[3] / t[3] * 1e-6);
+}
+
+/*****************************************************************************
+ * Tile rasterizers: particles the size drawParticles() queues, plus the     *
+ * rectangles of the tokens                                                  *
+ *****************************************************************************/
+typedef void (*TileFn)(u32 *fb, int t);
+
+static double runTiles(TileFn fn, u32 *fb, int w, int h, int num_frames)
+{
+	double t;
+	int f, i;
+
+	memset(fb, 0, (w>>1) * h * sizeof(u32));
+	t = cpuSeconds();
+	for(f=0; f<num_frames; f++)
+		for(i=0; i<tile_cols*tile_rows; i++)
+			if(tile_start[i] != tile_start[i+1])
+				fn(fb, i);
+	return (cpuSeconds() - t) / num_frames;
+}
+
+static int benchTiles(TileFn fn, const char *name, int w, int h, u32 *a, u32 *b, int num_frames)
+{
+	double t_spec, t_gen;
+	int i, bad;
+
+	tilesInit(w, h);
+	for(i=0; i<TILE_MAX_RECTS-8; i++)
+		tilesAddEllipse(rnd() % w, rnd() % h, 1 + rnd() % 10, 1 + rnd() % 10, rnd());
+	for(i=0; i<8; i++)
+		tilesAddRect(rnd() % w, rnd() % h, rnd() % w, rnd() % h, rnd());
+	tilesBin();
+
+	t_spec = runTiles(fn, a, w, h, num_frames);
+	t_gen = runTiles(rasterizeTile_generic, b, w, h, num_frames);
+	bad = memcmp(a, b, (w>>1) * h * sizeof(u32)) != 0;
+	printf("%-8s %4dx%-4d %8.3f ms %8.3f ms %7.2fx  %s\n", name, w, h,
+		   t_spec * 1e3, t_gen * 1e3, t_gen / t_spec, bad ? "MISMATCH" : "identical");
+	tilesBegin();
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	u32 *a, *b;
+	int c, i, m, w, h, bad = 0, num_frames = 20;
+
+	while((c = getopt(argc, argv, "f:")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			default: fprintf(stderr, "rasterbench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 1)
+		num_frames = 1;
+
+	a = malloc((GUARD*2 + MAX_WIDTH/2*MAX_HEIGHT) * sizeof(u32));
+	b = malloc((GUARD*2 + MAX_WIDTH/2*MAX_HEIGHT) * sizeof(u32));
+	if(!a || !b)
+		return 2;
+
+	// Every set at every height of its width, the generic one at all sizes
+	// and at a width no mode uses
+	for(m=0; m<NUM_MODES; m++) {
+		w = modes[m][0];
+		h = modes[m][1];
+		rasterInit(w, h);
+		for(i=0; i<NUM_VARIANTS; i++)
+			if(variants[i].width == w || variants[i].width == 0)
+				bad += testVariant(&variants[i], w, h, a, b);
+	}
+	rasterInit(600, 400);
+	bad += testVariant(&variants[NUM_VARIANTS-1], 600, 400, a, b);
+	printf("kernels vs per-pixel reference: %s\n", bad ? "MISMATCH" : "identical");
+
+	printf("Mpixels/s         pixel      hline      vline       fill\n");
+	for(i=0; i<NUM_VARIANTS; i++) {
+		w = variants[i].width ? variants[i].width : 640;
+		h = 480;
+		rasterInit(w, h);
+		benchVariant(&variants[i], w, h, a + GUARD, num_frames);
+	}
+
+	printf("tiles, %d primitives  specialized    generic  speedup\n", TILE_MAX_RECTS);
+	bad += benchTiles(rasterizeTile_640, "640", 640, 480, a, b, num_frames);
+	bad += benchTiles(rasterizeTile_704, "704", 704, 480, a, b, num_frames);
+	bad += benchTiles(rasterizeTile_720, "720", 720, 574, a, b, num_frames);
+
+	free(a);
+	free(b);
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,164 @@
+/*****************************************************************************
+ * resamplebench - quality and cost of the resampler (source/resampler.h)    *
+ *                                                                           *
+ * usage: resamplebench [-s seconds]                                         *
+ *                                                                           *
+ * Converts sines at the rates Ogg streams come in to 48 kHz with every      *
+ * quality and reports THD+N: the power left after removing the best         *
+ * fitting sine at the output, relative to that sine. A 30 kHz tone at       *
+ * 96 kHz lies above the output Nyquist frequency and has to be filtered     *
+ * out; its residual, relative to the input tone, shows the aliasing.        *
+ * Also reports the CPU time one second of 44.1 kHz stereo music costs.      *
+ * Exits with 1 if a result is worse than the limit it is listed with.       *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#include "resampler.h"
+
+#define AMPLITUDE 16000
+#define IN_MAX    (96000 / 4)	// input frames of a quarter second
+#define OUT_MAX   (RESAMPLE_OUT_RATE / 4 + 64)
+#define CHUNK     1024			// frames per resamplerRun(), MAX_PCMOUT of oggplayer.c
+
+typedef struct {
+	int rate;
+	int hz;
+	double limit[3];	// dB for FAST, GOOD and BEST
+} Case;
+
+// The 10 kHz tones are limited by the 512 phase table, 22.05 kHz by imaging
+// with the short filters
+static const Case cases[] = {
+	{ 44100,  1000, { -58, -72, -75 } },
+	{ 44100, 10000, { -56, -58, -58 } },
+	{ 22050,  1000, { -54, -70, -70 } },
+	{ 22050, 10000, { -12, -20, -50 } },
+	{ 32000,  5000, { -52, -62, -62 } },
+	{ 96000, 30000, { -15, -24, -65 } },	// aliasing
+};
+
+static volatile int sink;	// keeps the timed loops from being dropped
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int resample(Resampler *r, const s16 *in, int in_frames, s16 *out)
+{
+	int i, n, written = 0;
+
+	for(i=0; i<in_frames; i+=n) {
+		n = (in_frames - i < CHUNK) ? in_frames - i : CHUNK;
+		written += resamplerRun(r, in + 2*i, n, 2, out + 2*written);
+	}
+	return written;
+}
+
+/*****************************************************************************
+ * Residual after a least squares fit of a sine at hz to the left channel,   *
+ * in dB relative to ref or, if ref is 0, to the fitted sine                 *
+ *****************************************************************************/
+static double residual(const s16 *out, int first, int n, int hz, double ref)
+{
+	double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0, a, b, det, s, c, e, fit = 0, rest = 0;
+	int i;
+
+	if(hz < RESAMPLE_OUT_RATE / 2) {
+		for(i=first; i<first+n; i++) {
+			s = sin(2 * M_PI * hz * i / RESAMPLE_OUT_RATE);
+			c = cos(2 * M_PI * hz * i / RESAMPLE_OUT_RATE);
+			ss += s*s; sc += s*c; cc += c*c;
+			ys += out[2*i] * s; yc += out[2*i] * c;
+		}
+		det = ss * cc - sc * sc;
+		a = (ys * cc - yc * sc) / det;
+		b = (yc * ss - ys * sc) / det;
+	}
+	else
+		a = b = 0;		// nothing of the tone may pass
+
+	for(i=first; i<first+n; i++) {
+		s = a * sin(2 * M_PI * hz * i / RESAMPLE_OUT_RATE) +
+			b * cos(2 * M_PI * hz * i / RESAMPLE_OUT_RATE);
+		e = out[2*i] - s;
+		fit += s * s;
+		rest += e * e;
+	}
+	if(ref == 0)
+		ref = fit;
+	return 10 * log10((rest > 0 ? rest : 1) / ref);
+}
+
+int main(int argc, char **argv)
+{
+	static const char *names[] = { "FAST", "GOOD", "BEST" };
+	static s16 in[IN_MAX * 2], out[OUT_MAX * 2];
+	Resampler *r = malloc(sizeof(Resampler));
+	double db, t, ref;
+	int c, i, k, q, n, bad = 0, seconds = 4;
+
+	while((c = getopt(argc, argv, "s:")) != -1) {
+		switch(c) {
+			case 's': seconds = atoi(optarg); break;
+			default: fprintf(stderr, "resamplebench: bad arguments\n"); return 2;
+		}
+	}
+	if(seconds < 1)
+		seconds = 1;
+	if(!r) {
+		fprintf(stderr, "resamplebench: out of memory\n");
+		return 2;
+	}
+
+	printf("THD+N in dB (limit)   ");
+	for(q=RESAMPLE_FAST; q<=RESAMPLE_BEST; q++)
+		printf("%14s", names[q]);
+	printf("\n");
+	for(k=0; k<(int)(sizeof(cases)/sizeof(cases[0])); k++) {
+		n = cases[k].rate / 4;
+		for(i=0; i<n; i++)
+			in[2*i] = in[2*i+1] = (s16)(AMPLITUDE * sin(2 * M_PI * cases[k].hz * i / cases[k].rate));
+		// Power of the tone as it went in, per output frame
+		ref = (double)AMPLITUDE * AMPLITUDE / 2 * (RESAMPLE_OUT_RATE / 8);
+
+		printf("%5d Hz at %6d Hz ", cases[k].hz, cases[k].rate);
+		for(q=RESAMPLE_FAST; q<=RESAMPLE_BEST; q++) {
+			resamplerInit(r, q, cases[k].rate);
+			resample(r, in, n, out);
+			// Skip the filter's latency, then measure an eighth of a second
+			db = residual(out, RESAMPLE_OUT_RATE / 16, RESAMPLE_OUT_RATE / 8, cases[k].hz,
+						  cases[k].hz < RESAMPLE_OUT_RATE / 2 ? 0 : ref);
+			printf("%7.1f (%4.0f)", db, cases[k].limit[q]);
+			if(db > cases[k].limit[q])
+				bad++;
+		}
+		printf("\n");
+	}
+
+	// Cost: stereo music at 44.1 kHz, as most Ogg files are
+	for(i=0; i<IN_MAX; i++)
+		in[2*i] = in[2*i+1] = (s16)(AMPLITUDE * sin(i * 0.05) * sin(i * 0.0007));
+	n = 44100 / 4;
+	printf("us per second of 44.1 kHz stereo");
+	for(q=RESAMPLE_FAST; q<=RESAMPLE_BEST; q++) {
+		resamplerInit(r, q, 44100);
+		t = cpuSeconds();
+		for(i=0; i<seconds*4; i++)
+			sink += resample(r, in, n, out);
+		t = (cpuSeconds() - t) / seconds;
+		printf("  %s %.0f", names[q], t * 1e6);
+	}
+	printf("\n");
+
+	if(bad)
+		fprintf(stderr, "resamplebench: %d results over their limit\n", bad);
+	free(r);
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+/*****************************************************************************
+ * snapbench - cost of the rewind snapshots (source/snapshot.h)              *
+ *                                                                           *
+ * usage: snapbench [-f frames]                                              *
+ *                                                                           *
+ * Runs the game simulation with a hundred up to 4000 balls in a pool of the *
+ * game's capacity and with 10000 in a larger one, the number of balls going *
+ * up and down, and takes a snapshot after every frame. The pool is          *
+ * registered once as a whole, the way it used to be, and once the way       *
+ * template.c does it, with only the live entities counted. Reports the time *
+ * per snapshot and per rewound frame and the delta size, which grow with    *
+ * the live balls since every moving ball changes. The state after rewinding *
+ * has to match a copy taken on the way; exits with 1 if it does not.        *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "sim.h"
+#include "snapshot.h"
+
+#define CAPACITY   4096			// MAX_ENTITIES of template.c
+#define RING_WORDS (32*1024*1024)	// holds the whole run
+#define BUDGET_US  16667
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int registerPool(Sim *sim, int live)
+{
+	EntityPool *pool = &sim->entities;
+	SnapshotRegion whole[] = {
+		{ pool->arena,        pool->arena_size },
+		{ &pool->count,       sizeof(pool->count) },
+		{ &pool->free_head,   sizeof(pool->free_head) },
+		{ sim->token,         sizeof(sim->token) },
+		{ &sim->rng,          sizeof(sim->rng) },
+	};
+	SnapshotRegion counted[] = {
+		{ pool->items,        pool->capacity * sizeof(Particle), &pool->count, sizeof(Particle) },
+		{ pool->types,        (pool->capacity + 3) & ~3,         &pool->count, 1 },
+		{ pool->owner,        pool->capacity * sizeof(u16),      &pool->count, sizeof(u16) },
+		{ pool->dense,        3 * pool->capacity * sizeof(u16) },
+		{ &pool->count,       sizeof(pool->count) },
+		{ &pool->free_head,   sizeof(pool->free_head) },
+		{ sim->token,         sizeof(sim->token) },
+		{ &sim->rng,          sizeof(sim->rng) },
+	};
+
+	if(live)
+		return snapshotInit(counted, sizeof(counted)/sizeof(counted[0]), 1 << 30, RING_WORDS);
+	return snapshotInit(whole, sizeof(whole)/sizeof(whole[0]), 1 << 30, RING_WORDS);
+}
+
+/*****************************************************************************
+ * Everything the game can observe of the state: the live entities and the   *
+ * slot arrays in full                                                       *
+ *****************************************************************************/
+static int sameState(const Sim *a, const Sim *b)
+{
+	const EntityPool *p = &a->entities, *q = &b->entities;
+	int n = p->count;
+
+	return p->count == q->count && p->free_head == q->free_head && a->rng == b->rng &&
+		   !memcmp(a->token, b->token, sizeof(a->token)) &&
+		   !memcmp(p->items, q->items, n * sizeof(Particle)) &&
+		   !memcmp(p->types, q->types, n) &&
+		   !memcmp(p->owner, q->owner, n * sizeof(u16)) &&
+		   !memcmp(p->dense, q->dense, 3 * p->capacity * sizeof(u16));
+}
+
+static void copyState(Sim *dst, const Sim *src)
+{
+	const EntityPool *p = &src->entities;
+	EntityPool *q = &dst->entities;
+
+	memcpy(q->arena, p->arena, p->arena_size);
+	q->count = p->count;
+	q->free_head = p->free_head;
+	memcpy(dst->token, src->token, sizeof(src->token));
+	dst->rng = src->rng;
+}
+
+static int run(int balls, int capacity, int live, int num_frames)
+{
+	SimParams params;
+	Sim sim, check;
+	u8 *hits = malloc(capacity);
+	double t_snap, t_rewind;
+	u32 words;
+	int f, mark = num_frames / 2, bad = 0;
+
+	simDefaults(&params);
+	if(!hits || simInit(&sim, &params, 640, 480, capacity, 2, 1) < 0 ||
+	   simInit(&check, &params, 640, 480, capacity, 2, 1) < 0 ||
+	   registerPool(&sim, live) < 0) {
+		fprintf(stderr, "snapbench: out of memory\n");
+		exit(2);
+	}
+	simSpawnBalls(&sim, balls);
+
+	// The number of balls swings by a quarter, as when the governor steps
+	t_snap = 0;
+	for(f=0; f<num_frames; f++) {
+		simFitBalls(&sim, balls - balls/4 + (f % 100 < 50 ? f % 50 : 50 - f % 50) * balls / 200);
+		simStep(&sim, sim.entities.count, hits);
+		t_snap -= cpuSeconds();
+		if(snapshotCapture() < 0)
+			bad++;
+		t_snap += cpuSeconds();
+		if(f == mark)
+			copyState(&check, &sim);
+	}
+	words = snapshotRingUsage();
+
+	t_rewind = cpuSeconds();
+	for(f=num_frames-1; f>mark; f--)
+		if(snapshotRewind(1) != 1)
+			bad++;
+	t_rewind = cpuSeconds() - t_rewind;
+	if(!sameState(&sim, &check))
+		bad++;
+
+	t_snap /= num_frames;
+	t_rewind /= num_frames - 1 - mark;
+	printf("%5d balls of %5d, %-6s %8.1f us/snapshot (%4.1f%% of a frame), %8.1f us/rewound frame,"
+		   " %6.1f KB/frame\n", balls, capacity, live ? "live" : "whole", t_snap * 1e6,
+		   t_snap * 1e6 * 100 / BUDGET_US, t_rewind * 1e6, words * 4.0 / num_frames / 1024);
+
+	snapshotFree();
+	simFree(&check);
+	simFree(&sim);
+	free(hits);
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	// The game's pool, then one for 10k balls
+	static const int balls[][2] = {
+		{ 100, CAPACITY }, { 1000, CAPACITY }, { 4000, CAPACITY }, { 10000, 10240 },
+	};
+	int c, i, bad = 0, num_frames = 600;
+
+	while((c = getopt(argc, argv, "f:")) != -1) {
+		switch(c) {
+			case 'f': num_frames = atoi(optarg); break;
+			default: fprintf(stderr, "snapbench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_frames < 2)
+		num_frames = 2;
+
+	printf("%d frames\n", num_frames);
+	for(i=0; i<(int)(sizeof(balls)/sizeof(balls[0])); i++) {
+		bad += run(balls[i][0], balls[i][1], 0, num_frames);
+		bad += run(balls[i][0], balls[i][1], 1, num_frames);
+	}
+	if(bad)
+		fprintf(stderr, "snapbench: rewound state differs from the recorded one\n");
+	return bad ? 1 : 0;
+}
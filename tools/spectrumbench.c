@@ -0,0 +1,220 @@
+/*****************************************************************************
+ * spectrumbench - accuracy and cost of the spectrum (source/spectrum.h)     *
+ *                                                                           *
+ * usage: spectrumbench [-b buffers]                                         *
+ *                                                                           *
+ * Compares spectrumFFT() with a floating point DFT on random input and      *
+ * feeds a tone from the middle of every octave band, which has to come out  *
+ * loudest in that band. Tones of 30 and 60 Hz have to come out in the bass  *
+ * band and one of 9 kHz, above the analyzed range, 10 dB below one inside.  *
+ * Stereo and mono input take different paths and have to agree. Then times  *
+ * spectrumFeed() on full player buffers of 4096 samples (2048 stereo        *
+ * frames, 43 ms at 48 kHz) against the part of decoding that builds on the  *
+ * host: resampling the same buffer from 44.1 kHz at the default quality.    *
+ * ov_read() comes on top of that, so the tap's share of the whole decode    *
+ * cost is lower than the share reported; on the Wii the HUD shows both      *
+ * times. Exits with 1 if the FFT is off by more than 8 LSB, a tone lands in *
+ * the wrong band or too loud, the paths disagree or the tap costs 5% of the *
+ * resampling or more.                                                       *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#include "spectrum.h"
+#include "resampler.h"
+
+#define N          SPECTRUM_SIZE
+#define BUFFER     4096			// OGG_BUFFER_SAMPLES of oggplayer.h
+#define IN_RATE    44100
+#define MAX_LSB    8
+#define MAX_SHARE  5			// percent of the resampling the tap may cost
+#define ROUNDS     10
+
+static u32 rng = 1;
+static volatile int sink;	// keeps the timed loops from being dropped
+
+static u32 rnd()
+{
+	rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+	return rng;
+}
+
+static double cpuSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*****************************************************************************
+ * Largest difference between spectrumFFT() and a DFT scaled by 1/N          *
+ *****************************************************************************/
+static double fftError()
+{
+	s16 re[N], im[N], in_re[N], in_im[N];
+	double sr, si, a, err, worst = 0;
+	int run, i, k;
+
+	for(run=0; run<16; run++) {
+		for(i=0; i<N; i++) {
+			re[i] = in_re[i] = (s16)(rnd() % 65536 - 32768);
+			im[i] = in_im[i] = (run & 1) ? (s16)(rnd() % 65536 - 32768) : 0;
+		}
+		spectrumFFT(re, im);
+		for(k=0; k<N; k++) {
+			for(i=0, sr=si=0; i<N; i++) {
+				a = -2 * M_PI * ((long)i * k % N) / N;
+				sr += in_re[i] * cos(a) - in_im[i] * sin(a);
+				si += in_re[i] * sin(a) + in_im[i] * cos(a);
+			}
+			err = fmax(fabs(sr / N - re[k]), fabs(si / N - im[k]));
+			if(err > worst)
+				worst = err;
+		}
+	}
+	return worst;
+}
+
+// Center of every band at 48 kHz: bins of 46.875 Hz below 1.5 kHz, of
+// 187.5 Hz above, see sp_band of spectrum.c
+static const double band_center[SPECTRUM_BANDS] = {
+	46.875, 93.75, 140.625, 281.25, 562.5, 1125, 2250, 4500
+};
+
+// Feeds a tone of f Hz, in stereo with noise that cancels in the mixdown
+static const SpectrumFrame * tone(double f, int channels, s16 *pcm)
+{
+	int i, d;
+
+	for(i=0; i<BUFFER/2; i++) {
+		s16 s = (s16)(16000 * sin(2 * M_PI * f * i / RESAMPLE_OUT_RATE));
+		if(channels == 2) {
+			d = (int)(rnd() % 16001) - 8000;
+			pcm[2*i] = s + d;
+			pcm[2*i+1] = s - d;
+		} else
+			pcm[i] = s;
+	}
+	spectrumFeed(pcm, BUFFER / 2 * channels, channels);
+	return spectrumRead();
+}
+
+static int loudest(const SpectrumFrame *f)
+{
+	int k, l;
+
+	for(k=1, l=0; k<SPECTRUM_BANDS; k++)
+		if(f->energy[k] > f->energy[l])
+			l = k;
+	return l;
+}
+
+static double total(const SpectrumFrame *f)
+{
+	double e = 0;
+	int k;
+
+	for(k=0; k<SPECTRUM_BANDS; k++)
+		e += f->energy[k];
+	return e;
+}
+
+int main(int argc, char **argv)
+{
+	static s16 pcm[BUFFER], in[BUFFER], out[BUFFER + 64];
+	Resampler *r = malloc(sizeof(Resampler));
+	SpectrumFrame stereo;
+	double t, tap = 1e9, resample = 1e9, err, inside, above;
+	int c, i, b, l, in_frames, bad = 0, runs, round, num_buffers = 2000;
+	const double bass[] = { 30, 60 };
+
+	while((c = getopt(argc, argv, "b:")) != -1) {
+		switch(c) {
+			case 'b': num_buffers = atoi(optarg); break;
+			default: fprintf(stderr, "spectrumbench: bad arguments\n"); return 2;
+		}
+	}
+	if(num_buffers < ROUNDS)
+		num_buffers = ROUNDS;
+	if(!r) {
+		fprintf(stderr, "spectrumbench: out of memory\n");
+		return 2;
+	}
+	spectrumInit();
+
+	err = fftError();
+	printf("FFT: %d points, at most %.1f LSB off a DFT\n", N, err);
+	if(err > MAX_LSB)
+		bad++;
+
+	printf("band of a tone on the band's center:");
+	for(b=0; b<SPECTRUM_BANDS; b++) {
+		l = loudest(tone(band_center[b], 2, pcm));
+		printf(" %d", l);
+		if(l != b)
+			bad++;
+	}
+	printf("\n");
+
+	printf("band of the bass:");
+	for(i=0; i<(int)(sizeof(bass)/sizeof(bass[0])); i++) {
+		l = loudest(tone(bass[i], 2, pcm));
+		printf(" %.0f Hz %d", bass[i], l);
+		if(l != 0)
+			bad++;
+	}
+	inside = total(tone(band_center[SPECTRUM_BANDS-1], 2, pcm));
+	above = total(tone(9000, 2, pcm));
+	printf(", 9 kHz at %.1f dB of 4.5 kHz\n", 10 * log10(above / inside));
+	if(above * 10 > inside)
+		bad++;
+
+	// The stereo taps against the plain filter of other blocks
+	for(b=0; b<SPECTRUM_BANDS; b++) {
+		stereo = *tone(band_center[b] * 1.3, 2, pcm);
+		if(memcmp(stereo.energy, tone(band_center[b] * 1.3, 1, pcm)->energy,
+				  sizeof(stereo.energy)) != 0) {
+			fprintf(stderr, "spectrumbench: stereo and mono differ at %.0f Hz\n",
+					band_center[b] * 1.3);
+			bad++;
+		}
+	}
+
+	// Music-like input, the cost does not depend on it
+	for(i=0; i<BUFFER; i++)
+		pcm[i] = (s16)(8000 * sin(i * 0.013) + (int)(rnd() % 8001) - 4000);
+
+	// What the player resamples to fill one buffer
+	resamplerInit(r, RESAMPLE_GOOD, IN_RATE);
+	in_frames = resamplerMaxIn(r, BUFFER / 2);
+	for(i=0; i<in_frames*2; i++)
+		in[i] = pcm[i];
+
+	// Both alternate and keep their fastest round, which is the least
+	// disturbed by the rest of the machine
+	for(round=0; round<ROUNDS; round++) {
+		t = cpuSeconds();
+		for(runs=0; runs<num_buffers/ROUNDS; runs++)
+			spectrumFeed(pcm, BUFFER, 2);
+		tap = fmin(tap, (cpuSeconds() - t) / (num_buffers/ROUNDS));
+		sink += spectrumRead()->seq;
+
+		t = cpuSeconds();
+		for(runs=0; runs<num_buffers/ROUNDS; runs++)
+			sink += resamplerRun(r, in, in_frames, 2, out);
+		resample = fmin(resample, (cpuSeconds() - t) / (num_buffers/ROUNDS));
+	}
+
+	printf("per buffer of %d samples: tap %.2f us, resampling %.2f us, tap is %.1f%% of"
+		   " that and %.4f%% of the music's time\n", BUFFER, tap * 1e6, resample * 1e6,
+		   tap * 100 / resample, tap * 100 / (BUFFER / 2.0 / RESAMPLE_OUT_RATE));
+	if(tap * 100 >= resample * MAX_SHARE)
+		bad++;
+
+	free(r);
+	return bad ? 1 : 0;
+}
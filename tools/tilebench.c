@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * tilebench - scaling benchmark of the tile rasterizer (source/tiles.h)     *
+ *                                                                           *
+ * usage: tilebench [-n particles] [-j max threads] [-f frames]              *
+ *                                                                           *
+ * Draws n round particles into a 640x480 framebuffer the way                *
+ * drawParticles() queues them, once with every thread count from 1 to j.    *
+ * The threads form a pool that lives for all frames of a run. Each one      *
+ * claims tiles through tilesWork() until none are left, so threads that     *
+ * finish early take over the remaining tiles. More primitives than          *
+ * TILE_MAX_RECTS are drawn in batches: when the queue reports that it is    *
+ * full, the batch is rasterized and queueing starts over. Every frame is    *
+ * compared with the single-threaded one; exits with 1 if any differs.       *
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "tiles.h"
+
+#define FB_WIDTH  640
+#define FB_HEIGHT 480
+
+typedef struct {
+	int xm, ym, a, b;
+	u32 color;
+} Ball;
+
+static Ball *balls;
+static int num_balls = 100000, num_frames = 10;
+static u32 *fb;
+static int batches;
+
+// The pool: every frame the main thread and the workers meet at start,
+// rasterize and meet again at done
+static pthread_barrier_t start, done;
+static volatile int quit;
+
+static void die(const char *msg)
+{
+	fprintf(stderr, "tilebench: %s\n", msg);
+	exit(2);
+}
+
+static double wallSeconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void *worker(void *arg)
+{
+	for(;;) {
+		pthread_barrier_wait(&start);
+		if(quit)
+			break;
+		tilesWork(fb);
+		pthread_barrier_wait(&done);
+	}
+	return NULL;
+}
+
+static void rasterize()
+{
+	tilesBin();
+	pthread_barrier_wait(&start);
+	tilesWork(fb);
+	pthread_barrier_wait(&done);
+	tilesBegin();
+	batches++;
+}
+
+static void drawFrame()
+{
+	const Ball *p;
+	int i;
+
+	memset(fb, 0, FB_WIDTH/2 * FB_HEIGHT * sizeof(u32));
+	for(i=0; i<num_balls; i++) {
+		p = &balls[i];
+		if(tilesAddEllipse(p->xm, p->ym, p->a, p->b, p->color) < 0) {
+			rasterize();
+			tilesAddEllipse(p->xm, p->ym, p->a, p->b, p->color);
+		}
+	}
+	rasterize();
+}
+
+int main(int argc, char **argv)
+{
+	int max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_t *threads;
+	u32 *golden, rng = 1;
+	double t, base = 0;
+	int i, f, n, c, bad = 0;
+
+	while((c = getopt(argc, argv, "n:j:f:")) != -1) {
+		switch(c) {
+			case 'n': num_balls = atoi(optarg); break;
+			case 'j': max_threads = atoi(optarg); break;
+			case 'f': num_frames = atoi(optarg); break;
+			default: die("bad arguments, see the top of tilebench.c");
+		}
+	}
+	if(num_balls < 1 || num_frames < 1)
+		die("bad arguments, see the top of tilebench.c");
+	if(max_threads < 1)
+		max_threads = 1;
+
+	balls = malloc(num_balls * sizeof(Ball));
+	fb = malloc(FB_WIDTH/2 * FB_HEIGHT * sizeof(u32));
+	golden = malloc(FB_WIDTH/2 * FB_HEIGHT * sizeof(u32));
+	threads = malloc(max_threads * sizeof(pthread_t));
+	if(!balls || !fb || !golden || !threads)
+		die("out of memory");
+
+	// Sizes of the game's particles, each with its own color so that a
+	// wrong drawing order would show
+	for(i=0; i<num_balls; i++) {
+		rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+		balls[i].xm = rng % FB_WIDTH;
+		balls[i].ym = (rng >> 10) % FB_HEIGHT;
+		balls[i].a = 1 + (rng >> 20) % 10;
+		balls[i].b = 1 + (rng >> 24) % 10;
+		balls[i].color = rng;
+	}
+	if(tilesInit(FB_WIDTH, FB_HEIGHT) < 0)
+		die("framebuffer too large");
+
+	printf("%d particles, %dx%d, %d frames\n", num_balls, FB_WIDTH, FB_HEIGHT, num_frames);
+	printf("threads  ms/frame  Mparticles/s  speedup\n");
+	for(n=1; n<=max_threads; n++) {
+		if(pthread_barrier_init(&start, NULL, n) || pthread_barrier_init(&done, NULL, n))
+			die("cannot create barriers");
+		quit = 0;
+		for(i=0; i<n-1; i++)
+			if(pthread_create(&threads[i], NULL, worker, NULL))
+				die("cannot create thread");
+
+		drawFrame();		// warm up, also builds the span tables
+		if(n == 1)
+			memcpy(golden, fb, FB_WIDTH/2 * FB_HEIGHT * sizeof(u32));
+
+		batches = 0;
+		t = wallSeconds();
+		for(f=0; f<num_frames; f++) {
+			drawFrame();
+			if(memcmp(fb, golden, FB_WIDTH/2 * FB_HEIGHT * sizeof(u32)) != 0)
+				bad = 1;
+		}
+		t = (wallSeconds() - t) / num_frames;
+		if(n == 1)
+			base = t;
+		printf("%7d  %8.2f  %12.2f  %7.2f\n", n, t * 1e3, num_balls / t * 1e-6, base / t);
+
+		quit = 1;
+		pthread_barrier_wait(&start);
+		for(i=0; i<n-1; i++)
+			pthread_join(threads[i], NULL);
+		pthread_barrier_destroy(&start);
+		pthread_barrier_destroy(&done);
+	}
+	printf("%d batches of up to %d primitives per frame\n", batches / num_frames, TILE_MAX_RECTS);
+
+	if(bad)
+		fprintf(stderr, "tilebench: multi-threaded frames differ from the single-threaded one\n");
+	free(threads);
+	free(golden);
+	free(fb);
+	free(balls);
+	return bad;
+}